@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "beam.h"
+
+static pthread_key_t arena_key;
+static pthread_once_t arena_key_once = PTHREAD_ONCE_INIT;
+
+static void beam_arena_free(void *arg) {
+    struct beam_arena *arena = arg;
+    if (arena == NULL) {
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        free(arena->boards[i]);
+        free(arena->bonus[i]);
+        free(arena->root_rotation[i]);
+        free(arena->root_col[i]);
+    }
+    free(arena->candidate_score);
+    free(arena->candidate_parent);
+    free(arena->candidate_rotation);
+    free(arena->candidate_col);
+    free(arena->order);
+    free(arena->leaf_score);
+    free(arena);
+}
+
+static void arena_key_create(void) {
+    pthread_key_create(&arena_key, beam_arena_free);
+}
+
+static struct beam_arena *beam_arena_alloc(int capacity) {
+    struct beam_arena *arena = calloc(1, sizeof(struct beam_arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    int candidates = capacity * MAX_PLACEMENTS;
+    arena->capacity = capacity;
+    arena->candidate_capacity = candidates;
+    int ok = 1;
+    for (int i = 0; i < 2; i++) {
+        arena->boards[i] = malloc(sizeof(struct tetris) * capacity);
+        arena->bonus[i] = malloc(sizeof(int64_t) * capacity);
+        arena->root_rotation[i] = malloc(capacity);
+        arena->root_col[i] = malloc(capacity);
+        ok = ok && arena->boards[i] && arena->bonus[i] && arena->root_rotation[i] && arena->root_col[i];
+    }
+    arena->candidate_score = malloc(sizeof(int64_t) * candidates);
+    arena->candidate_parent = malloc(sizeof(uint16_t) * candidates);
+    arena->candidate_rotation = malloc(candidates);
+    arena->candidate_col = malloc(candidates);
+    arena->order = malloc(sizeof(int32_t) * capacity);
+    arena->leaf_score = malloc(sizeof(int64_t) * capacity);
+    ok = ok && arena->candidate_score && arena->candidate_parent && arena->candidate_rotation
+            && arena->candidate_col && arena->order && arena->leaf_score;
+    if (!ok) {
+        beam_arena_free(arena);
+        return NULL;
+    }
+    return arena;
+}
+
+struct beam_arena *beam_arena_get(int capacity) {
+    pthread_once(&arena_key_once, arena_key_create);
+    struct beam_arena *arena = pthread_getspecific(arena_key);
+    if (arena != NULL && arena->capacity >= capacity) {
+        return arena;
+    }
+    beam_arena_free(arena);
+    arena = beam_arena_alloc(capacity);
+    pthread_setspecific(arena_key, arena);
+    return arena;
+}
+
+// 不超过这个数时用插入排序做部分选择
+#define SELECT_INSERTION_MAX 16
+
+// a 排在 b 前面：评分更高，或评分相同而下标更小
+static inline int ranks_before(const int64_t *scores, int32_t a, int32_t b) {
+    return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+}
+
+// 堆顶是已选出的候选中排名最靠后的一个
+static void sift_down(const int64_t *scores, int32_t *heap, int size, int i) {
+    while (1) {
+        int worst = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < size && ranks_before(scores, heap[worst], heap[l])) {
+            worst = l;
+        }
+        if (r < size && ranks_before(scores, heap[worst], heap[r])) {
+            worst = r;
+        }
+        if (worst == i) {
+            return;
+        }
+        int32_t tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+int select_top_scores(const int64_t *scores, int n, int k, int32_t *order) {
+    if (k > n) {
+        k = n;
+    }
+    if (k <= 0) {
+        return 0;
+    }
+    if (k <= SELECT_INSERTION_MAX) {
+        // k 很小时（逐节点 beam 通常只留几个）直接插入有序数组，比堆的分支更少
+        int size = 0;
+        for (int32_t i = 0; i < n; i++) {
+            if (size == k && !ranks_before(scores, i, order[k - 1])) {
+                continue;
+            }
+            int pos = size < k ? size++ : k - 1;
+            while (pos > 0 && scores[order[pos - 1]] < scores[i]) {
+                order[pos] = order[pos - 1];
+                pos--;
+            }
+            order[pos] = i;
+        }
+        return k;
+    }
+
+    for (int i = 0; i < k; i++) {
+        order[i] = i;
+    }
+    for (int i = k / 2 - 1; i >= 0; i--) {
+        sift_down(scores, order, k, i);
+    }
+    for (int32_t i = k; i < n; i++) {
+        if (ranks_before(scores, i, order[0])) {
+            order[0] = i;
+            sift_down(scores, order, k, 0);
+        }
+    }
+    // 依次把排名最靠后的堆顶换到末尾，得到从高到低的顺序
+    for (int size = k - 1; size > 0; size--) {
+        int32_t tmp = order[0];
+        order[0] = order[size];
+        order[size] = tmp;
+        sift_down(scores, order, size, 0);
+    }
+    return k;
+}
@@ -0,0 +1,40 @@
+#ifndef BEAM_H
+#define BEAM_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// 整层 beam 搜索的工作区
+// 一层最多保留 capacity 个局面，局面本身只在两层之间交替存放，
+// 候选落点（父局面下标、旋转、列、评分）按结构数组存放，排序和选择只移动下标。
+// 每个线程一份，按需分配并在之后的搜索中复用，线程退出时释放。
+
+struct beam_arena {
+    int capacity;                    // 每层最多保留的局面数
+    int candidate_capacity;          // capacity * MAX_PLACEMENTS
+
+    // 当前层和下一层的局面，layer 在两者之间交替
+    struct tetris *boards[2];
+    int64_t *bonus[2];               // 到达该局面为止累计的落点高度分
+    int8_t *root_rotation[2];        // 该局面由根节点的哪个落点展开而来
+    int8_t *root_col[2];
+
+    // 当前层全部局面的全部落点
+    int64_t *candidate_score;
+    uint16_t *candidate_parent;
+    int8_t *candidate_rotation;
+    int8_t *candidate_col;
+
+    int32_t *order;                  // 选出的候选下标，按评分从高到低
+    int64_t *leaf_score;             // 最后一层各局面的搜索结果（并行计算时各任务只写自己的槽位）
+};
+
+// 取得本线程的工作区，容量不足 capacity 时重新分配；内存不足时返回 NULL
+struct beam_arena *beam_arena_get(int capacity);
+
+// 从 scores[0..n-1] 中选出评分最高的至多 k 个下标写入 order，按评分从高到低排列，
+// 评分相同时下标小的在前（与逐个插入排序的结果相同）。返回选出的个数
+// k 较大时用大小为 k 的堆做部分选择，耗时 O(n log k)；k 很小时直接插入排序
+int select_top_scores(const int64_t *scores, int n, int k, int32_t *order);
+
+#endif // BEAM_H
@@ -0,0 +1,230 @@
+#include <string.h>
+#include <stdatomic.h>
+#include "bitboard.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITBOARD_X86 1
+#endif
+
+// 每行第 0 位、第 9 位、低 9 位以及一个字中全部 60 个有效位（等于 0x3FF * REP）
+#define REP       0x0004010040100401ULL
+#define COL_FIRST REP
+#define COL_LAST  (REP << 9)
+#define LOW9      (0x1FFULL * REP)
+#define ROW_BITS  BITBOARD_WORD_BITS
+#define ROW_MASK  0x3FFULL
+
+// 满行在该行第 0 位置 1：低 9 位全满时加一恰好进位到第 9 位，不会越过本行
+static inline uint64_t full_rows(uint64_t w) {
+    return (((w & LOW9) + REP) & w & COL_LAST) >> 9;
+}
+
+void bitboard_from_tetris(struct bitboard *b, const struct tetris *t) {
+    memset(b, 0, sizeof(*b));
+    for (int r = 0; r < ROW; r++) {
+        uint64_t cells = (t->board[r] >> COL_SHIFT) & ROW_MASK;
+        b->w[r / BITBOARD_ROWS_PER_WORD] |= cells << (10 * (r % BITBOARD_ROWS_PER_WORD));
+    }
+}
+
+void bitboard_to_tetris(const struct bitboard *b, struct tetris *t) {
+    init_tetris(t);
+    for (int r = 0; r < ROW; r++) {
+        uint64_t cells = (b->w[r / BITBOARD_ROWS_PER_WORD] >> (10 * (r % BITBOARD_ROWS_PER_WORD))) & ROW_MASK;
+        t->board[r] |= (uint16_t) (cells << COL_SHIFT);
+    }
+    struct board_features f;
+    compute_board_features(t, &f);
+    memcpy(t->col_height, f.col_height, sizeof(t->col_height));
+    t->max_height = f.max_height;
+    t->holes = f.holes;
+    t->row_transitions = f.row_transitions;
+    t->col_transitions = f.col_transitions;
+    t->wells = f.wells;
+}
+
+int bitboard_height(const struct bitboard *b) {
+    for (int k = BITBOARD_WORDS - 1; k >= 0; k--) {
+        if (b->w[k]) {
+            return k * BITBOARD_ROWS_PER_WORD + (63 - __builtin_clzll(b->w[k])) / 10 + 1;
+        }
+    }
+    return 0;
+}
+
+static inline int landing_row(const struct bitboard *b, uint64_t p) {
+    int r = bitboard_height(b);    // 这一行及以上全空，方块一定放得下
+    while (r > 0 && !bitboard_collides(b, p, r - 1)) {
+        r--;
+    }
+    return r;
+}
+
+int bitboard_landing_row(const struct bitboard *b, const struct rotation *rot, int col) {
+    return landing_row(b, bitboard_piece_mask(rot, col));
+}
+
+// -1 表示尚未检测 CPU
+static atomic_int bitboard_pext = -1;
+
+int bitboard_pext_supported(void) {
+#ifdef BITBOARD_X86
+    return __builtin_cpu_supports("bmi2");
+#else
+    return 0;
+#endif
+}
+
+void set_bitboard_pext(int enabled) {
+    atomic_store(&bitboard_pext, enabled && bitboard_pext_supported());
+}
+
+static inline int use_bitboard_pext(void) {
+    int mode = atomic_load_explicit(&bitboard_pext, memory_order_relaxed);
+    if (mode < 0) {
+        mode = bitboard_pext_supported();
+        atomic_store(&bitboard_pext, mode);
+    }
+    return mode;
+}
+
+// 把 count 行（每行 10 位，紧挨着）接到 out 中已有的 *n 行之后
+static inline void append_rows(uint64_t *out, int *n, uint64_t rows, int count) {
+    int k = *n / BITBOARD_ROWS_PER_WORD;
+    int off = *n % BITBOARD_ROWS_PER_WORD;
+    out[k] |= (rows << (10 * off)) & ROW_BITS;
+    if (off + count > BITBOARD_ROWS_PER_WORD) {
+        out[k + 1] |= rows >> (60 - 10 * off);
+    }
+    *n += count;
+}
+
+#ifdef BITBOARD_X86
+__attribute__((target("bmi2")))
+static void clear_rows_pext(struct bitboard *b, int first_word) {
+    uint64_t out[BITBOARD_WORDS] = {0};
+    int n = first_word * BITBOARD_ROWS_PER_WORD;
+    memcpy(out, b->w, sizeof(uint64_t) * first_word);
+    for (int k = first_word; k < BITBOARD_WORDS; k++) {
+        uint64_t full = full_rows(b->w[k]);
+        uint64_t keep = ROW_BITS & ~(full * ROW_MASK);
+        append_rows(out, &n, _pext_u64(b->w[k], keep), BITBOARD_ROWS_PER_WORD - __builtin_popcountll(full));
+    }
+    memcpy(b->w, out, sizeof(out));
+}
+#endif
+
+static void clear_rows_scalar(struct bitboard *b, int first_word) {
+    uint64_t out[BITBOARD_WORDS] = {0};
+    int n = first_word * BITBOARD_ROWS_PER_WORD;
+    memcpy(out, b->w, sizeof(uint64_t) * first_word);
+    for (int k = first_word; k < BITBOARD_WORDS; k++) {
+        uint64_t full = full_rows(b->w[k]);
+        for (int i = 0; i < BITBOARD_ROWS_PER_WORD; i++) {
+            if (((full >> (10 * i)) & 1) == 0) {
+                append_rows(out, &n, (b->w[k] >> (10 * i)) & ROW_MASK, 1);
+            }
+        }
+    }
+    memcpy(b->w, out, sizeof(out));
+}
+
+int bitboard_place(struct bitboard *b, const struct rotation *rot, int col, int *rows_eliminated) {
+    uint64_t p = bitboard_piece_mask(rot, col);
+    int r = landing_row(b, p);
+    *rows_eliminated = 0;
+    if (r + rot->height > ROW) {
+        return -1;
+    }
+
+    uint64_t lo, hi;
+    int k = r / BITBOARD_ROWS_PER_WORD;
+    bitboard_mask_at_row(p, r, &lo, &hi);
+    b->w[k] |= lo;
+    // 只有方块覆盖的行可能被填满
+    int full = __builtin_popcountll(full_rows(b->w[k]));
+    if (hi) {
+        b->w[k + 1] |= hi;
+        full += __builtin_popcountll(full_rows(b->w[k + 1]));
+    }
+    if (full) {
+#ifdef BITBOARD_X86
+        if (use_bitboard_pext()) {
+            clear_rows_pext(b, k);
+        } else {
+            clear_rows_scalar(b, k);
+        }
+#else
+        clear_rows_scalar(b, k);
+#endif
+        *rows_eliminated = full;
+    }
+    return r;
+}
+
+// 特征的计算过程，按有无 popcnt 指令编译成两份
+static inline __attribute__((always_inline)) void features_body(const struct bitboard *b, struct board_features *f) {
+    int top = bitboard_height(b);
+    int holes = 0, row_transitions = 0, col_transitions = 0, wells = 0;
+    uint64_t covered = 0;    // 更高的各字中出现过方块的列
+    for (int k = (top + BITBOARD_ROWS_PER_WORD - 1) / BITBOARD_ROWS_PER_WORD - 1; k >= 0; k--) {
+        uint64_t w = b->w[k];
+        int rows = top - k * BITBOARD_ROWS_PER_WORD;
+        uint64_t valid = rows >= BITBOARD_ROWS_PER_WORD ? ROW_BITS : (1ULL << (10 * rows)) - 1;
+
+        // 空洞：上方某一行有方块的空格。把上一行移下来，再向下抹 1、2、4 行
+        uint64_t above = (w >> 10) | (covered << 50);
+        above |= above >> 10;
+        above |= above >> 20;
+        above |= above >> 40;
+        holes += __builtin_popcountll(above & ~w & ROW_BITS);
+        covered = (above | w) & ROW_MASK;
+
+        // 行转换与井格，与 row_feature_lut 的口径相同：左侧是方块或墙的空格开始一个空白段，
+        // 每行空白段数减一；左右都是方块或墙的空格是井格
+        uint64_t empty = ~w & valid;
+        uint64_t left = ((w << 1) & ~COL_FIRST) | COL_FIRST;
+        uint64_t right = ((w >> 1) & ~COL_LAST) | COL_LAST;
+        uint64_t starts = empty & left;
+        uint64_t has_empty = (((empty & LOW9) + LOW9) | empty) & COL_LAST;
+        row_transitions += __builtin_popcountll(starts) - __builtin_popcountll(has_empty);
+        wells += __builtin_popcountll(starts & right);
+
+        // 列转换：方块压在空格上，最底行下面是地板
+        uint64_t below = (w << 10) | (k > 0 ? b->w[k - 1] >> 50 : ROW_MASK);
+        col_transitions += __builtin_popcountll(w & ~below & ROW_BITS);
+    }
+    f->max_height = top;
+    f->holes = holes;
+    f->row_transitions = row_transitions;
+    f->col_transitions = col_transitions;
+    f->wells = wells;
+}
+
+#ifdef BITBOARD_X86
+__attribute__((target("popcnt")))
+static void features_popcnt(const struct bitboard *b, struct board_features *f) {
+    features_body(b, f);
+}
+#endif
+
+static void features_generic(const struct bitboard *b, struct board_features *f) {
+    features_body(b, f);
+}
+
+void bitboard_features(const struct bitboard *b, struct board_features *f) {
+#ifdef BITBOARD_X86
+    static atomic_int popcnt = -1;
+    int mode = atomic_load_explicit(&popcnt, memory_order_relaxed);
+    if (mode < 0) {
+        mode = __builtin_cpu_supports("popcnt");
+        atomic_store(&popcnt, mode);
+    }
+    if (mode) {
+        features_popcnt(b, f);
+        return;
+    }
+#endif
+    features_generic(b, f);
+}
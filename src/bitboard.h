@@ -0,0 +1,67 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+#include "tetris.h"
+#include "board_features.h"
+
+// 位棋盘：把 20×10 的棋盘压进 4 个 64 位字
+// 每个字放 6 行、每行 10 位：第 r 行在 w[r / 6] 的第 (r % 6) * 10 位起，行内第 c 位对应 tetris.board 的第
+// c + COL_SHIFT 位；每个字最高 4 位不用，这样没有一行跨两个字。
+// 碰撞检测、落子都是移位加与/或，消行用 PEXT（BMI2）把未满的行压紧，特征用整字的位运算一次算出。
+// 与行布局的 struct tetris 不同，位棋盘不保存列高度和增量计数。
+
+#define BITBOARD_ROWS_PER_WORD 6
+#define BITBOARD_WORDS ((ROW + BITBOARD_ROWS_PER_WORD - 1) / BITBOARD_ROWS_PER_WORD)
+
+#define BITBOARD_WORD_BITS 0x0FFFFFFFFFFFFFFFULL    // 一个字中的 60 个有效位
+
+struct bitboard {
+    uint64_t w[BITBOARD_WORDS];
+};
+
+// 方块各行按 10 位一行叠在一起，第 i 行在第 10 * i 位起，已经移到 col 列
+static inline uint64_t bitboard_piece_mask(const struct rotation *rot, int col) {
+    uint64_t p = 0;
+    for (int i = 0; i < rot->height; i++) {
+        p |= (uint64_t) rot->shape[i] << (col - COL_SHIFT + 10 * i);
+    }
+    return p;
+}
+
+// 把叠好的方块移到第 row 行：lo 落在 w[row / 6]，超出这个字的几行放进 hi，落在下一个字的底部
+static inline void bitboard_mask_at_row(uint64_t mask, int row, uint64_t *lo, uint64_t *hi) {
+    int off = 10 * (row % BITBOARD_ROWS_PER_WORD);
+    *lo = (mask << off) & BITBOARD_WORD_BITS;
+    *hi = mask >> (60 - off);
+}
+
+// 方块最低一行放在第 row 行时是否与棋盘相交；方块不会超出第 ROW + 3 行，hi 非零时下一个字一定存在
+static inline int bitboard_collides(const struct bitboard *b, uint64_t mask, int row) {
+    uint64_t lo, hi;
+    int k = row / BITBOARD_ROWS_PER_WORD;
+    bitboard_mask_at_row(mask, row, &lo, &hi);
+    return (b->w[k] & lo) || (hi && (b->w[k + 1] & hi));
+}
+
+void bitboard_from_tetris(struct bitboard *b, const struct tetris *t);
+// 写回行布局，列高度和各项特征计数由 compute_board_features() 重建，落子相关字段清零
+void bitboard_to_tetris(const struct bitboard *b, struct tetris *t);
+
+// 最高的非空行加一，空棋盘为 0
+int  bitboard_height(const struct bitboard *b);
+// 与 get_landing_row() 相同：从棋盘顶部逐行下移，直到方块再下一行就会与棋盘相交
+int  bitboard_landing_row(const struct bitboard *b, const struct rotation *rot, int col);
+// 与 place_piece() 对应：落子并消行，返回落点行，*rows_eliminated 为消除的行数
+// 越界时返回 -1，棋盘不变
+int  bitboard_place(struct bitboard *b, const struct rotation *rot, int col, int *rows_eliminated);
+// 算出 max_height、holes、row_transitions、col_transitions、wells，口径与 compute_board_features() 相同
+// col_height 不填写（评估用不到，需要时用 bitboard_to_tetris()）
+void bitboard_features(const struct bitboard *b, struct board_features *f);
+
+// CPU 支持 BMI2 时返回 1
+int  bitboard_pext_supported(void);
+// 0 强制用逐行压紧代替 PEXT 消行，非 0 在 CPU 支持时使用 PEXT（默认）
+void set_bitboard_pext(int enabled);
+
+#endif // BITBOARD_H
@@ -0,0 +1,68 @@
+#include <string.h>
+#include "board_features.h"
+
+#include "row_lut_table.h"
+
+#define COL_MASK ((uint16_t) (((1 << COL) - 1) << COL_SHIFT))
+
+void compute_board_features(const struct tetris *t, struct board_features *f) {
+    int holes = 0, row_transitions = 0, col_transitions = 0, wells = 0;
+    int max_height = 0;
+    uint16_t covered = 0;    // 上方已经出现过方块的列
+    memset(f->col_height, 0, sizeof(f->col_height));
+
+    // 从上往下扫描；不信任增量计数里的 max_height，自己跳过顶部的空行
+    int r = ROW - 1;
+    while (r >= 0 && t->board[r] == EMPTY_ROW) {
+        r--;
+    }
+    for (; r >= 0; r--) {
+        uint16_t cells = t->board[r] & COL_MASK;
+        uint8_t lut = row_feature_lut[cells >> COL_SHIFT];
+        row_transitions += lut & 0x0f;
+        wells += lut >> 4;
+        holes += row_popcount_lut[(covered & ~cells) >> COL_SHIFT];
+        uint16_t below = r > 0 ? t->board[r - 1] : t->pad0;   // 最底行下方是填充行
+        col_transitions += row_popcount_lut[(cells & ~below) >> COL_SHIFT];  // 方块压在空格上
+
+        uint16_t top = cells & ~covered;    // 这些列的最高方块在本行
+        if (top && max_height == 0) {
+            max_height = r + 1;
+        }
+        while (top) {
+            f->col_height[__builtin_ctz(top)] = r + 1;
+            top &= top - 1;
+        }
+        covered |= cells;
+    }
+
+    f->max_height = max_height;
+    f->holes = holes;
+    f->row_transitions = row_transitions;
+    f->col_transitions = col_transitions;
+    f->wells = wells;
+}
+
+int check_board_features(const struct tetris *t, struct board_features *f) {
+    compute_board_features(t, f);
+    int diff = 0;
+    if (memcmp(&t->col_height[COL_SHIFT], &f->col_height[COL_SHIFT], COL) != 0) {
+        diff |= FEATURE_COL_HEIGHT;
+    }
+    if (t->max_height < f->max_height) {
+        diff |= FEATURE_MAX_HEIGHT;
+    }
+    if (t->holes != f->holes) {
+        diff |= FEATURE_HOLES;
+    }
+    if (t->row_transitions != f->row_transitions) {
+        diff |= FEATURE_ROW_TRANSITIONS;
+    }
+    if (t->col_transitions != f->col_transitions) {
+        diff |= FEATURE_COL_TRANSITIONS;
+    }
+    if (t->wells != f->wells) {
+        diff |= FEATURE_WELLS;
+    }
+    return diff;
+}
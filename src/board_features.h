@@ -0,0 +1,35 @@
+#ifndef BOARD_FEATURES_H
+#define BOARD_FEATURES_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// 整盘特征计算
+// 不依赖 place_piece() 维护的增量计数，直接从棋盘位图重新算出全部特征：
+// 行转换和井格查 2^COL 项的行特征表，列转换和空洞用相邻行之间的位运算求得。
+// 既可以作为另一种评估函数（编译时用 EVAL=full 选择），也可以作为检查增量计数是否漂移的基准。
+
+struct board_features {
+    int8_t col_height[COL + 2 * COL_SHIFT];
+    int8_t max_height;             // 真实最高行，增量计数中的 max_height 消行后只是上界
+    int8_t holes;
+    int8_t row_transitions;
+    int8_t col_transitions;
+    int8_t wells;
+};
+
+// 与增量计数不一致的字段
+#define FEATURE_COL_HEIGHT      (1 << 0)
+#define FEATURE_MAX_HEIGHT      (1 << 1)
+#define FEATURE_HOLES           (1 << 2)
+#define FEATURE_ROW_TRANSITIONS (1 << 3)
+#define FEATURE_COL_TRANSITIONS (1 << 4)
+#define FEATURE_WELLS           (1 << 5)
+
+void compute_board_features(const struct tetris *t, struct board_features *f);
+
+// 重新计算特征并与 t 中的增量计数比较，返回不一致字段的 FEATURE_* 位掩码，0 表示一致
+// max_height 只检查是否为上界
+int  check_board_features(const struct tetris *t, struct board_features *f);
+
+#endif // BOARD_FEATURES_H
@@ -0,0 +1,133 @@
+#include <string.h>
+#include "game_log.h"
+
+#define GAME_LOG_END_PIECE 7
+#define GAME_LOG_BUFFER    (1 << 16)
+
+static void put_varint(FILE *f, uint64_t v) {
+    while (v >= 0x80) {
+        putc((int) (v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    putc((int) v, f);
+}
+
+// 成功返回 0，文件结束或超过 10 字节返回 -1
+static int get_varint(FILE *f, uint64_t *v) {
+    *v = 0;
+    for (int shift = 0; shift < 70; shift += 7) {
+        int c = getc(f);
+        if (c == EOF) {
+            return -1;
+        }
+        *v |= (uint64_t) (c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int game_log_create(struct game_log *log, const char *path, const struct game_log_header *header) {
+    log->f = fopen(path, "wb");
+    if (log->f == NULL) {
+        perror(path);
+        return -1;
+    }
+    setvbuf(log->f, NULL, _IOFBF, GAME_LOG_BUFFER);
+    log->header = *header;
+    log->steps = 0;
+    log->score = 0;
+    log->next_piece = -1;
+
+    fwrite(GAME_LOG_MAGIC, 1, 4, log->f);
+    for (int i = 0; i < 8; i++) {
+        putc((int) (header->seed >> (8 * i)) & 0xFF, log->f);
+    }
+    putc(header->level, log->f);
+    put_varint(log->f, (uint64_t) header->beam_width);
+    return 0;
+}
+
+int game_log_write_move(struct game_log *log, const struct game_log_move *move) {
+    uint64_t code = (uint64_t) move->piece | (uint64_t) move->rotation << 3 | (uint64_t) move->col << 5
+                  | (uint64_t) move->score_delta << 9;
+    put_varint(log->f, code);
+    log->steps++;
+    log->score += move->score_delta;
+    return ferror(log->f) ? -1 : 0;
+}
+
+int game_log_finish(struct game_log *log, int next_piece) {
+    put_varint(log->f, GAME_LOG_END_PIECE | (uint64_t) (next_piece + 1) << 3);
+    put_varint(log->f, (uint64_t) log->steps);
+    put_varint(log->f, (uint64_t) log->score);
+    int failed = ferror(log->f);
+    if (fclose(log->f) != 0 || failed) {
+        perror("game log");
+        return -1;
+    }
+    log->f = NULL;
+    return 0;
+}
+
+int game_log_open(struct game_log *log, const char *path) {
+    log->f = fopen(path, "rb");
+    if (log->f == NULL) {
+        perror(path);
+        return -1;
+    }
+    setvbuf(log->f, NULL, _IOFBF, GAME_LOG_BUFFER);
+    log->steps = 0;
+    log->score = 0;
+    log->next_piece = -1;
+
+    unsigned char head[13];
+    uint64_t beam_width;
+    if (fread(head, 1, sizeof(head), log->f) != sizeof(head) || memcmp(head, GAME_LOG_MAGIC, 4) != 0
+        || get_varint(log->f, &beam_width) != 0) {
+        fprintf(stderr, "%s: 不是对局记录文件\n", path);
+        fclose(log->f);
+        log->f = NULL;
+        return -1;
+    }
+    log->header.seed = 0;
+    for (int i = 0; i < 8; i++) {
+        log->header.seed |= (uint64_t) head[4 + i] << (8 * i);
+    }
+    log->header.level = head[12];
+    log->header.beam_width = (int) beam_width;
+    return 0;
+}
+
+int game_log_read_move(struct game_log *log, struct game_log_move *move) {
+    uint64_t code;
+    if (get_varint(log->f, &code) != 0) {
+        fprintf(stderr, "对局记录在第 %d 步后意外结束\n", log->steps);
+        return -1;
+    }
+    if ((code & 7) == GAME_LOG_END_PIECE) {
+        uint64_t steps, score;
+        log->next_piece = (int) (code >> 3) - 1;
+        if (get_varint(log->f, &steps) != 0 || get_varint(log->f, &score) != 0
+            || steps != (uint64_t) log->steps || score != (uint64_t) log->score) {
+            fprintf(stderr, "对局记录的结束标记与内容不符\n");
+            return -1;
+        }
+        return 0;
+    }
+    move->piece = (int) (code & 7);
+    move->rotation = (int) (code >> 3) & 3;
+    move->col = (int) (code >> 5) & 15;
+    move->score_delta = (int) (code >> 9);
+    log->steps++;
+    log->score += move->score_delta;
+    return 1;
+}
+
+void game_log_close(struct game_log *log) {
+    if (log->f) {
+        fclose(log->f);
+        log->f = NULL;
+    }
+}
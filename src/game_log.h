@@ -0,0 +1,49 @@
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// 二进制对局记录
+// 文件头：魔数 "TGL1"、种子（8 字节小端）、激进等级（1 字节，0 表示 --profile 读入的配置）、
+// 整层 beam 宽度（varint）。之后每步一条 varint：
+//     piece | rotation << 3 | col << 5 | 本步得分增量 << 9
+// 多数步不得分，一步只占 2 字节。结束标记是 piece 为 7 的一条 varint，高位存放最后一个未落下的“下一个方块”，
+// 后面再跟总步数和总分（varint）用于校验。
+// 方块序列可以由种子重新生成，这里仍然逐步记下，离线回放时不依赖随机数发生器的实现。
+
+#define GAME_LOG_MAGIC "TGL1"
+
+struct game_log_header {
+    uint64_t seed;
+    int level;
+    int beam_width;
+};
+
+struct game_log_move {
+    int piece;
+    int rotation;
+    int col;
+    int score_delta;
+};
+
+struct game_log {
+    FILE *f;
+    struct game_log_header header;
+    int steps;          // 已写入或已读出的步数
+    int score;          // 累计得分
+    int next_piece;     // 读到结束标记后为最后一个未落下的方块
+};
+
+// 以下函数成功返回 0，失败返回 -1 并在 stderr 说明原因
+int game_log_create(struct game_log *log, const char *path, const struct game_log_header *header);
+int game_log_write_move(struct game_log *log, const struct game_log_move *move);
+// 写结束标记并关闭文件
+int game_log_finish(struct game_log *log, int next_piece);
+
+int game_log_open(struct game_log *log, const char *path);
+// 读出一步返回 1，读到结束标记（并通过校验）返回 0，文件损坏返回 -1
+int game_log_read_move(struct game_log *log, struct game_log_move *move);
+void game_log_close(struct game_log *log);
+
+#endif // GAME_LOG_H
@@ -3,11 +3,20 @@
 #include <string.h>
 #include <getopt.h>
 #include <time.h>
+#include <unistd.h>
 #include "tetris.h"
 #include "print_utils.h"
-
-// 得分规则
-const int SCORE_TABLE[] = {0, 100, 300, 500, 800};
+#include "selfplay.h"
+#include "thread_pool.h"
+#include "ttable.h"
+#include "weights.h"
+#include "pta_io.h"
+#include "game_log.h"
+#include "rng.h"
+#include "search_stats.h"
+#include "rollout.h"
+#include "ponder.h"
+#include "server.h"
 
 int show_help = 0;
 int auto_mode = 0;
@@ -16,6 +25,26 @@ int step_mode = 0;
 int twostep_mode = 0;
 int beam_mode = 0;
 int level = 0;
+int batch_games = 0;
+int batch_threads = 0;
+uint64_t batch_seed = 0;
+int batch_seed_set = 0;
+int search_threads = 0;
+int pta_mode = 0;
+struct move_options move_opts = {0};
+struct eval_weights loaded_weights;      // --weights 读入的评估权重
+struct search_profile loaded_profile;    // --profile 读入的搜索配置
+int profile_loaded = 0;
+enum pta_format pta_format = PTA_FORMAT_TEXT;
+int pta_no_board = 0;
+int pta_flush_every = -1;                // -1 表示按格式取默认值
+const char *pieces_path = NULL;          // --pieces 给出的方块序列文件
+const char *record_path = NULL;          // --record 写入的对局记录
+int ponder_mode = 0;                     // --ponder：等待下一个方块时预先搜索
+const char *serve_path = NULL;           // --serve 监听的 Unix 域套接字
+long stats_every = 0;                    // 每这么多步向 stderr 写一行累计计数的 JSON
+long depth_hist[MAX_SEARCH_DEPTH + 1];   // 限时模式下每步搜索到的深度
+struct rollout_policy rollout_opts = { 13, 0, ROLLOUT_DEFAULT_LENGTH, 0, 0, NULL, NULL, 0 };   // --rollouts 打开
 
 void print_help(const char *prog) {
     printf("用法: %s [选项] 激进等级\n", prog);
@@ -26,7 +55,57 @@ void print_help(const char *prog) {
     printf("  -s, --step           单步模式\n");
     printf("  -t, --twostep        两步模式\n");
     printf("  -b, --beam           BEAM模式\n");
-    printf("激进等级: 1-5 的整数\n");
+    printf("  -g, --games N        批量自我对弈 N 局并输出统计\n");
+    printf("  -j, --threads T      批量对弈或 --serve 使用的线程数（默认 CPU 核数）\n");
+    printf("  -S, --seed S         方块序列的随机种子（默认取当前时间），用于批量对弈或重现单局\n");
+    printf("  -P, --search-threads K  用 K 个线程并行搜索根节点候选（默认不开启）\n");
+    printf("      --tt             打开搜索置换表\n");
+    printf("      --reachable      搜索时也考虑经平移、软降、旋转塞到悬空方块下面的落点（不能用于 --pta 和 --record）\n");
+    printf("      --board B        落点评分使用的棋盘表示：rows（默认）或 bitboard，见 src/bitboard.h\n");
+    printf("      --rollouts N     局面最高行达到 13 后改用蒙特卡洛推演，每个候选推演 N 局（限时模式下为上限）\n");
+    printf("      --rollout-length L  每局推演的步数（默认 %d，最多 %d）\n", ROLLOUT_DEFAULT_LENGTH, ROLLOUT_MAX_LENGTH);
+    printf("  -B, --move-budget-us U  限时模式：每步最多思考 U 微秒，迭代加深搜索\n");
+    printf("  -W, --weights FILE   从 FILE 读取评估权重（格式见 tetris_tune 的输出）\n");
+    printf("  -w, --beam-width N   整层 beam 搜索，已知方块的每层保留 N 个局面（1-%d，常用 64-512）\n", PLY_BEAM_MAX_WIDTH);
+    printf("  -p, --pta            从标准输入读取方块序列（PTA 评测协议）\n");
+    printf("      --pta-format F   协议格式 text（默认）、token（一行一步）或 binary（一字节一步），见 src/pta_io.h\n");
+    printf("      --no-board       PTA 模式下不输出棋盘\n");
+    printf("      --flush-every N  每 N 步输出一次，0 表示只在请求（! 或 8）、输入阻塞和结束时输出\n");
+    printf("      --ponder         PTA 模式下等待下一个方块时预先为每种可能的方块搜索，方块到达后立即回答\n");
+    printf("      --serve PATH     在 Unix 域套接字 PATH 上同时服务多局 PTA 对局，-j 指定搜索线程数（默认 CPU 核数）\n");
+    printf("      --pieces FILE    从 FILE 读取方块序列（映射到内存），隐含 --pta\n");
+    printf("      --record FILE    把单局的种子和每步落子写入二进制对局记录，用 tetris_replay 回放（不能与 -B 同时使用）\n");
+    printf("      --stats-every N  每 N 步向标准错误输出一行搜索计数的 JSON（需用 make STATS=1 编译）\n");
+    printf("      --profile FILE   从 FILE 读取搜索配置（格式见 src/profile.h），优先于激进等级\n");
+    printf("激进等级: 1-5 的整数，选择内置的搜索配置，等级越高每步搜索越多（默认 1）\n");
+}
+
+void print_tt_stats() {
+    uint64_t hits, misses;
+    tt_get_stats(&hits, &misses);
+    uint64_t probes = hits + misses;
+    printf("Transposition table: %llu hits, %llu misses, hit rate %.1f%%\n",
+           (unsigned long long) hits, (unsigned long long) misses,
+           probes ? 100.0 * hits / probes : 0.0);
+}
+
+// 输出限时模式下各搜索深度的步数分布
+void print_depth_stats(FILE *out) {
+    long moves = 0;
+    double sum = 0;
+    for (int d = 1; d <= MAX_SEARCH_DEPTH; d++) {
+        moves += depth_hist[d];
+        sum += (double) d * depth_hist[d];
+    }
+    if (moves == 0) {
+        return;
+    }
+    fprintf(out, "Search depth (budget %lld us): mean %.2f\n", (long long) move_opts.budget_us, sum / moves);
+    for (int d = 1; d <= MAX_SEARCH_DEPTH; d++) {
+        if (depth_hist[d]) {
+            fprintf(out, "  depth %d: %ld moves (%.1f%%)\n", d, depth_hist[d], 100.0 * depth_hist[d] / moves);
+        }
+    }
 }
 
 void play_game() {
@@ -35,89 +114,221 @@ void play_game() {
     int step = 0;
     int total_score = 0;
     int total_lines = 0;
-    int curr_piece = rand() % PIECE_TYPES;
-    int next_piece = rand() % PIECE_TYPES;
+    // 方块序列由种子决定，给出同一个 --seed 可以重现同一局
+    uint64_t seed = batch_seed_set ? batch_seed : (uint64_t) time(NULL);
+    uint64_t rng = seed;
+    int curr_piece = rng_piece(&rng);
+    int next_piece = rng_piece(&rng);
+    struct game_log log;
+    if (record_path) {
+        struct game_log_header header = { seed, profile_loaded ? 0 : level, move_opts.beam_width };
+        if (game_log_create(&log, record_path, &header) != 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    static struct search_stats_table stats_table;
     clock_t start_time = clock();
     while (1) {
-        int best_rotation = 0, best_col = 0;
-        if (t.max_height < 13)
-            select_best_move_with_next_beam(&t, curr_piece, next_piece, &best_rotation, &best_col);
-        else
-            select_best_move_with_next_beam_sampleSZ(&t, curr_piece, next_piece, &best_rotation, &best_col);
+        struct placement best = { 0, 0, 0 };
+        depth_hist[select_game_placement(&t, curr_piece, next_piece, &move_opts, &best)]++;
+        if (search_stats_enabled()) {
+            struct search_stats move_stats;
+            search_stats_collect(&move_stats);
+            search_stats_record(&stats_table, t.max_height, &move_stats);
+            if (stats_every && (step + 1) % stats_every == 0) {
+                search_stats_dump_json(stderr, step + 1, &stats_table);
+            }
+        }
         if (interactive_mode) {
-            print_pieces_side_by_side(best_col - 1, &pieces[curr_piece], best_rotation, &pieces[next_piece], 0);
+            print_pieces_side_by_side(best.col - 1, &pieces[curr_piece], best.rotation, &pieces[next_piece], 0);
             print_board(&t);
             printf("Current score: %d, Total lines: %d\n", total_score, total_lines);
             getchar();
         }
-        place_piece(&t, &pieces[curr_piece], best_rotation, best_col);
+        place_piece_at(&t, &pieces[curr_piece], best.rotation, best.col, best.row);
         total_score += SCORE_TABLE[t.rows_eliminated];
         total_lines += t.rows_eliminated;
         step++;
-        if (t.max_height >= 19 || step >= 100000) {
+        if (record_path) {
+            struct game_log_move move = { curr_piece, best.rotation, best.col, SCORE_TABLE[t.rows_eliminated] };
+            game_log_write_move(&log, &move);
+        }
+        if (t.max_height >= 19 || step >= MAX_GAME_STEPS) {
             printf("Game over at step %d!\n", step);
             printf("Final score: %d, Total lines: %d\n", total_score, total_lines);
             break;
             }
             curr_piece = next_piece;
-            next_piece = rand() % PIECE_TYPES;
+            next_piece = rng_piece(&rng);
         }
     clock_t end_time = clock();
     double elapsed = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+    printf("Seed: %llu\n", (unsigned long long) seed);
     printf("Total elapsed time: %.3f seconds\n", elapsed);
+    if (record_path && game_log_finish(&log, next_piece) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    if (search_stats_enabled()) {
+        search_stats_print(stdout, &stats_table);
+        search_stats_print_threads(stdout);
+    }
+    if (tt_enabled()) {
+        print_tt_stats();
+    }
+    if (move_opts.budget_us > 0) {
+        print_depth_stats(stdout);
+    }
+}
+
+// 输入即将阻塞时的处理：先输出缓冲的结果，打开 --ponder 时再让后台线程开始预先搜索
+struct pta_wait {
+    struct move_writer *writer;
+    struct ponder *ponder;       // NULL 表示不预先搜索
+    const struct tetris *t;      // 已落下上一个方块的局面
+    int curr_piece;              // 已知的当前方块，-1 表示这次等待不预先搜索
+};
+
+static void before_input_block(void *arg) {
+    struct pta_wait *wait = arg;
+    move_writer_flush(wait->writer);
+    if (wait->ponder && wait->curr_piece >= 0) {
+        ponder_start(wait->ponder, wait->t, wait->curr_piece);
+        wait->curr_piece = -1;
+    }
+}
+
+// 读下一个方块，顺带处理输出请求；输入提前结束时退出
+static int next_input_piece(struct piece_reader *reader, struct move_writer *writer) {
+    int piece;
+    while ((piece = piece_reader_next(reader)) == PIECE_FLUSH) {
+        move_writer_flush(writer);
+    }
+    if (piece == PIECE_EOF) {
+        move_writer_flush(writer);
+        fprintf(stderr, "方块序列意外结束\n");
+        exit(EXIT_FAILURE);
+    }
+    return piece;
 }
 
 void play_game_pta() {
-    static int piece_index[26] = {-2,-2,-2,-2,-2,-2,-2,-2,0,3,-2,4,-2,-2,2,-2,-2,-2,5,1,-2,-2,-2,-1,-2,6};
-    char *line = NULL;
-    size_t len = 0;
-    size_t nread;
+    struct piece_reader reader;
+    int opened = pieces_path ? piece_reader_open_file(&reader, pieces_path, pta_format)
+                             : piece_reader_open_fd(&reader, STDIN_FILENO, pta_format);
+    if (opened != 0) {
+        exit(EXIT_FAILURE);
+    }
+    // text 格式默认每步输出一次，与原来的协议相同；紧凑格式默认攒成一批，输入阻塞时再输出
+    struct move_writer writer = { stdout, pta_format, !pta_no_board,
+                                  pta_flush_every >= 0 ? pta_flush_every : (pta_format == PTA_FORMAT_TEXT), 0 };
+    if (pta_format != PTA_FORMAT_TEXT) {
+        setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    }
     struct tetris t;
     init_tetris(&t);
-    int total_score = 0;
-    int total_lines = 0;
-    nread = getline(&line, &len, stdin);
-    if (nread == -1) {
-        perror("getline");
+    struct pta_wait wait = { &writer, NULL, &t, -1 };
+    if (ponder_mode && (wait.ponder = ponder_create(&move_opts)) == NULL) {
+        fprintf(stderr, "无法启动预先搜索线程\n");
         exit(EXIT_FAILURE);
     }
-    int curr_piece = piece_index[line[0] - 'A'];
-    int next_piece = piece_index[line[1] - 'A'];
+    reader.before_block = before_input_block;
+    reader.before_block_arg = &wait;
+
+    int total_score = 0;
+    int total_lines = 0;
+    int curr_piece = next_input_piece(&reader, &writer);
+    int next_piece = next_input_piece(&reader, &writer);
     int best_rotation, best_col;
-    while (1) {
-        if (t.max_height < 13)
-            select_best_move_with_next_beam(&t, curr_piece, next_piece, &best_rotation, &best_col);
-        else
-            select_best_move_with_next_beam_sampleSZ(&t, curr_piece, next_piece, &best_rotation, &best_col);
+    while (curr_piece >= 0) {
+        int depth;
+        if (wait.ponder && ponder_pending(wait.ponder)) {
+            struct placement best;
+            depth = ponder_take(wait.ponder, next_piece, &best);
+            best_rotation = best.rotation;
+            best_col = best.col;
+        } else {
+            if (wait.ponder) {
+                ponder_stop(wait.ponder);    // 上一次预先搜索可能还在算，线程池同一时刻只能有一个使用者
+            }
+            depth = select_game_move(&t, curr_piece, next_piece, &move_opts, &best_rotation, &best_col);
+        }
+        depth_hist[depth]++;
         place_piece(&t, &pieces[curr_piece], best_rotation, best_col);
         total_score += SCORE_TABLE[t.rows_eliminated];
         total_lines += t.rows_eliminated;
-        print_board(&t);
-        printf("%d %d\n", best_rotation * 90, best_col - COL_SHIFT);
-        printf("%d\n", total_score);
-        fflush(stdout);
+        move_writer_put(&writer, &t, best_rotation, best_col, total_score);
         curr_piece = next_piece;
-        nread = getline(&line, &len, stdin);
-        if (nread == -1) {
-            perror("getline");
-            exit(EXIT_FAILURE);
-        }
-        next_piece = piece_index[line[0] - 'A'];
+        // 输入已经到了就不预先搜索，直接照常计算
+        wait.curr_piece = curr_piece;
+        next_piece = next_input_piece(&reader, &writer);
+        wait.curr_piece = -1;
         if (next_piece < 0)
             break;
     }
 
-    if (next_piece == -1) {
+    if (wait.ponder) {
+        ponder_stop(wait.ponder);
+    }
+    if (curr_piece >= 0 && next_piece == PIECE_END) {
         select_best_move_with_next_beam(&t, curr_piece, 0, &best_rotation, &best_col);
         place_piece(&t, &pieces[curr_piece], best_rotation, best_col);
         total_score += SCORE_TABLE[t.rows_eliminated];
-        print_board(&t);
-        printf("%d %d\n", best_rotation * 90, best_col - COL_SHIFT);
-        printf("%d\n", total_score);
-        fflush(stdout);
+        move_writer_put(&writer, &t, best_rotation, best_col, total_score);
+    }
+    move_writer_flush(&writer);
+
+    if (wait.ponder) {
+        long ready, waited;
+        ponder_get_stats(wait.ponder, &ready, &waited);
+        fprintf(stderr, "预先搜索: 命中时已算好 %ld 步，需要等待 %ld 步\n", ready, waited);
+        ponder_destroy(wait.ponder);
     }
+    if (move_opts.budget_us > 0) {
+        print_depth_stats(stderr);    // 标准输出留给评测协议
+    }
+    piece_reader_close(&reader);
+}
 
-    free(line);
+int play_serve() {
+    if (batch_threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        batch_threads = n > 0 ? (int) n : 1;
+    }
+    struct serve_options options = { serve_path, batch_threads, pta_format, !pta_no_board, &move_opts };
+    return run_server(&options) == 0 ? 0 : 1;
+}
+
+int play_batch() {
+    if (batch_threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        batch_threads = n > 0 ? (int) n : 1;
+    }
+    if (!batch_seed_set) {
+        batch_seed = (uint64_t) time(NULL);
+    }
+    struct game_result *results = malloc(sizeof(struct game_result) * batch_games);
+    if (results == NULL) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("Seed: %llu, Games: %d, Threads: %d\n",
+           (unsigned long long) batch_seed, batch_games, batch_threads);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (run_selfplay(batch_games, batch_threads, batch_seed, MAX_GAME_STEPS, &move_opts, results) != 0) {
+        fprintf(stderr, "无法启动批量对弈\n");
+        free(results);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    print_selfplay_stats(results, batch_games, elapsed);
+    if (tt_enabled()) {
+        print_tt_stats();
+    }
+    free(results);
+    return 0;
 }
 
 /*
@@ -139,10 +350,32 @@ int main(int argc, char *argv[]) {
         {"step",        no_argument, 0, 's'},
         {"twostep",     no_argument, 0, 't'},
         {"beam",        no_argument, 0, 'b'},
+        {"games",       required_argument, 0, 'g'},
+        {"threads",     required_argument, 0, 'j'},
+        {"seed",        required_argument, 0, 'S'},
+        {"search-threads", required_argument, 0, 'P'},
+        {"tt",          no_argument, 0, 'N'},
+        {"board",       required_argument, 0, 'G'},
+        {"reachable",   no_argument, 0, 'H'},
+        {"rollouts",    required_argument, 0, 'M'},
+        {"rollout-length", required_argument, 0, 'D'},
+        {"move-budget-us", required_argument, 0, 'B'},
+        {"pta",         no_argument, 0, 'p'},
+        {"weights",     required_argument, 0, 'W'},
+        {"beam-width",  required_argument, 0, 'w'},
+        {"profile",     required_argument, 0, 'F'},
+        {"pta-format",  required_argument, 0, 'R'},
+        {"no-board",    no_argument, 0, 'O'},
+        {"flush-every", required_argument, 0, 'E'},
+        {"pieces",      required_argument, 0, 'Q'},
+        {"record",      required_argument, 0, 'L'},
+        {"stats-every", required_argument, 0, 'Y'},
+        {"ponder",      no_argument, 0, 'V'},
+        {"serve",       required_argument, 0, 'U'},
         {0, 0, 0, 0}
     };
 
-    while ((opt = getopt_long(argc, argv, "haistb", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "haistbg:j:S:P:B:pW:w:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'h': show_help = 1; break;
             case 'a': auto_mode = 1; break;
@@ -150,6 +383,123 @@ int main(int argc, char *argv[]) {
             case 's': step_mode = 1; break;
             case 't': twostep_mode = 1; break;
             case 'b': beam_mode = 1; break;
+            case 'g':
+                batch_games = atoi(optarg);
+                if (batch_games < 1) {
+                    fprintf(stderr, "对局数必须为正整数\n");
+                    return 1;
+                }
+                break;
+            case 'j':
+                batch_threads = atoi(optarg);
+                if (batch_threads < 1) {
+                    fprintf(stderr, "线程数必须为正整数\n");
+                    return 1;
+                }
+                break;
+            case 'S':
+                batch_seed = strtoull(optarg, NULL, 0);
+                batch_seed_set = 1;
+                break;
+            case 'N': tt_set_enabled(1); break;
+            case 'H': move_opts.reachable = 1; break;
+            case 'M':
+                rollout_opts.playouts = atoi(optarg);
+                if (rollout_opts.playouts < 1) {
+                    fprintf(stderr, "推演局数必须为正整数\n");
+                    return 1;
+                }
+                move_opts.rollout = &rollout_opts;
+                break;
+            case 'D':
+                rollout_opts.length = atoi(optarg);
+                if (rollout_opts.length < 1 || rollout_opts.length > ROLLOUT_MAX_LENGTH) {
+                    fprintf(stderr, "推演步数必须为 1-%d 之间的整数\n", ROLLOUT_MAX_LENGTH);
+                    return 1;
+                }
+                break;
+            case 'G':
+                if (strcmp(optarg, "rows") == 0) {
+                    set_board_backend(BOARD_BACKEND_ROWS);
+                } else if (strcmp(optarg, "bitboard") == 0) {
+                    set_board_backend(BOARD_BACKEND_BITBOARD);
+                } else {
+                    fprintf(stderr, "未知的棋盘表示 %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p': pta_mode = 1; break;
+            case 'V': ponder_mode = 1; break;
+            case 'U': serve_path = optarg; break;
+            case 'B':
+                move_opts.budget_us = atoll(optarg);
+                if (move_opts.budget_us < 1) {
+                    fprintf(stderr, "每步思考时间必须为正整数（微秒）\n");
+                    return 1;
+                }
+                break;
+            case 'W':
+                if (load_eval_weights(optarg, &loaded_weights) != 0) {
+                    return 1;
+                }
+                move_opts.weights = &loaded_weights;
+                break;
+            case 'R':
+                if (strcmp(optarg, "text") == 0) {
+                    pta_format = PTA_FORMAT_TEXT;
+                } else if (strcmp(optarg, "token") == 0) {
+                    pta_format = PTA_FORMAT_TOKEN;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    pta_format = PTA_FORMAT_BINARY;
+                } else {
+                    fprintf(stderr, "未知的协议格式 %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'O': pta_no_board = 1; break;
+            case 'E':
+                pta_flush_every = atoi(optarg);
+                if (pta_flush_every < 0) {
+                    fprintf(stderr, "输出间隔必须为非负整数\n");
+                    return 1;
+                }
+                break;
+            case 'Q':
+                pieces_path = optarg;
+                pta_mode = 1;
+                break;
+            case 'L': record_path = optarg; break;
+            case 'Y':
+                stats_every = atol(optarg);
+                if (stats_every < 1) {
+                    fprintf(stderr, "计数输出间隔必须为正整数\n");
+                    return 1;
+                }
+                if (!search_stats_enabled()) {
+                    fprintf(stderr, "--stats-every 需要用 make STATS=1 编译\n");
+                    return 1;
+                }
+                break;
+            case 'F':
+                if (load_search_profile(optarg, &loaded_profile) != 0) {
+                    return 1;
+                }
+                profile_loaded = 1;
+                break;
+            case 'w':
+                move_opts.beam_width = atoi(optarg);
+                if (move_opts.beam_width < 1 || move_opts.beam_width > PLY_BEAM_MAX_WIDTH) {
+                    fprintf(stderr, "beam 宽度必须为 1-%d 之间的整数\n", PLY_BEAM_MAX_WIDTH);
+                    return 1;
+                }
+                break;
+            case 'P':
+                search_threads = atoi(optarg);
+                if (search_threads < 1) {
+                    fprintf(stderr, "搜索线程数必须为正整数\n");
+                    return 1;
+                }
+                break;
             default:
                 print_help(argv[0]);
                 return 1;
@@ -158,13 +508,58 @@ int main(int argc, char *argv[]) {
 
     // 互斥逻辑
     if (show_help) {
-        if (auto_mode || interactive_mode || step_mode || twostep_mode || beam_mode || optind < argc) {
+        if (auto_mode || interactive_mode || step_mode || twostep_mode || beam_mode || batch_games || optind < argc) {
             fprintf(stderr, "--help 不能与其他选项或参数同时使用\n");
             return 1;
         }
         print_help(argv[0]);
         return 0;
     }
+    if (batch_games && (pta_mode || move_opts.budget_us)) {
+        fprintf(stderr, "--games 不能与 --pta 或 --move-budget-us 同时使用\n");
+        return 1;
+    }
+    if (batch_threads && !batch_games && !serve_path) {
+        fprintf(stderr, "--threads 只能与 --games 或 --serve 一起使用\n");
+        return 1;
+    }
+    if (serve_path && (pta_mode || batch_games || record_path || ponder_mode || move_opts.reachable)) {
+        fprintf(stderr, "--serve 不能与 --pta、--pieces、--games、--record、--ponder 或 --reachable 同时使用\n");
+        return 1;
+    }
+    if (serve_path && search_threads > 1) {
+        // 各连接的搜索已经分给多个工作线程，单步搜索不再并行
+        fprintf(stderr, "--search-threads 不能与 --serve 同时使用\n");
+        return 1;
+    }
+    if (ponder_mode && (!pta_mode || pieces_path)) {
+        fprintf(stderr, "--ponder 只能用于从标准输入读取方块的 --pta\n");
+        return 1;
+    }
+    if ((batch_seed_set || record_path) && pta_mode) {
+        fprintf(stderr, "--seed 和 --record 不能与 --pta 同时使用\n");
+        return 1;
+    }
+    if (move_opts.reachable && (pta_mode || record_path)) {
+        // 评测协议和对局记录都只有旋转和列，只能表示硬降
+        fprintf(stderr, "--reachable 不能与 --pta 或 --record 同时使用\n");
+        return 1;
+    }
+    if (move_opts.rollout && record_path) {
+        // 对局记录不保存推演设置，回放时无法重现
+        fprintf(stderr, "--rollouts 不能与 --record 同时使用\n");
+        return 1;
+    }
+    if (move_opts.budget_us && record_path) {
+        // 限时搜索的结果取决于机器速度，回放时无法重现
+        fprintf(stderr, "--move-budget-us 不能与 --record 同时使用\n");
+        return 1;
+    }
+    rollout_opts.seed = batch_seed;
+    if (record_path && batch_games) {
+        fprintf(stderr, "--record 只能记录单局\n");
+        return 1;
+    }
     if (auto_mode && interactive_mode) {
         fprintf(stderr, "自动模式和交互模式不能同时指定\n");
         return 1;
@@ -177,13 +572,14 @@ int main(int argc, char *argv[]) {
     // 检查激进等级参数（可选，默认1）
     if (optind < argc) {
         level = atoi(argv[optind]);
-        if (level < 1 || level > 5) {
+        if (level < 1 || level > SEARCH_LEVELS) {
             fprintf(stderr, "激进等级必须为1-5之间的整数\n");
             return 1;
         }
     } else {
         level = 1;
     }
+    move_opts.profile = profile_loaded ? &loaded_profile : &SEARCH_PROFILES[level - 1];
 
     // 如果自动模式和交互模式都未指定，默认交互模式
     if (!auto_mode && !interactive_mode) {
@@ -196,6 +592,21 @@ int main(int argc, char *argv[]) {
     }
 
     // 这里可以根据模式和level调用不同的游戏逻辑
-    play_game();
+    if (batch_games) {
+        return play_batch();
+    }
+    if (serve_path) {
+        return play_serve();
+    }
+    if (search_threads > 1) {
+        // 线程池在整局游戏中复用，调用线程本身也参与计算
+        move_opts.pool = thread_pool_create(search_threads - 1);
+    }
+    if (pta_mode) {
+        play_game_pta();
+    } else {
+        play_game();
+    }
+    thread_pool_destroy(move_opts.pool);
     return 0;
 }
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "movegen.h"
+#include "bitboard.h"
+
+struct movegen_state {
+    int8_t rotation;
+    int8_t col;        // 从 0 开始，即 col - COL_SHIFT
+    int8_t row;
+};
+
+struct movegen {
+    const struct piece *piece;
+    struct bitboard board;
+    int8_t surface[MAX_ROTATIONS][COL];     // 硬降落点行，这一行及以上的位置都能从顶部直接到达
+    uint64_t mask[MAX_ROTATIONS][COL];
+    uint32_t seen[MAX_ROTATIONS][COL];      // 已入队的行（都在 surface 下方）
+    struct movegen_state queue[MAX_ROTATIONS * COL * ROW];
+    int head;
+    int tail;
+};
+
+static inline int col_limit(const struct movegen *m, int rotation) {
+    return COL - m->piece->rotations[rotation].width;
+}
+
+// (rotation, col, row) 在 surface 下方且不与棋盘相交时入队
+static inline void visit(struct movegen *m, int rotation, int col, int row) {
+    if (col < 0 || col > col_limit(m, rotation) || row < 0 || row >= m->surface[rotation][col]) {
+        return;
+    }
+    if (m->seen[rotation][col] & (1u << row)) {
+        return;
+    }
+    if (bitboard_collides(&m->board, m->mask[rotation][col], row)) {
+        return;
+    }
+    m->seen[rotation][col] |= 1u << row;
+    m->queue[m->tail++] = (struct movegen_state) { rotation, col, row };
+}
+
+// 从 (rotation, col, row) 平移或旋转一步
+static inline void visit_neighbours(struct movegen *m, int rotation, int col, int row) {
+    int count = m->piece->count;
+    visit(m, rotation, col - 1, row);
+    visit(m, rotation, col + 1, row);
+    if (count > 1) {
+        visit(m, (rotation + 1) % count, col, row);
+        visit(m, (rotation + count - 1) % count, col, row);
+    }
+}
+
+int generate_tucks(const struct tetris *t, int piece_index, struct placement *out) {
+    // 没有空洞时每列落点以下全被填满，不存在硬降以外的落点
+    if (t->holes == 0) {
+        return 0;
+    }
+
+    struct movegen m;
+    const struct piece *p = &pieces[piece_index];
+    m.piece = p;
+    m.head = 0;
+    m.tail = 0;
+    bitboard_from_tetris(&m.board, t);
+    memset(m.seen, 0, sizeof(m.seen));
+    for (int r = 0; r < p->count; r++) {
+        const struct rotation *rot = &p->rotations[r];
+        for (int c = 0; c <= col_limit(&m, r); c++) {
+            m.surface[r][c] = get_landing_row(t, rot, c + COL_SHIFT);
+            m.mask[r][c] = bitboard_piece_mask(rot, c + COL_SHIFT);
+        }
+    }
+
+    // 起点：从能直接到达的位置（surface 及以上）平移或旋转一步进入另一个位置的 surface 下方
+    for (int r = 0; r < p->count; r++) {
+        for (int c = 0; c <= col_limit(&m, r); c++) {
+            int top = m.surface[r][c];
+            for (int d = -1; d <= 1; d += 2) {
+                if (c + d >= 0 && c + d <= col_limit(&m, r)) {
+                    for (int y = top; y < m.surface[r][c + d]; y++) {
+                        visit(&m, r, c + d, y);
+                    }
+                }
+                int nr = (r + p->count + d) % p->count;
+                if (nr != r && c <= col_limit(&m, nr)) {
+                    for (int y = top; y < m.surface[nr][c]; y++) {
+                        visit(&m, nr, c, y);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t final[MAX_ROTATIONS][COL] = {{0}};
+    while (m.head < m.tail) {
+        struct movegen_state s = m.queue[m.head++];
+        if (s.row == 0 || bitboard_collides(&m.board, m.mask[s.rotation][s.col], s.row - 1)) {
+            // 再往下就会相交，方块停在这里；超出棋盘顶部的不算
+            if (s.row + p->rotations[s.rotation].height <= ROW) {
+                final[s.rotation][s.col] |= 1u << s.row;
+            }
+        } else {
+            visit(&m, s.rotation, s.col, s.row - 1);
+        }
+        visit_neighbours(&m, s.rotation, s.col, s.row);
+    }
+
+    int n = 0;
+    for (int r = 0; r < p->count; r++) {
+        for (int c = 0; c <= col_limit(&m, r); c++) {
+            for (uint32_t rows = final[r][c]; rows; rows &= rows - 1) {
+                out[n++] = (struct placement) { r, c + COL_SHIFT, __builtin_ctz(rows) };
+            }
+        }
+    }
+    return n;
+}
+
+int generate_placements(const struct tetris *t, int piece_index, struct placement *out) {
+    const struct piece *p = &pieces[piece_index];
+    int n = 0;
+    for (int r = 0; r < p->count; r++) {
+        const struct rotation *rot = &p->rotations[r];
+        for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+            int row = get_landing_row(t, rot, col);
+            if (row + rot->height <= ROW) {
+                out[n++] = (struct placement) { r, col, row };
+            }
+        }
+    }
+    return n + generate_tucks(t, piece_index, out + n);
+}
@@ -0,0 +1,24 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "tetris.h"
+
+// 考虑平移、软降和旋转的落点生成
+// 硬降只能让方块从棋盘上方竖直落下；方块在下落途中还可以左右平移、继续下移或原地旋转，
+// 从而塞进悬空方块的下面。这里在 (旋转, 列, 行) 状态上做广度优先搜索，碰撞检测用位棋盘（见 bitboard.h）。
+// 旋转没有踢墙：旋转前后包围盒的左下角不动，新位置与棋盘相交就转不过去。
+//
+// 硬降落点及其上方的位置都可以从顶部直接到达，搜索只从与这片区域相邻、位于某个落点下方的位置出发，
+// 所以没有空洞（没有悬空方块）的棋盘不做任何搜索。
+
+// 一个方块最多的落点数（每个旋转、每列、每行各一个）
+#define MAX_REACHABLE_PLACEMENTS (MAX_ROTATIONS * COL * ROW)
+
+// 硬降到不了、但经平移、软降、旋转可以到达的合法落点，按旋转、列、行的顺序写入 out，每个落点只出现一次，返回个数
+int generate_tucks(const struct tetris *t, int piece_index, struct placement *out);
+
+// 全部可到达的合法落点：先是硬降落点（按旋转、列的顺序，与 score_placements() 相同，跳过越界的），
+// 再接 generate_tucks() 的结果，返回个数
+int generate_placements(const struct tetris *t, int piece_index, struct placement *out);
+
+#endif // MOVEGEN_H
@@ -0,0 +1,150 @@
+#include <string.h>
+#include "placement_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+int placement_simd_supported(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+// 取出 v 中每个 32 位元素的第 pos 位（pos 越界时为 0，与标量版 get_status 在 -1 列的结果相同）
+__attribute__((target("avx2")))
+static inline __m256i bit_at(__m256i v, __m256i pos) {
+    return _mm256_and_si256(_mm256_srlv_epi32(v, pos), _mm256_set1_epi32(1));
+}
+
+// 把 32 位元素截断成 int8_t 再符号扩展，模拟标量版计数器的回绕
+__attribute__((target("avx2")))
+static inline __m256i wrap_int8(__m256i v) {
+    return _mm256_srai_epi32(_mm256_slli_epi32(v, 24), 24);
+}
+
+__attribute__((target("avx2")))
+int placement_features_avx2(const struct tetris *t, const struct rotation *rot, struct placement_features *f) {
+    // rows[0] 是 board[-1]（全满的填充行），rows[r+1] 是 board[r]，上方多留几行空行供 gather 越界读取
+    int32_t rows[32];
+    int32_t heights[32] = {0};
+    int32_t colbits[32] = {0};    // 按列转置的棋盘，第 r+1 位表示 board[r] 在该列有方块，第 0 位为填充行
+    rows[0] = t->pad0;
+    for (int r = 0; r < ROW; r++) {
+        rows[r + 1] = t->board[r];
+    }
+    for (int r = ROW + 1; r < 32; r++) {
+        rows[r] = EMPTY_ROW;
+    }
+    for (int c = 0; c < COL + 2 * COL_SHIFT; c++) {
+        heights[c] = t->col_height[c];
+    }
+    for (int c = 0; c < 16; c++) {
+        int32_t bits = 1;
+        for (int r = 0; r < ROW; r++) {
+            bits |= ((t->board[r] >> c) & 1) << (r + 1);
+        }
+        colbits[c] = bits;
+    }
+
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int last_col = COL_SHIFT + COL - rot->width;
+    int count = last_col - COL_SHIFT + 1;
+    f->needs_scalar = 0;
+
+    // 每 8 列一组，col = c0 + lane
+    for (int c0 = COL_SHIFT; c0 <= last_col; c0 += 8) {
+        __m256i col = _mm256_add_epi32(_mm256_set1_epi32(c0), lane);
+
+        // 落点行：各列高度减去方块该列底部偏移后的最大值
+        __m256i landing = _mm256_setzero_si256();
+        for (int i = 0; i < rot->width; i++) {
+            __m256i h = _mm256_loadu_si256((const __m256i *) &heights[c0 + i]);
+            landing = _mm256_max_epi32(landing, _mm256_sub_epi32(h, _mm256_set1_epi32(rot->vstart[i])));
+        }
+        __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(ROW + 1),
+                                           _mm256_add_epi32(landing, _mm256_set1_epi32(rot->height)));
+
+        // 方块覆盖的每一行：行转换与井的增量，以及是否填满
+        __m256i row_trans = _mm256_set1_epi32(t->row_transitions);
+        __m256i wells = _mm256_set1_epi32(t->wells);
+        __m256i full = _mm256_setzero_si256();
+        for (int k = 0; k < rot->height; k++) {
+            __m256i idx = _mm256_add_epi32(landing, _mm256_set1_epi32(k + 1));
+            __m256i b = _mm256_i32gather_epi32(rows, idx, 4);
+            __m256i placed = _mm256_or_si256(b, _mm256_sllv_epi32(_mm256_set1_epi32(rot->shape[k]), col));
+            full = _mm256_or_si256(full, _mm256_cmpeq_epi32(placed, _mm256_set1_epi32(FULL_ROW)));
+
+            //   s1 s2 XXX s3 s4
+            __m256i cs = _mm256_add_epi32(col, _mm256_set1_epi32(rot->hstart[k]));
+            __m256i ce = _mm256_add_epi32(cs, _mm256_set1_epi32(rot->hspan[k]));
+            __m256i s1 = bit_at(b, _mm256_sub_epi32(cs, _mm256_set1_epi32(2)));
+            __m256i s2 = bit_at(b, _mm256_sub_epi32(cs, one));
+            __m256i s3 = bit_at(b, ce);
+            __m256i s4 = bit_at(b, _mm256_add_epi32(ce, one));
+            __m256i both = _mm256_and_si256(s2, s3);
+            __m256i none = _mm256_xor_si256(_mm256_or_si256(s2, s3), one);
+            row_trans = _mm256_add_epi32(row_trans, _mm256_sub_epi32(none, both));
+            wells = _mm256_add_epi32(wells, _mm256_andnot_si256(s2, s1));
+            wells = _mm256_add_epi32(wells, _mm256_andnot_si256(s3, s4));
+            if (rot->hspan[k] == 1) {
+                wells = _mm256_sub_epi32(wells, both);
+            }
+        }
+
+        // 方块覆盖的每一列：下方是否悬空，悬空时向下数空格直到遇到方块
+        __m256i holes = _mm256_set1_epi32(t->holes);
+        __m256i col_trans = _mm256_set1_epi32(t->col_transitions);
+        for (int i = 0; i < rot->width; i++) {
+            __m256i pos = _mm256_add_epi32(landing, _mm256_set1_epi32(rot->vstart[i]));   // 下方格子的 rows 下标
+            __m256i b = _mm256_i32gather_epi32(rows, pos, 4);
+            __m256i empty = _mm256_xor_si256(bit_at(b, _mm256_add_epi32(col, _mm256_set1_epi32(i))), one);
+            col_trans = _mm256_add_epi32(col_trans, empty);
+
+            // 该列在 pos 及以下最高的方块位置：用浮点转换求最高位
+            __m256i bits = _mm256_loadu_si256((const __m256i *) &colbits[c0 + i]);
+            __m256i below = _mm256_sub_epi32(_mm256_sllv_epi32(_mm256_set1_epi32(2), pos), one);
+            __m256i m = _mm256_and_si256(bits, below);
+            __m256i top = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(m)), 23),
+                                           _mm256_set1_epi32(127));
+            __m256i run = _mm256_sub_epi32(pos, top);
+            holes = _mm256_add_epi32(holes, _mm256_mullo_epi32(run, empty));
+        }
+
+        int32_t out_landing[8], out_holes[8], out_rt[8], out_ct[8], out_wells[8];
+        __m256i invalid = _mm256_xor_si256(valid, _mm256_set1_epi32(-1));
+        _mm256_storeu_si256((__m256i *) out_landing, _mm256_or_si256(landing, invalid));   // 越界记为 -1
+        _mm256_storeu_si256((__m256i *) out_holes, wrap_int8(holes));
+        _mm256_storeu_si256((__m256i *) out_rt, wrap_int8(row_trans));
+        _mm256_storeu_si256((__m256i *) out_ct, wrap_int8(col_trans));
+        _mm256_storeu_si256((__m256i *) out_wells, wrap_int8(wells));
+        int full_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(full, valid)));
+
+        for (int l = 0; l < 8 && c0 + l <= last_col; l++) {
+            int i = c0 + l - COL_SHIFT;
+            f->landing_row[i] = (int8_t) out_landing[l];
+            f->holes[i] = (int8_t) out_holes[l];
+            f->row_transitions[i] = (int8_t) out_rt[l];
+            f->col_transitions[i] = (int8_t) out_ct[l];
+            f->wells[i] = (int8_t) out_wells[l];
+            if (full_mask & (1 << l)) {
+                f->needs_scalar |= 1 << i;
+            }
+        }
+    }
+    return count;
+}
+
+#else
+
+int placement_simd_supported(void) {
+    return 0;
+}
+
+int placement_features_avx2(const struct tetris *t, const struct rotation *rot, struct placement_features *f) {
+    (void) t;
+    (void) rot;
+    (void) f;
+    return 0;
+}
+
+#endif
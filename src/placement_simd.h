@@ -0,0 +1,28 @@
+#ifndef PLACEMENT_SIMD_H
+#define PLACEMENT_SIMD_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// 向量化落点内核
+// 对某个方块的一个旋转角度，一次算出所有列上落下后的特征（落点行、空洞、行/列转换、井），
+// 与逐列调用 place_piece() 得到的计数完全一致。
+// 会消行的列不在内核里处理，只在 needs_scalar 中标出，由调用者退回到标量路径。
+
+struct placement_features {
+    int8_t landing_row[COL];       // 第 i 项对应 col = COL_SHIFT + i，-1 表示越界
+    int8_t holes[COL];
+    int8_t row_transitions[COL];
+    int8_t col_transitions[COL];
+    int8_t wells[COL];
+    uint16_t needs_scalar;         // 第 i 位为 1 表示该列落下后会消行
+};
+
+// CPU 支持 AVX2 时返回 1
+int placement_simd_supported(void);
+
+// 计算 col = COL_SHIFT .. COL_SHIFT+COL-rot->width 各列的特征，返回列数
+// 只能在 placement_simd_supported() 返回 1 时调用
+int placement_features_avx2(const struct tetris *t, const struct rotation *rot, struct placement_features *f);
+
+#endif // PLACEMENT_SIMD_H
@@ -0,0 +1,166 @@
+#define _GNU_SOURCE     // SCHED_IDLE
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ponder.h"
+
+struct ponder {
+    const struct move_options *options;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    // 以下字段都由 lock 保护
+    struct tetris board;
+    int curr_piece;
+    int running;                     // 还有方块要算
+    int pending;                     // ponder_start() 之后还没有取过结果
+    int busy;                        // 后台线程正在搜索
+    int quit;
+    int wanted;                      // 主线程等待的方块，-1 表示还没有
+    unsigned done;                   // 第 i 位表示 result[i] 已算出
+    struct placement result[PIECE_TYPES];
+    int depth[PIECE_TYPES];
+    long ready;
+    long waited;
+};
+
+// 取下一个要算的方块：主线程等待的方块优先，没有时按编号顺序；没有要算的返回 -1
+static int next_job(struct ponder *p) {
+    if (p->wanted >= 0) {
+        return (p->done & (1u << p->wanted)) ? -1 : p->wanted;
+    }
+    for (int i = 0; i < PIECE_TYPES; i++) {
+        if (!(p->done & (1u << i))) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *ponder_main(void *arg) {
+    struct ponder *p = arg;
+#ifdef SCHED_IDLE
+    // 只用空闲的 CPU：评测程序和主线程一旦可以运行就让给它们，否则单核上对方要等几毫秒才能读到输出
+    struct sched_param param = { 0 };
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+    pthread_mutex_lock(&p->lock);
+    while (!p->quit) {
+        int piece = p->running ? next_job(p) : -1;
+        if (piece < 0) {
+            p->running = 0;
+            pthread_cond_broadcast(&p->cond);
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        struct tetris t = p->board;
+        int curr = p->curr_piece;
+        p->busy = 1;
+        pthread_mutex_unlock(&p->lock);
+
+        struct placement best = { 0, 0, 0 };
+        int depth = select_game_placement(&t, curr, piece, p->options, &best);
+
+        pthread_mutex_lock(&p->lock);
+        p->busy = 0;
+        p->result[piece] = best;
+        p->depth[piece] = depth;
+        p->done |= 1u << piece;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+struct ponder *ponder_create(const struct move_options *options) {
+    struct ponder *p = calloc(1, sizeof(struct ponder));
+    if (p == NULL) {
+        return NULL;
+    }
+    p->options = options;
+    p->wanted = -1;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    if (pthread_create(&p->thread, NULL, ponder_main, p) != 0) {
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->cond);
+        free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void ponder_destroy(struct ponder *p) {
+    if (p == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&p->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    pthread_join(p->thread, NULL);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->cond);
+    free(p);
+}
+
+// 调用时持有 lock：不再开始新的计算，等正在进行的搜索结束
+static void stop_locked(struct ponder *p) {
+    p->running = 0;
+    p->pending = 0;
+    while (p->busy) {
+        pthread_cond_wait(&p->cond, &p->lock);
+    }
+}
+
+void ponder_start(struct ponder *p, const struct tetris *t, int curr_piece) {
+    pthread_mutex_lock(&p->lock);
+    stop_locked(p);
+    p->board = *t;
+    p->curr_piece = curr_piece;
+    p->wanted = -1;
+    p->done = 0;
+    p->running = 1;
+    p->pending = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+int ponder_pending(const struct ponder *p) {
+    // 只有主线程改动 pending，读取不必加锁
+    return p->pending;
+}
+
+int ponder_take(struct ponder *p, int next_piece, struct placement *best) {
+    pthread_mutex_lock(&p->lock);
+    if (p->done & (1u << next_piece)) {
+        p->ready++;
+    } else {
+        p->waited++;
+        p->wanted = next_piece;
+        p->running = 1;
+        pthread_cond_broadcast(&p->cond);
+        while (!(p->done & (1u << next_piece))) {
+            pthread_cond_wait(&p->cond, &p->lock);
+        }
+    }
+    *best = p->result[next_piece];
+    int depth = p->depth[next_piece];
+    // 不等后台线程停下就返回，正在进行的搜索在下一次 ponder_start() 或 ponder_stop() 时等待
+    p->running = 0;
+    p->pending = 0;
+    pthread_mutex_unlock(&p->lock);
+    return depth;
+}
+
+void ponder_stop(struct ponder *p) {
+    pthread_mutex_lock(&p->lock);
+    stop_locked(p);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void ponder_get_stats(const struct ponder *p, long *ready, long *waited) {
+    *ready = p->ready;
+    *waited = p->waited;
+}
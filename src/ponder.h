@@ -0,0 +1,33 @@
+#ifndef PONDER_H
+#define PONDER_H
+
+#include "tetris.h"
+#include "selfplay.h"
+
+// 等待输入时的预先搜索
+// PTA 协议下输出一步之后要等评测程序给出下一个方块，这段时间 CPU 空闲。
+// 此时当前方块已知、下一个方块未知，后台线程依次为 7 种可能的下一个方块各算一步落点；
+// 方块到达后直接取出对应的结果，没算完的话后台线程先算这一种。
+//
+// 同一时刻只有一个线程在搜索：后台线程工作时主线程只读输入，主线程自己搜索之前须先调用 ponder_stop()，
+// 所以 move_options 中的线程池可以由两者共用。
+
+struct ponder;
+
+// options 在 ponder 的整个生命周期内须保持有效；失败返回 NULL
+struct ponder *ponder_create(const struct move_options *options);
+void ponder_destroy(struct ponder *p);
+
+// 复制局面 t，开始在后台为 curr_piece 之后每种可能的下一个方块计算落点；上一次的任务先停下并丢弃
+void ponder_start(struct ponder *p, const struct tetris *t, int curr_piece);
+// ponder_start() 之后是否还没有取过结果
+int  ponder_pending(const struct ponder *p);
+// 取出下一个方块为 next_piece 时的落点，返回搜索深度；还没算出时等后台线程算完。之后后台线程不再开始新的计算
+int  ponder_take(struct ponder *p, int next_piece, struct placement *best);
+// 停下后台计算并等它空闲，丢弃结果
+void ponder_stop(struct ponder *p);
+
+// 累计：取结果时已经算好的次数、需要等待的次数
+void ponder_get_stats(const struct ponder *p, long *ready, long *waited);
+
+#endif // PONDER_H
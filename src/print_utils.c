@@ -1,18 +1,26 @@
 #include <stdio.h>
 #include "print_utils.h"
 
-void print_board(const struct tetris *t) {
+// 整块棋盘先拼成一个字符串再一次写出，比逐格 printf 快得多
+size_t format_board(char *buf, const struct tetris *t) {
+    char *p = buf;
     for (int i = ROW - 1; i >= 0; i--) {
         for (int j = COL_SHIFT; j < COL + COL_SHIFT; j++) {
-            if (t->board[i] & (1 << j)) {
-                printf("%c", FULL_CHAR);
-            } else {
-                printf("%c", EMPTY_CHAR);
-            }
+            *p++ = (t->board[i] & (1 << j)) ? FULL_CHAR : EMPTY_CHAR;
         }
-        printf("\n");
+        *p++ = '\n';
     }
-    printf("\n");
+    *p++ = '\n';
+    return p - buf;
+}
+
+void write_board(FILE *out, const struct tetris *t) {
+    char text[BOARD_TEXT_MAX];
+    fwrite(text, 1, format_board(text, t), out);
+}
+
+void print_board(const struct tetris *t) {
+    write_board(stdout, t);
 }
 
 void print_piece(const struct piece *p, int rotation) {
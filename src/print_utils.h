@@ -1,9 +1,14 @@
 #ifndef PRINT_UTILS_H
 #define PRINT_UTILS_H
 
+#include <stdio.h>
 #include "tetris.h"
 
 void print_board(const struct tetris *t);
+// 棋盘的文本形式写入 buf，顶行在前，末尾多一个空行；返回写入的字节数（不超过 BOARD_TEXT_MAX，不加结尾的 0）
+#define BOARD_TEXT_MAX (ROW * (COL + 1) + 1)
+size_t format_board(char *buf, const struct tetris *t);
+void write_board(FILE *out, const struct tetris *t);
 void print_piece(const struct piece *p, int rotation);
 void print_pieces_side_by_side(int col, const struct piece *p1, int rot1, const struct piece *p2, int rot2);
 
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+#define ALL_WIDTHS(w) { w, w, w, w, w, w }
+
+const struct search_profile SEARCH_PROFILES[SEARCH_LEVELS] = {
+    // 1: 低局面看两步，高局面三步并只防 S、Z
+    { 2, {
+        { 13, 2, SEARCH_MINMAX, PIECE_MASK_ALL, { BEAM_WIDTH, 0 }, 0 },
+        { ROW, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(BEAM_WIDTH), 0 },
+    } },
+    // 2: 同上，各层 beam 加宽
+    { 2, {
+        { 13, 2, SEARCH_MINMAX, PIECE_MASK_ALL, { 6, 0 }, 0 },
+        { ROW, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(6), 0 },
+    } },
+    // 3: 中等高度就开始三步搜索，高局面 beam 加宽
+    { 3, {
+        { 10, 2, SEARCH_MINMAX, PIECE_MASK_ALL, { BEAM_WIDTH, 0 }, 0 },
+        { 13, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(BEAM_WIDTH), 0 },
+        { ROW, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(8), 0 },
+    } },
+    // 4: 高局面改用整层 beam
+    { 3, {
+        { 10, 2, SEARCH_MINMAX, PIECE_MASK_ALL, { BEAM_WIDTH, 0 }, 0 },
+        { 13, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(BEAM_WIDTH), 0 },
+        { ROW, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(BEAM_WIDTH), 64 },
+    } },
+    // 5: 中高局面都用整层 beam，越高越宽
+    { 3, {
+        { 8, 2, SEARCH_MINMAX, PIECE_MASK_ALL, { BEAM_WIDTH, 0 }, 0 },
+        { 13, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(BEAM_WIDTH), 64 },
+        { ROW, 3, SEARCH_MINMAX, PIECE_MASK_SZ, ALL_WIDTHS(BEAM_WIDTH), 256 },
+    } },
+};
+
+const struct search_tier *search_profile_tier(const struct search_profile *profile, int height) {
+    for (int i = 0; i < profile->tier_count - 1; i++) {
+        if (height < profile->tiers[i].below) {
+            return &profile->tiers[i];
+        }
+    }
+    return &profile->tiers[profile->tier_count - 1];
+}
+
+void search_tier_policy(const struct search_tier *tier, struct search_policy *policy) {
+    memset(policy, 0, sizeof(*policy));
+    policy->mode = tier->mode;
+    policy->piece_mask = tier->piece_mask;
+    memcpy(policy->beam_width, tier->beam_width, sizeof(policy->beam_width));
+    policy->ply_beam_width = tier->ply_beam_width;
+}
+
+// 解析 "all" 或由方块字母组成的集合，失败返回 -1
+static int parse_piece_mask(const char *s) {
+    if (strcmp(s, "all") == 0) {
+        return PIECE_MASK_ALL;
+    }
+    int mask = 0;
+    for (; *s; s++) {
+        int p = get_piece_index((unsigned char) *s);
+        if (p < 0) {
+            return -1;
+        }
+        mask |= 1 << p;
+    }
+    return mask ? mask : -1;
+}
+
+// 解析一行 tier，失败返回 -1
+static int parse_tier(char *line, struct search_tier *tier) {
+    memset(tier, 0, sizeof(*tier));
+    tier->mode = SEARCH_MINMAX;
+    tier->piece_mask = PIECE_MASK_ALL;
+
+    char *save;
+    char *tok = strtok_r(line, " \t\n", &save);
+    if (tok == NULL || strcmp(tok, "tier") != 0) {
+        return -1;
+    }
+    tok = strtok_r(NULL, " \t\n", &save);
+    if (tok == NULL || (tier->below = atoi(tok)) < 1) {
+        return -1;
+    }
+    char *key;
+    while ((key = strtok_r(NULL, " \t\n", &save)) != NULL) {
+        char *value = strtok_r(NULL, " \t\n", &save);
+        if (value == NULL) {
+            return -1;
+        }
+        if (strcmp(key, "depth") == 0) {
+            tier->depth = atoi(value);
+        } else if (strcmp(key, "mode") == 0) {
+            if (strcmp(value, "minmax") == 0) {
+                tier->mode = SEARCH_MINMAX;
+            } else if (strcmp(value, "expectimax") == 0) {
+                tier->mode = SEARCH_EXPECTIMAX;
+            } else {
+                return -1;
+            }
+        } else if (strcmp(key, "pieces") == 0) {
+            if ((tier->piece_mask = parse_piece_mask(value)) < 0) {
+                return -1;
+            }
+        } else if (strcmp(key, "beam") == 0) {
+            char *wsave;
+            char *w = strtok_r(value, ",", &wsave);
+            for (int i = 0; w != NULL; i++, w = strtok_r(NULL, ",", &wsave)) {
+                if (i >= MAX_SEARCH_DEPTH || (tier->beam_width[i] = atoi(w)) < 0) {
+                    return -1;
+                }
+            }
+        } else if (strcmp(key, "ply_beam") == 0) {
+            tier->ply_beam_width = atoi(value);
+            if (tier->ply_beam_width < 0 || tier->ply_beam_width > PLY_BEAM_MAX_WIDTH) {
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+    return (tier->depth >= 1 && tier->depth <= MAX_SEARCH_DEPTH) ? 0 : -1;
+}
+
+int load_search_profile(const char *path, struct search_profile *profile) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    struct search_profile loaded;
+    loaded.tier_count = 0;
+
+    char line[256];
+    int lineno = 0, ret = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        if (loaded.tier_count == PROFILE_MAX_TIERS) {
+            fprintf(stderr, "%s:%d: 档位太多，最多 %d 档\n", path, lineno, PROFILE_MAX_TIERS);
+            ret = -1;
+            break;
+        }
+        char copy[256];
+        strcpy(copy, p);
+        struct search_tier *tier = &loaded.tiers[loaded.tier_count];
+        if (parse_tier(p, tier) != 0) {
+            fprintf(stderr, "%s:%d: 无法解析: %s", path, lineno, copy);
+            ret = -1;
+            break;
+        }
+        if (loaded.tier_count > 0 && tier->below <= loaded.tiers[loaded.tier_count - 1].below) {
+            fprintf(stderr, "%s:%d: 各档的高度必须从小到大排列\n", path, lineno);
+            ret = -1;
+            break;
+        }
+        loaded.tier_count++;
+    }
+    fclose(f);
+    if (ret == 0 && loaded.tier_count == 0) {
+        fprintf(stderr, "%s: 没有任何档位\n", path);
+        ret = -1;
+    }
+    if (ret == 0) {
+        *profile = loaded;
+    }
+    return ret;
+}
+
+void write_search_profile(FILE *out, const struct search_profile *profile) {
+    for (int i = 0; i < profile->tier_count; i++) {
+        const struct search_tier *tier = &profile->tiers[i];
+        fprintf(out, "tier %d depth %d mode %s pieces ", tier->below, tier->depth,
+                tier->mode == SEARCH_EXPECTIMAX ? "expectimax" : "minmax");
+        if (tier->piece_mask == PIECE_MASK_ALL) {
+            fprintf(out, "all");
+        } else {
+            for (int p = 0; p < PIECE_TYPES; p++) {
+                if (tier->piece_mask & (1 << p)) {
+                    fputc(get_piece_name(p), out);
+                }
+            }
+        }
+        fprintf(out, " beam ");
+        for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+            fprintf(out, d ? ",%d" : "%d", tier->beam_width[d]);
+        }
+        if (tier->ply_beam_width > 0) {
+            fprintf(out, " ply_beam %d", tier->ply_beam_width);
+        }
+        fputc('\n', out);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include "tetris.h"
+
+// 搜索配置：按局面高度分档，每档给出固定深度搜索的深度、未知方块的合并方式、
+// 考虑的方块集合、逐层 beam 宽度和整层 beam 宽度。
+// 局面的最高行小于某档的 below 时使用该档，按顺序取第一个满足的档位，都不满足时用最后一档。
+//
+// 配置文件为文本，每行一档，# 开头的行为注释，例如（即内置的等级 1）：
+//   tier 13 depth 2 mode minmax pieces all beam 4
+//   tier 20 depth 3 mode minmax pieces SZ beam 4,4,4,4,4,4
+// depth 以外的字段都可以省略：mode 默认 minmax，pieces 默认 all，beam 默认全部展开，ply_beam 默认 0（不用整层 beam）
+
+#define PROFILE_MAX_TIERS  8
+#define SEARCH_LEVELS      5
+
+struct search_tier {
+    int below;                           // 适用于 max_height < below 的局面
+    int depth;                           // 搜索步数，1 到 MAX_SEARCH_DEPTH
+    enum search_mode mode;
+    int piece_mask;
+    int beam_width[MAX_SEARCH_DEPTH];
+    int ply_beam_width;
+};
+
+struct search_profile {
+    int tier_count;
+    struct search_tier tiers[PROFILE_MAX_TIERS];
+};
+
+// 内置配置，SEARCH_PROFILES[level - 1] 对应命令行的激进等级；等级越高每步搜索越多
+// 等级 1 与原来写死的策略相同：低局面两步，高局面三步并只防 S 和 Z
+extern const struct search_profile SEARCH_PROFILES[SEARCH_LEVELS];
+
+// 取局面高度 height 对应的档位
+const struct search_tier *search_profile_tier(const struct search_profile *profile, int height);
+
+// 按档位填写搜索策略，pool 和 weights 保持为空
+void search_tier_policy(const struct search_tier *tier, struct search_policy *policy);
+
+// 成功返回 0；文件无法打开、格式错误或取值越界时返回 -1 并在 stderr 说明原因
+int  load_search_profile(const char *path, struct search_profile *profile);
+void write_search_profile(FILE *out, const struct search_profile *profile);
+
+#endif // PROFILE_H
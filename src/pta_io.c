@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pta_io.h"
+#include "print_utils.h"
+
+// 字节到方块的映射，text/token 与 binary 各一张
+static signed char token_table[256];
+static signed char binary_table[256];
+static int tables_ready = 0;
+
+static void init_tables(void) {
+    if (tables_ready) {
+        return;
+    }
+    memset(token_table, PIECE_INVALID, sizeof(token_table));
+    memset(binary_table, PIECE_INVALID, sizeof(binary_table));
+    for (int i = 0; i < PIECE_TYPES; i++) {
+        token_table[get_piece_name(i)] = i;
+        binary_table[i] = i;
+    }
+    token_table['X'] = PIECE_END;
+    token_table['!'] = PIECE_FLUSH;
+    binary_table[7] = PIECE_END;
+    binary_table[8] = PIECE_FLUSH;
+    tables_ready = 1;
+}
+
+static void reader_init(struct piece_reader *r, enum pta_format format) {
+    init_tables();
+    r->format = format;
+    r->data = NULL;
+    r->len = 0;
+    r->pos = 0;
+    r->fd = -1;
+    r->map = NULL;
+    r->map_len = 0;
+    r->before_block = NULL;
+    r->before_block_arg = NULL;
+}
+
+int piece_reader_open_fd(struct piece_reader *r, int fd, enum pta_format format) {
+    reader_init(r, format);
+    r->fd = fd;
+    r->data = r->buf;
+    return 0;
+}
+
+int piece_reader_open_file(struct piece_reader *r, const char *path, enum pta_format format) {
+    reader_init(r, format);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        r->map = map;
+        r->map_len = st.st_size;
+        r->data = map;
+        r->len = st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+// 缓冲读完后从文件描述符补充数据，没有更多数据时返回 0
+static int reader_fill(struct piece_reader *r) {
+    if (r->fd < 0) {
+        return 0;
+    }
+    if (r->before_block) {
+        struct pollfd pfd = { r->fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 0) == 0) {
+            r->before_block(r->before_block_arg);
+        }
+    }
+    ssize_t n;
+    do {
+        n = read(r->fd, r->buf, sizeof(r->buf));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        if (n < 0) {
+            perror("read");
+        }
+        return 0;
+    }
+    r->len = n;
+    r->pos = 0;
+    return 1;
+}
+
+int piece_reader_next(struct piece_reader *r) {
+    const signed char *table = r->format == PTA_FORMAT_BINARY ? binary_table : token_table;
+    while (1) {
+        if (r->pos == r->len && !reader_fill(r)) {
+            return PIECE_EOF;
+        }
+        unsigned char c = r->data[r->pos++];
+        if (r->format != PTA_FORMAT_BINARY && (c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
+            continue;
+        }
+        return table[c];
+    }
+}
+
+int piece_decode(enum pta_format format, unsigned char c) {
+    init_tables();
+    if (format == PTA_FORMAT_BINARY) {
+        return binary_table[c];
+    }
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        return PIECE_SKIP;
+    }
+    return token_table[c];
+}
+
+void piece_reader_close(struct piece_reader *r) {
+    if (r->map) {
+        munmap(r->map, r->map_len);
+        r->map = NULL;
+    }
+}
+
+size_t move_format(char *buf, enum pta_format format, int boards, const struct tetris *t,
+                   int rotation, int col, int score) {
+    size_t n = 0;
+    switch (format) {
+        case PTA_FORMAT_TEXT:
+            if (boards) {
+                n = format_board(buf, t);
+            }
+            n += sprintf(buf + n, "%d %d\n%d\n", rotation * 90, col - COL_SHIFT, score);
+            break;
+        case PTA_FORMAT_TOKEN:
+            if (boards) {
+                n = format_board(buf, t);
+            }
+            n += sprintf(buf + n, "%d %d %d\n", rotation * 90, col - COL_SHIFT, score);
+            break;
+        case PTA_FORMAT_BINARY:
+            buf[n++] = (char) (rotation << 4 | (col - COL_SHIFT));
+            break;
+    }
+    return n;
+}
+
+void move_writer_put(struct move_writer *w, const struct tetris *t, int rotation, int col, int score) {
+    char text[MOVE_TEXT_MAX + 1];    // sprintf 写入结尾的 0
+    fwrite(text, 1, move_format(text, w->format, w->boards, t, rotation, col, score), w->out);
+    if (++w->pending == w->flush_every) {
+        move_writer_flush(w);
+    }
+}
+
+void move_writer_flush(struct move_writer *w) {
+    fflush(w->out);
+    w->pending = 0;
+}
@@ -0,0 +1,76 @@
+#ifndef PTA_IO_H
+#define PTA_IO_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "tetris.h"
+
+// PTA 评测协议的输入输出
+//
+// 输入格式：
+//   text / token  方块字母 I T O J L S Z 依次排列，空白字符（包括换行）忽略；X 表示序列结束，
+//                 ! 请求立即输出已缓冲的结果。原来“首行两个字母、之后每行一个字母”的输入是它的特例
+//   binary        每个字节一个方块，0-6 为 pieces[] 的下标，7 表示结束，8 请求立即输出
+//
+// 输出格式（每步一条）：
+//   text    可选的棋盘，然后“角度 列”和“总分”各一行（原来的格式）
+//   token   可选的棋盘，然后一行“角度 列 总分”
+//   binary  一个字节：rotation << 4 | (col - COL_SHIFT)，没有棋盘和分数
+
+enum pta_format {
+    PTA_FORMAT_TEXT,
+    PTA_FORMAT_TOKEN,
+    PTA_FORMAT_BINARY,
+};
+
+// piece_reader_next() 除方块下标外的返回值
+#define PIECE_END      (-1)    // 序列结束（X 或 7）
+#define PIECE_INVALID  (-2)    // 无法识别的字符
+#define PIECE_FLUSH    (-3)    // 请求输出缓冲
+#define PIECE_EOF      (-4)    // 输入在序列结束前就没有了
+#define PIECE_SKIP     (-5)    // piece_decode()：可以忽略的空白字符
+#define PIECE_NEED_INPUT (-6)  // 服务端：缓冲中没有完整的方块，等待更多输入
+
+#define PIECE_READER_BUF 4096
+
+struct piece_reader {
+    enum pta_format format;
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+    int fd;                         // 从文件描述符流式读入；整个文件映射到内存时为 -1
+    void *map;
+    size_t map_len;
+    void (*before_block)(void *arg);    // 输入暂时没有数据、即将阻塞时调用，用来及时输出缓冲的结果
+    void *before_block_arg;
+    unsigned char buf[PIECE_READER_BUF];
+};
+
+// 成功返回 0；失败返回 -1 并在 stderr 说明原因
+int  piece_reader_open_fd(struct piece_reader *r, int fd, enum pta_format format);
+// 把整个方块序列文件映射到内存中读取，用于离线回放很长的序列
+int  piece_reader_open_file(struct piece_reader *r, const char *path, enum pta_format format);
+int  piece_reader_next(struct piece_reader *r);
+void piece_reader_close(struct piece_reader *r);
+
+// 不经过 piece_reader 逐字节解码，用于自己管理缓冲的调用者（如 server.c）；
+// 返回方块下标或 PIECE_END、PIECE_FLUSH、PIECE_INVALID、PIECE_SKIP
+int  piece_decode(enum pta_format format, unsigned char c);
+
+// 一步的输出写入 buf，返回字节数（不超过 MOVE_TEXT_MAX，不加结尾的 0）
+#define MOVE_TEXT_MAX (ROW * (COL + 1) + 1 + 48)
+size_t move_format(char *buf, enum pta_format format, int boards, const struct tetris *t,
+                   int rotation, int col, int score);
+
+struct move_writer {
+    FILE *out;
+    enum pta_format format;
+    int boards;                     // 非 0 时每步输出棋盘（binary 格式不输出）
+    int flush_every;                // 每这么多步输出一次缓冲，0 表示只在请求、输入阻塞和结束时输出
+    int pending;                    // 尚未输出的步数
+};
+
+void move_writer_put(struct move_writer *w, const struct tetris *t, int rotation, int col, int score);
+void move_writer_flush(struct move_writer *w);
+
+#endif // PTA_IO_H
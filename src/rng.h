@@ -0,0 +1,32 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// 可重入随机数发生器（splitmix64）
+// 状态只有一个 uint64_t，由调用者持有，因此每个线程、每局游戏都可以各自拥有一份，
+// 不再依赖全局的 rand()/srand()
+
+static inline uint64_t rng_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rng_next(uint64_t *state) {
+    *state += 0x9E3779B97F4A7C15ULL;
+    return rng_mix(*state);
+}
+
+// 由批次种子和局号派生出每局独立的种子，保证结果与线程数无关
+static inline uint64_t rng_game_seed(uint64_t seed, uint64_t game) {
+    return rng_mix(seed ^ rng_mix(game + 1));
+}
+
+// 返回 [0, PIECE_TYPES) 之间的方块编号
+static inline int rng_piece(uint64_t *state) {
+    return (int) (((rng_next(state) >> 32) * PIECE_TYPES) >> 32);
+}
+
+#endif // RNG_H
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "rollout.h"
+#include "movegen.h"
+#include "rng.h"
+#include "thread_pool.h"
+#include "ttable.h"
+
+// 推演中途死掉的评分：远低于任何局面的评估，活得越久越高
+#define ROLLOUT_LOSS  (-(INT64_C(1) << 40))
+#define ROLLOUT_STEP  (INT64_C(1) << 32)
+// 不限轮数时的上限，保证累加不会溢出
+#define ROLLOUT_MAX_ROUNDS (1 << 20)
+
+struct rollout_task {
+    const struct tetris *boards;         // 各候选落子后的局面，只读
+    int count;
+    int length;
+    int next_piece;
+    uint64_t seed;
+    const struct eval_weights *weights;
+    int max_rounds;
+    int64_t deadline_ns;                 // 0 表示不限时
+    atomic_int next_round;               // 下一个待领取的轮次
+    int64_t *sums;                       // 第 index 个任务的累加结果在 sums[index * count ..]
+    int *rounds;                         // 各任务完成的轮数
+};
+
+static inline int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline int is_dead(const struct tetris *t) {
+    return t->landing_row == -1 || t->max_height >= ROW - 1;
+}
+
+// 与 select_best_move() 相同的贪心策略，只是权重可选；没有合法落点时返回 0
+static int greedy_move(const struct tetris *t, const struct eval_weights *w, int piece_index,
+                       int *best_rotation, int *best_col) {
+    int64_t best_score = INT64_MIN;
+    for (int j = 0; j < pieces[piece_index].count; j++) {
+        int64_t scores[COL];
+        int count = score_placements(t, w, piece_index, j, scores);
+        for (int i = 0; i < count; i++) {
+            if (scores[i] > best_score) {
+                best_score = scores[i];
+                *best_rotation = j;
+                *best_col = COL_SHIFT + i;
+            }
+        }
+    }
+    return best_score != INT64_MIN;
+}
+
+// 从 start 出发按 sequence 贪心地走 length 步。与逐节点搜索的口径相同：
+// 除最后一步外每步加上落点行乘 landing_height 的分，最后一步的局面用 evaluate_board() 评估。
+// evaluate_board() 只看最后一个方块的落点，不累加各步的落点高度，整体高度就体现不出来
+static int64_t playout(const struct tetris *start, const int *sequence, int length, const struct eval_weights *w) {
+    struct tetris t = *start;
+    int64_t bonus = (int64_t) start->landing_row * w->landing_height;
+    for (int step = 0; step < length; step++) {
+        int rotation, col;
+        if (!greedy_move(&t, w, sequence[step], &rotation, &col)) {
+            return ROLLOUT_LOSS + step * ROLLOUT_STEP;
+        }
+        place_piece(&t, &pieces[sequence[step]], rotation, col);
+        if (is_dead(&t)) {
+            return ROLLOUT_LOSS + step * ROLLOUT_STEP;
+        }
+        if (step + 1 < length) {
+            bonus += (int64_t) t.landing_row * w->landing_height;
+        }
+    }
+    return bonus + evaluate_board(&t, w);
+}
+
+// 不断领取轮次直到领完或超时，一轮在同一条序列上推演全部候选
+static void rollout_worker(void *arg, int index) {
+    struct rollout_task *task = arg;
+    int64_t *sums = task->sums + (size_t) index * task->count;
+    while (1) {
+        int r = atomic_fetch_add(&task->next_round, 1);
+        if (r >= task->max_rounds || (r > 0 && task->deadline_ns && monotonic_ns() >= task->deadline_ns)) {
+            break;
+        }
+        int sequence[ROLLOUT_MAX_LENGTH];
+        uint64_t rng = rng_game_seed(task->seed, (uint64_t) r);
+        sequence[0] = task->next_piece;
+        for (int i = 1; i < task->length; i++) {
+            sequence[i] = rng_piece(&rng);
+        }
+        for (int c = 0; c < task->count; c++) {
+            sums[c] += playout(&task->boards[c], sequence, task->length, task->weights);
+        }
+        task->rounds[index]++;
+    }
+}
+
+int64_t select_best_placement_rollout(const struct tetris *t, int curr_piece, int next_piece,
+                                      const struct rollout_policy *policy, struct placement *best, int *rounds) {
+    if (rounds) {
+        *rounds = 0;
+    }
+    struct placement *candidates = malloc(sizeof(struct placement) * MAX_REACHABLE_PLACEMENTS);
+    struct tetris *boards = malloc(sizeof(struct tetris) * MAX_REACHABLE_PLACEMENTS);
+    if (candidates == NULL || boards == NULL) {
+        free(candidates);
+        free(boards);
+        return INT64_MIN;
+    }
+    int n = generate_placements(t, curr_piece, candidates);
+    if (!policy->reachable) {
+        // 硬降落点排在最前面，去掉后面塞进去的落点
+        int drops = 0;
+        while (drops < n && candidates[drops].row == get_landing_row(t,
+                   &pieces[curr_piece].rotations[candidates[drops].rotation], candidates[drops].col)) {
+            drops++;
+        }
+        n = drops;
+    }
+
+    // 落子后立即死掉的候选不参加推演；全都会死时随便取第一个
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        boards[count] = *t;
+        place_piece_at(&boards[count], &pieces[curr_piece], candidates[i].rotation, candidates[i].col,
+                       candidates[i].row);
+        if (!is_dead(&boards[count])) {
+            candidates[count++] = candidates[i];
+        }
+    }
+    if (count == 0) {
+        int64_t score = INT64_MIN;
+        if (n > 0) {
+            *best = candidates[0];
+            score = ROLLOUT_LOSS;
+        }
+        free(candidates);
+        free(boards);
+        return score;
+    }
+
+    int workers = policy->pool ? thread_pool_size(policy->pool) + 1 : 1;
+    int64_t *sums = calloc((size_t) workers * count, sizeof(int64_t));
+    int *worker_rounds = calloc(workers, sizeof(int));
+    if (sums == NULL || worker_rounds == NULL) {
+        free(sums);
+        free(worker_rounds);
+        *best = candidates[0];
+        free(candidates);
+        free(boards);
+        return INT64_MIN;
+    }
+
+    struct rollout_task task;
+    task.boards = boards;
+    task.count = count;
+    task.length = policy->length < 1 ? 1 : policy->length > ROLLOUT_MAX_LENGTH ? ROLLOUT_MAX_LENGTH : policy->length;
+    task.next_piece = next_piece;
+    task.seed = rng_mix(policy->seed ^ hash_tetris(t) ^ (uint64_t) (curr_piece * PIECE_TYPES + next_piece));
+    task.weights = policy->weights ? policy->weights : &EVAL_WEIGHTS_DEFAULT;
+    task.max_rounds = policy->playouts > 0 && policy->playouts < ROLLOUT_MAX_ROUNDS ? policy->playouts
+                                                                                     : ROLLOUT_MAX_ROUNDS;
+    if (policy->budget_us <= 0 && policy->playouts <= 0) {
+        task.max_rounds = 1;
+    }
+    task.deadline_ns = policy->budget_us > 0 ? monotonic_ns() + policy->budget_us * 1000 : 0;
+    atomic_init(&task.next_round, 0);
+    task.sums = sums;
+    task.rounds = worker_rounds;
+    if (policy->pool) {
+        thread_pool_run(policy->pool, workers, rollout_worker, &task);
+    } else {
+        rollout_worker(&task, 0);
+    }
+
+    // 各候选走的是同样的几轮，直接比较总和
+    int total_rounds = 0;
+    for (int w = 0; w < workers; w++) {
+        total_rounds += worker_rounds[w];
+    }
+    int best_index = 0;
+    int64_t best_sum = INT64_MIN;
+    for (int c = 0; c < count; c++) {
+        int64_t sum = 0;
+        for (int w = 0; w < workers; w++) {
+            sum += sums[(size_t) w * count + c];
+        }
+        if (sum > best_sum) {
+            best_sum = sum;
+            best_index = c;
+        }
+    }
+    *best = candidates[best_index];
+    if (rounds) {
+        *rounds = total_rounds;
+    }
+    free(sums);
+    free(worker_rounds);
+    free(candidates);
+    free(boards);
+    return best_sum / total_rounds;
+}
@@ -0,0 +1,34 @@
+#ifndef ROLLOUT_H
+#define ROLLOUT_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// 蒙特卡洛推演：给高局面的根节点候选打分
+// 每个候选落子后，先用贪心策略（select_best_move()）放下已知的下一个方块，再在随机方块序列上贪心地走若干步，
+// 以多局推演的平均结果作为候选的评分。按固定深度搜索只看最难的 S、Z，推演则直接统计各候选活下去的机会。
+//
+// 一轮推演在同一条随机序列上依次走完全部候选（公共随机数），候选之间的比较不受序列好坏的影响；
+// 第 i 轮的序列只由 seed、局面和 i 决定，所以固定轮数时结果与线程数无关。
+// 各轮交给线程池并行，每个任务只累加自己的槽位；限时的时候各任务共享同一个截止时间，超时后不再领取新的一轮。
+
+#define ROLLOUT_DEFAULT_LENGTH   4
+#define ROLLOUT_MAX_LENGTH       64
+
+struct rollout_policy {
+    int min_height;                      // 局面最高行达到这个高度时才改用推演（见 select_game_placement()）
+    int playouts;                        // 每个候选的推演局数上限；限时模式下为 0 表示不限，只受时间约束
+    int length;                          // 每局推演的步数（含已知的下一个方块），1 到 ROLLOUT_MAX_LENGTH
+    int64_t budget_us;                   // 大于 0 时所有推演共享这么多微秒，至少完成一轮
+    uint64_t seed;                       // 与局面一起决定推演的方块序列
+    struct thread_pool *pool;            // 非空时各轮推演交给线程池并行
+    const struct eval_weights *weights;  // 推演落子和终局评估的权重，NULL 表示 EVAL_WEIGHTS_DEFAULT
+    int reachable;                       // 非 0 时根节点候选包括 generate_placements() 的全部落点；推演本身只用硬降
+};
+
+// 按推演结果选出 curr_piece 的落点，返回最佳候选的平均评分，*rounds 为完成的推演轮数（可为 NULL）
+// 没有任何合法落点时返回 INT64_MIN，*best 不变
+int64_t select_best_placement_rollout(const struct tetris *t, int curr_piece, int next_piece,
+                                      const struct rollout_policy *policy, struct placement *best, int *rounds);
+
+#endif // ROLLOUT_H
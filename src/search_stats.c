@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "search_stats.h"
+
+#ifdef TETRIS_STATS
+
+// 每个线程的计数放在一个链表节点里。线程退出时（pthread_key 的析构函数）把计数并入 retired，
+// 节点标记为空闲，留给之后新建的线程使用，链表的长度不超过同时存在过的线程数
+struct stats_slot {
+    struct search_stats stats;           // 自上次 search_stats_collect() 以来的计数
+    struct search_stats total;           // 本线程的累计计数，供 search_stats_print_threads()
+    int thread;                          // 线程编号，按第一次计数的先后从 0 开始；-1 表示空闲
+    struct stats_slot *next;
+};
+
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_slot *slots = NULL;
+static int next_thread = 0;
+static struct search_stats retired;        // 已退出线程尚未汇总的计数
+static struct search_stats retired_total;  // 已退出线程的累计计数
+static struct search_stats fallback;       // 内存不足时所有线程共用，计数可能不准
+static pthread_key_t slot_key;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+
+_Thread_local struct search_stats *search_stats_tls = NULL;
+
+static void slot_release(void *p) {
+    struct stats_slot *slot = p;
+    pthread_mutex_lock(&slots_lock);
+    search_stats_add(&retired, &slot->stats);
+    search_stats_add(&retired_total, &slot->total);
+    search_stats_add(&retired_total, &slot->stats);
+    memset(&slot->stats, 0, sizeof(slot->stats));
+    memset(&slot->total, 0, sizeof(slot->total));
+    slot->thread = -1;
+    pthread_mutex_unlock(&slots_lock);
+}
+
+static void slot_key_create(void) {
+    pthread_key_create(&slot_key, slot_release);
+}
+
+struct search_stats *search_stats_register(void) {
+    pthread_once(&slot_key_once, slot_key_create);
+    pthread_mutex_lock(&slots_lock);
+    struct stats_slot *slot = slots;
+    while (slot && slot->thread >= 0) {
+        slot = slot->next;
+    }
+    if (slot == NULL) {
+        slot = calloc(1, sizeof(struct stats_slot));
+        if (slot == NULL) {
+            pthread_mutex_unlock(&slots_lock);
+            return &fallback;
+        }
+        slot->next = slots;
+        slots = slot;
+    }
+    slot->thread = next_thread++;
+    pthread_mutex_unlock(&slots_lock);
+    pthread_setspecific(slot_key, slot);
+    return &slot->stats;
+}
+
+int search_stats_enabled(void) {
+    return 1;
+}
+
+void search_stats_collect(struct search_stats *out) {
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&slots_lock);
+    for (struct stats_slot *slot = slots; slot; slot = slot->next) {
+        search_stats_add(out, &slot->stats);
+        search_stats_add(&slot->total, &slot->stats);
+        memset(&slot->stats, 0, sizeof(slot->stats));
+    }
+    search_stats_add(out, &retired);
+    memset(&retired, 0, sizeof(retired));
+    search_stats_add(out, &fallback);
+    search_stats_add(&retired_total, &fallback);
+    memset(&fallback, 0, sizeof(fallback));
+    pthread_mutex_unlock(&slots_lock);
+}
+
+static void print_thread_line(FILE *out, const char *name, const struct search_stats *s);
+
+void search_stats_print_threads(FILE *out) {
+    fprintf(out, "Search stats by thread:\n");
+    fprintf(out, "%8s %12s %13s %8s %11s %12s %10s\n",
+            "thread", "nodes", "placements", "invalid", "cutoffs", "place_piece", "ms");
+    pthread_mutex_lock(&slots_lock);
+    // 链表头是最近注册的线程，按编号从小到大打印
+    for (int id = 0; id < next_thread; id++) {
+        for (struct stats_slot *slot = slots; slot; slot = slot->next) {
+            if (slot->thread == id) {
+                char name[16];
+                snprintf(name, sizeof(name), "%d", id);
+                print_thread_line(out, name, &slot->total);
+            }
+        }
+    }
+    print_thread_line(out, "exited", &retired_total);
+    pthread_mutex_unlock(&slots_lock);
+}
+
+#else
+
+int search_stats_enabled(void) {
+    return 0;
+}
+
+void search_stats_collect(struct search_stats *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+void search_stats_print_threads(FILE *out) {
+    (void) out;
+}
+
+#endif
+
+void search_stats_add(struct search_stats *sum, const struct search_stats *s) {
+    for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+        sum->nodes[d] += s->nodes[d];
+        sum->ply_ns[d] += s->ply_ns[d];
+    }
+    sum->place_piece += s->place_piece;
+    sum->placements += s->placements;
+    sum->invalid += s->invalid;
+    sum->beam_cutoffs += s->beam_cutoffs;
+    sum->reused += s->reused;
+}
+
+void search_stats_record(struct search_stats_table *table, int height, const struct search_stats *s) {
+    if (height < 0) {
+        height = 0;
+    }
+    if (height > ROW) {
+        height = ROW;
+    }
+    table->moves[height]++;
+    search_stats_add(&table->by_height[height], s);
+}
+
+static uint64_t total_nodes(const struct search_stats *s) {
+    uint64_t n = 0;
+    for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+        n += s->nodes[d];
+    }
+    return n;
+}
+
+static uint64_t total_ns(const struct search_stats *s) {
+    uint64_t n = 0;
+    for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+        n += s->ply_ns[d];
+    }
+    return n;
+}
+
+#ifdef TETRIS_STATS
+// 没有计数的线程不打印
+static void print_thread_line(FILE *out, const char *name, const struct search_stats *s) {
+    uint64_t nodes = total_nodes(s);
+    if (nodes == 0 && s->placements == 0) {
+        return;
+    }
+    fprintf(out, "%8s %12llu %13llu %7.2f%% %11llu %12llu %10.2f\n", name, (unsigned long long) nodes,
+            (unsigned long long) s->placements, s->placements ? 100.0 * s->invalid / s->placements : 0.0,
+            (unsigned long long) s->beam_cutoffs, (unsigned long long) s->place_piece, total_ns(s) / 1e6);
+}
+#endif
+
+void search_stats_print(FILE *out, const struct search_stats_table *table) {
+    struct search_stats all = {0};
+    uint64_t moves = 0;
+    fprintf(out, "Search stats per move by board height:\n");
+    fprintf(out, "%6s %8s %10s %11s %8s %9s %11s %10s\n",
+            "height", "moves", "nodes", "placements", "invalid", "cutoffs", "place_piece", "us");
+    for (int h = 0; h <= ROW; h++) {
+        uint64_t m = table->moves[h];
+        if (m == 0) {
+            continue;
+        }
+        const struct search_stats *s = &table->by_height[h];
+        fprintf(out, "%6d %8llu %10.1f %11.1f %7.2f%% %9.1f %11.1f %10.2f\n", h, (unsigned long long) m,
+                (double) total_nodes(s) / m, (double) s->placements / m,
+                s->placements ? 100.0 * s->invalid / s->placements : 0.0,
+                (double) s->beam_cutoffs / m, (double) s->place_piece / m, total_ns(s) / 1000.0 / m);
+        search_stats_add(&all, s);
+        moves += m;
+    }
+    if (moves == 0) {
+        return;
+    }
+    fprintf(out, "Nodes and time by ply (all moves):\n");
+    uint64_t nodes = total_nodes(&all), ns = total_ns(&all);
+    for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+        if (all.nodes[d] == 0) {
+            continue;
+        }
+        fprintf(out, "  ply %d: %12llu nodes (%5.1f%%)  %10.2f ms (%5.1f%%)\n", d,
+                (unsigned long long) all.nodes[d], 100.0 * all.nodes[d] / nodes,
+                all.ply_ns[d] / 1e6, ns ? 100.0 * all.ply_ns[d] / ns : 0.0);
+    }
+    fprintf(out, "Root expansions reused: %llu of %llu moves (%.1f%%)\n", (unsigned long long) all.reused,
+            (unsigned long long) moves, 100.0 * all.reused / moves);
+}
+
+void search_stats_dump_json(FILE *out, long move, const struct search_stats_table *table) {
+    fprintf(out, "{\"move\": %ld, \"heights\": [", move);
+    int first = 1;
+    for (int h = 0; h <= ROW; h++) {
+        const struct search_stats *s = &table->by_height[h];
+        if (table->moves[h] == 0) {
+            continue;
+        }
+        fprintf(out, "%s{\"height\": %d, \"moves\": %llu, \"nodes\": [", first ? "" : ", ", h,
+                (unsigned long long) table->moves[h]);
+        for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+            fprintf(out, d ? ", %llu" : "%llu", (unsigned long long) s->nodes[d]);
+        }
+        fprintf(out, "], \"ply_ns\": [");
+        for (int d = 0; d < MAX_SEARCH_DEPTH; d++) {
+            fprintf(out, d ? ", %llu" : "%llu", (unsigned long long) s->ply_ns[d]);
+        }
+        fprintf(out, "], \"place_piece\": %llu, \"placements\": %llu, \"invalid\": %llu, \"beam_cutoffs\": %llu, "
+                "\"reused\": %llu}",
+                (unsigned long long) s->place_piece, (unsigned long long) s->placements,
+                (unsigned long long) s->invalid, (unsigned long long) s->beam_cutoffs, (unsigned long long) s->reused);
+        first = 0;
+    }
+    fprintf(out, "]}\n");
+    fflush(out);
+}
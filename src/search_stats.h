@@ -0,0 +1,77 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tetris.h"
+
+// 搜索热路径上的计数器
+// 编译时 STATS=1（-DTETRIS_STATS）才打开；未打开时 STATS_* 宏展开为空，参数也不会被求值，没有任何开销。
+// 计数先累加到每个线程自己的一份里，search_stats_collect() 把所有线程的计数汇总后清零，
+// 调用时各线程不能正在搜索（例如在两步之间调用）。每个线程另有一份不清零的累计，
+// 由 search_stats_print_threads() 分线程打印。线程退出时它的计数并入“已退出线程”，占用的槽位留给新线程。
+
+struct search_stats {
+    uint64_t nodes[MAX_SEARCH_DEPTH];     // 各层展开的节点数（不含置换表命中）
+    uint64_t ply_ns[MAX_SEARCH_DEPTH];    // 各层展开落点、评估所用的时间
+    uint64_t place_piece;                 // place_piece() 的调用次数
+    uint64_t placements;                  // 评估过的落点数，包括批量展开和 SIMD 内核算出的落点
+    uint64_t invalid;                     // 其中的非法落点（landing_row == -1）
+    uint64_t beam_cutoffs;                // 被 beam 剪掉的落点数
+    uint64_t reused;                      // 根节点沿用上一步展开结果的次数
+};
+
+#ifdef TETRIS_STATS
+
+#include <time.h>
+
+struct search_stats *search_stats_register(void);
+
+extern _Thread_local struct search_stats *search_stats_tls;
+
+static inline struct search_stats *search_stats_local(void) {
+    if (__builtin_expect(search_stats_tls == NULL, 0)) {
+        search_stats_tls = search_stats_register();
+    }
+    return search_stats_tls;
+}
+
+static inline int64_t search_stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#define STATS_ADD(field, n)            (search_stats_local()->field += (n))
+#define STATS_CLOCK(var)               int64_t var = search_stats_clock()
+#define STATS_PLY_TIME(ply, start)     STATS_ADD(ply_ns[ply], search_stats_clock() - (start))
+
+#else
+
+#define STATS_ADD(field, n)            ((void) 0)
+#define STATS_CLOCK(var)               ((void) 0)
+#define STATS_PLY_TIME(ply, start)     ((void) 0)
+
+#endif
+
+// 编译时是否打开了计数器
+int  search_stats_enabled(void);
+// 汇总所有线程的计数写入 out 并清零；未打开时 out 全为 0
+void search_stats_collect(struct search_stats *out);
+void search_stats_add(struct search_stats *sum, const struct search_stats *s);
+// 打印每个线程（含已退出的线程合计）截至上次 search_stats_collect() 的累计计数；未打开时什么也不做
+void search_stats_print_threads(FILE *out);
+
+// 按局面高度分组累计的每步计数，用于对局结束时的汇总
+struct search_stats_table {
+    uint64_t moves[ROW + 1];
+    struct search_stats by_height[ROW + 1];
+};
+
+void search_stats_record(struct search_stats_table *table, int height, const struct search_stats *s);
+// 按高度打印每步平均的节点数、落点数、非法落点比例、beam 剪枝数和耗时，以及各层节点数的分布
+void search_stats_print(FILE *out, const struct search_stats_table *table);
+// 一行 JSON，字段为累计值，便于定期写出后由脚本处理
+void search_stats_dump_json(FILE *out, long move, const struct search_stats_table *table);
+
+#endif // SEARCH_STATS_H
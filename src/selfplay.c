@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "selfplay.h"
+#include "rng.h"
+#include "rollout.h"
+
+// 得分规则
+const int SCORE_TABLE[] = {0, 100, 300, 500, 800};
+
+int select_game_placement(struct tetris *t, int curr_piece, int next_piece, const struct move_options *options,
+                          struct placement *best) {
+    struct thread_pool *pool = options ? options->pool : NULL;
+    const struct eval_weights *weights = options ? options->weights : NULL;
+    int beam_width = options ? options->beam_width : 0;
+    int reachable = options ? options->reachable : 0;
+    if (options && options->rollout && t->max_height >= options->rollout->min_height) {
+        // 推演只确定地看了当前和下一个方块，深度记为 2；限时模式下推演用掉这一步的全部时间
+        struct rollout_policy policy = *options->rollout;
+        policy.pool = pool;
+        policy.weights = weights;
+        policy.reachable = reachable;
+        if (options->budget_us > 0) {
+            policy.budget_us = options->budget_us;
+        }
+        select_best_placement_rollout(t, curr_piece, next_piece, &policy, best, NULL);
+        return 2;
+    }
+    if (options && options->budget_us > 0) {
+        // 低局面对 7 种方块取平均，高局面只防最难处理的 S 和 Z
+        struct search_policy policy = t->max_height < 13 ? SEARCH_POLICY_EXPECTIMAX : SEARCH_POLICY_SAMPLE_SZ;
+        policy.pool = pool;
+        policy.weights = weights;
+        policy.ply_beam_width = beam_width;
+        policy.reachable = reachable;
+        int depth;
+        select_best_placement_anytime(t, curr_piece, next_piece, MAX_SEARCH_DEPTH, &policy, options->budget_us,
+                                      best, &depth);
+        return depth;
+    }
+
+    // 按局面高度从配置中取档位；默认配置与 select_best_move_with_next_beam() /
+    // select_best_move_with_next_beam_sampleSZ_pool() 相同，只是带上权重和整层 beam 宽度
+    const struct search_profile *profile = (options && options->profile) ? options->profile : &SEARCH_PROFILES[0];
+    const struct search_tier *tier = search_profile_tier(profile, t->max_height);
+    struct search_policy policy;
+    search_tier_policy(tier, &policy);
+    policy.pool = tier->depth > 2 ? pool : NULL;    // 两步搜索太快，分给线程池得不偿失
+    policy.weights = weights;
+    if (beam_width > 0) {
+        policy.ply_beam_width = beam_width;
+    }
+    policy.reachable = reachable;
+    select_best_placement_search(t, curr_piece, next_piece, tier->depth, &policy, best);
+    return tier->depth;
+}
+
+int select_game_move(struct tetris *t, int curr_piece, int next_piece, const struct move_options *options,
+                     int *best_rotation, int *best_col) {
+    struct placement best = { *best_rotation, *best_col, 0 };
+    int depth = select_game_placement(t, curr_piece, next_piece, options, &best);
+    *best_rotation = best.rotation;
+    *best_col = best.col;
+    return depth;
+}
+
+void play_seeded_game(uint64_t seed, int max_steps, const struct move_options *options, struct game_result *result) {
+    struct tetris t;
+    init_tetris(&t);
+    uint64_t rng = seed;
+    int curr_piece = rng_piece(&rng);
+    int next_piece = rng_piece(&rng);
+
+    result->seed = seed;
+    result->steps = 0;
+    result->score = 0;
+    result->lines = 0;
+    while (1) {
+        struct placement best = { 0, 0, 0 };
+        select_game_placement(&t, curr_piece, next_piece, options, &best);
+        place_piece_at(&t, &pieces[curr_piece], best.rotation, best.col, best.row);
+        result->score += SCORE_TABLE[t.rows_eliminated];
+        result->lines += t.rows_eliminated;
+        result->steps++;
+        if (t.max_height >= 19 || result->steps >= max_steps) {
+            break;
+        }
+        curr_piece = next_piece;
+        next_piece = rng_piece(&rng);
+    }
+}
+
+struct selfplay_job {
+    atomic_int next_game;      // 下一个待领取的局号
+    int games;
+    int max_steps;
+    uint64_t seed;
+    const struct move_options *options;
+    struct game_result *results;
+};
+
+// 工作线程：不断领取局号直到全部下完，每局只写自己的结果槽位
+static void *selfplay_worker(void *arg) {
+    struct selfplay_job *job = arg;
+    while (1) {
+        int g = atomic_fetch_add(&job->next_game, 1);
+        if (g >= job->games) {
+            break;
+        }
+        play_seeded_game(rng_game_seed(job->seed, g), job->max_steps, job->options, &job->results[g]);
+    }
+    return NULL;
+}
+
+int run_selfplay(int games, int threads, uint64_t seed, int max_steps, const struct move_options *options,
+                 struct game_result *results) {
+    struct selfplay_job job;
+    atomic_init(&job.next_game, 0);
+    job.games = games;
+    job.max_steps = max_steps;
+    job.seed = seed;
+    job.options = options;
+    job.results = results;
+
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > games) {
+        threads = games;
+    }
+
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    if (tids == NULL) {
+        return -1;
+    }
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, selfplay_worker, &job) != 0) {
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        selfplay_worker(&job);    // 无法创建线程时退化为单线程
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    free(tids);
+    return 0;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+// 最近秩法求分位数，values 须已排序
+static int percentile(const int *values, int n, int p) {
+    int rank = (p * n + 99) / 100;
+    if (rank < 1) {
+        rank = 1;
+    }
+    return values[rank - 1];
+}
+
+static void print_distribution(const char *name, int *values, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += values[i];
+    }
+    qsort(values, n, sizeof(int), cmp_int);
+    double median = (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+    printf("%-6s mean %.1f  median %.1f  min %d  p10 %d  p25 %d  p75 %d  p90 %d  p99 %d  max %d\n",
+           name, sum / n, median, values[0],
+           percentile(values, n, 10), percentile(values, n, 25),
+           percentile(values, n, 75), percentile(values, n, 90),
+           percentile(values, n, 99), values[n - 1]);
+}
+
+void print_selfplay_stats(const struct game_result *results, int games, double elapsed) {
+    if (games <= 0) {
+        return;
+    }
+    int *values = malloc(sizeof(int) * games);
+    if (values == NULL) {
+        return;
+    }
+    long long steps = 0;
+    for (int i = 0; i < games; i++) {
+        steps += results[i].steps;
+    }
+
+    printf("Games: %d, Total steps: %lld\n", games, steps);
+    for (int i = 0; i < games; i++) {
+        values[i] = results[i].lines;
+    }
+    print_distribution("lines", values, games);
+    for (int i = 0; i < games; i++) {
+        values[i] = results[i].score;
+    }
+    print_distribution("score", values, games);
+    printf("Elapsed: %.3f seconds, %.2f games/s, %.0f steps/s\n",
+           elapsed, elapsed > 0 ? games / elapsed : 0.0, elapsed > 0 ? steps / elapsed : 0.0);
+    free(values);
+}
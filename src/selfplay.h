@@ -0,0 +1,50 @@
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <stdint.h>
+#include "tetris.h"
+#include "profile.h"
+
+#define MAX_GAME_STEPS 100000
+
+extern const int SCORE_TABLE[];
+
+struct game_result {
+    uint64_t seed;     // 本局使用的种子
+    int steps;         // 落下的方块数
+    int score;         // 得分
+    int lines;         // 消除行数
+};
+
+struct thread_pool;
+
+struct move_options {
+    struct thread_pool *pool;   // 非空时高局面的搜索把根节点候选分给线程池并行计算
+    int64_t budget_us;          // 大于 0 时改用限时迭代加深搜索，每步最多用这么多微秒
+    const struct eval_weights *weights;   // 评估权重，NULL 表示默认权重
+    int beam_width;             // 大于 0 时改用整层 beam 搜索，每层保留这么多个局面（见 search_policy.ply_beam_width）
+    const struct search_profile *profile;   // 固定深度搜索按局面高度选用的配置，NULL 表示 SEARCH_PROFILES[0]
+    int reachable;              // 非 0 时还考虑经平移、软降、旋转才能到达的落点，落子须用 place_piece_at()
+    const struct rollout_policy *rollout;   // 非空时局面达到 rollout->min_height 后改用蒙特卡洛推演（见 rollout.h）
+};
+
+// 根据当前局面选择搜索策略并给出落子位置，返回本步搜索达到的深度
+// options 为 NULL 时使用默认配置的固定深度搜索；限时模式不读配置，仍按高度在两种策略之间选择
+int select_game_placement(struct tetris *t, int curr_piece, int next_piece, const struct move_options *options,
+                          struct placement *best);
+// 只给出旋转和列，按硬降落子；options->reachable 非 0 时应改用 select_game_placement()
+int select_game_move(struct tetris *t, int curr_piece, int next_piece, const struct move_options *options,
+                     int *best_rotation, int *best_col);
+
+// 用给定种子无界面地下一局，max_steps 为最多落下的方块数，options 为 NULL 时使用默认设置
+void play_seeded_game(uint64_t seed, int max_steps, const struct move_options *options, struct game_result *result);
+
+// 用 threads 个线程并行下 games 局，第 i 局的种子由 seed 和 i 派生，
+// 结果按局号写入 results[0..games-1]，与线程数无关
+int run_selfplay(int games, int threads, uint64_t seed, int max_steps, const struct move_options *options,
+                 struct game_result *results);
+
+// 打印批量对局的统计信息（均值、中位数、分位数以及每秒局数）
+void print_selfplay_stats(const struct game_result *results, int games, double elapsed);
+
+#endif // SELFPLAY_H
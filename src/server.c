@@ -0,0 +1,486 @@
+#define _GNU_SOURCE     // accept4
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+#define SESSION_IN_BUF   4096
+#define SESSION_OUT_BUF  (4 * MOVE_TEXT_MAX)
+#define SERVE_MAX_EVENTS 256
+
+struct session {
+    int fd;
+    uint32_t events;             // 当前在 epoll 中登记的事件
+    int eof;                     // 对方已关闭写端
+    int dead;                    // 已关闭，等待释放
+    int busy;                    // 工作线程正在为它搜索，此时只有工作线程访问下面的对局字段
+    struct session *link;        // 任务队列、完成队列或待释放链表
+    struct session *prev, *next; // 全部未释放的会话
+
+    // 对局：与 play_game_pta() 相同
+    struct tetris t;
+    int curr_piece;              // -1 表示还没读到
+    int next_piece;              // 为 PIECE_END 时这一步是一局的最后一步
+    int score;
+    char move[MOVE_TEXT_MAX + 1];
+    size_t move_len;
+
+    size_t in_pos, in_len;
+    unsigned char in[SESSION_IN_BUF];
+    size_t out_pos, out_len;
+    char out[SESSION_OUT_BUF];
+};
+
+struct session_queue {
+    struct session *head, *tail;
+};
+
+struct server {
+    const struct serve_options *options;
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;                 // 工作线程算完一步后写入，唤醒 epoll
+
+    pthread_mutex_t lock;        // 保护 jobs、done 和 quit
+    pthread_cond_t cond;
+    struct session_queue jobs;
+    struct session_queue done;
+    int quit;
+
+    struct session *all;         // 全部未释放的会话，结束服务时一并释放
+    struct session *graveyard;   // 本轮事件处理完后释放，避免同一批事件中还引用它们
+    long sessions;               // 累计接受的连接
+    long active;
+    long moves;
+};
+
+// epoll 事件的 data.ptr 指向会话，监听套接字、eventfd 和 signalfd 用这几个标记区分
+static char listen_tag, wake_tag, signal_tag;
+
+static void queue_push(struct session_queue *q, struct session *s) {
+    s->link = NULL;
+    if (q->tail) {
+        q->tail->link = s;
+    } else {
+        q->head = s;
+    }
+    q->tail = s;
+}
+
+static struct session *queue_take_all(struct session_queue *q) {
+    struct session *s = q->head;
+    q->head = q->tail = NULL;
+    return s;
+}
+
+static void new_game(struct session *s) {
+    init_tetris(&s->t);
+    s->curr_piece = -1;
+    s->next_piece = -1;
+    s->score = 0;
+}
+
+// 工作线程：与 play_game_pta() 的一步相同，结果格式化后放在 s->move
+static void play_move(const struct serve_options *options, struct session *s) {
+    int best_rotation, best_col;
+    if (s->next_piece == PIECE_END) {
+        select_best_move_with_next_beam(&s->t, s->curr_piece, 0, &best_rotation, &best_col);
+    } else {
+        select_game_move(&s->t, s->curr_piece, s->next_piece, options->moves, &best_rotation, &best_col);
+    }
+    place_piece(&s->t, &pieces[s->curr_piece], best_rotation, best_col);
+    s->score += SCORE_TABLE[s->t.rows_eliminated];
+    s->move_len = move_format(s->move, options->format, options->boards, &s->t, best_rotation, best_col, s->score);
+}
+
+static void *worker_main(void *arg) {
+    struct server *srv = arg;
+    pthread_mutex_lock(&srv->lock);
+    while (1) {
+        while (!srv->quit && srv->jobs.head == NULL) {
+            pthread_cond_wait(&srv->cond, &srv->lock);
+        }
+        if (srv->quit) {
+            break;
+        }
+        struct session *s = srv->jobs.head;
+        srv->jobs.head = s->link;
+        if (srv->jobs.head == NULL) {
+            srv->jobs.tail = NULL;
+        }
+        pthread_mutex_unlock(&srv->lock);
+
+        play_move(srv->options, s);
+
+        pthread_mutex_lock(&srv->lock);
+        int was_empty = srv->done.head == NULL;
+        queue_push(&srv->done, s);
+        if (was_empty) {
+            uint64_t one = 1;
+            ssize_t n = write(srv->wake_fd, &one, sizeof(one));
+            (void) n;    // 计数溢出之前主线程一定已经读过，写入不会失败
+        }
+    }
+    pthread_mutex_unlock(&srv->lock);
+    return NULL;
+}
+
+static void session_free(struct server *srv, struct session *s) {
+    if (s->prev) {
+        s->prev->next = s->next;
+    } else {
+        srv->all = s->next;
+    }
+    if (s->next) {
+        s->next->prev = s->prev;
+    }
+    free(s);
+}
+
+static void session_close(struct server *srv, struct session *s) {
+    if (s->dead) {
+        return;
+    }
+    s->dead = 1;
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, s->fd, NULL);
+    close(s->fd);
+    srv->active--;
+    if (!s->busy) {
+        s->link = srv->graveyard;
+        srv->graveyard = s;
+    }
+}
+
+// 尽量输出缓冲中的数据；出错时关闭连接
+static void session_flush(struct server *srv, struct session *s) {
+    while (s->out_pos < s->out_len) {
+        ssize_t n = send(s->fd, s->out + s->out_pos, s->out_len - s->out_pos, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                session_close(srv, s);
+            }
+            return;
+        }
+        s->out_pos += n;
+    }
+    s->out_pos = s->out_len = 0;
+}
+
+// 读入能读的数据；对方关闭写端时置 eof，出错时关闭连接
+static void session_read(struct server *srv, struct session *s) {
+    if (s->in_pos > 0) {
+        memmove(s->in, s->in + s->in_pos, s->in_len - s->in_pos);
+        s->in_len -= s->in_pos;
+        s->in_pos = 0;
+    }
+    while (s->in_len < SESSION_IN_BUF) {
+        ssize_t n = read(s->fd, s->in + s->in_len, SESSION_IN_BUF - s->in_len);
+        if (n > 0) {
+            s->in_len += n;
+            continue;
+        }
+        if (n == 0) {
+            s->eof = 1;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            session_close(srv, s);
+        }
+        return;
+    }
+}
+
+static int session_next_piece(struct server *srv, struct session *s) {
+    while (s->in_pos < s->in_len) {
+        int piece = piece_decode(srv->options->format, s->in[s->in_pos++]);
+        if (piece != PIECE_SKIP && piece != PIECE_FLUSH) {
+            return piece;
+        }
+    }
+    return PIECE_NEED_INPUT;
+}
+
+static void dispatch(struct server *srv, struct session *s) {
+    s->busy = 1;
+    pthread_mutex_lock(&srv->lock);
+    queue_push(&srv->jobs, s);
+    pthread_cond_signal(&srv->cond);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+// 处理缓冲中的输入，凑齐一步就交给工作线程；之后按缓冲状态调整登记的事件，没事可做时关闭连接
+static void session_pump(struct server *srv, struct session *s) {
+    if (s->dead) {
+        return;
+    }
+    int need_input = 0;
+    // 搜索进行中不动对局字段；输出缓冲放不下下一步时先等对方读走
+    while (!s->busy && SESSION_OUT_BUF - s->out_len >= MOVE_TEXT_MAX) {
+        int piece = session_next_piece(srv, s);
+        if (piece == PIECE_NEED_INPUT) {
+            need_input = 1;
+            break;
+        }
+        if (piece == PIECE_INVALID) {
+            session_flush(srv, s);
+            session_close(srv, s);
+            return;
+        }
+        if (piece == PIECE_END && s->curr_piece < 0) {
+            new_game(s);    // 空的一局
+            continue;
+        }
+        if (s->curr_piece < 0) {
+            s->curr_piece = piece;
+            continue;
+        }
+        s->next_piece = piece;
+        dispatch(srv, s);
+    }
+    if (s->eof && need_input && s->out_len == 0) {
+        session_close(srv, s);
+        return;
+    }
+    uint32_t events = 0;
+    if (!s->eof && s->in_len - s->in_pos < SESSION_IN_BUF) {
+        events |= EPOLLIN;
+    }
+    if (s->out_len > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != s->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = s };
+        epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, s->fd, &ev);
+        s->events = events;
+    }
+}
+
+static void accept_sessions(struct server *srv) {
+    while (1) {
+        int fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept");    // 文件描述符用完等情况，已在等待的连接下次再接受
+            }
+            return;
+        }
+        struct session *s = malloc(sizeof(struct session));
+        if (s == NULL) {
+            close(fd);
+            continue;
+        }
+        s->fd = fd;
+        s->events = EPOLLIN;
+        s->eof = 0;
+        s->dead = 0;
+        s->busy = 0;
+        s->link = NULL;
+        s->in_pos = s->in_len = 0;
+        s->out_pos = s->out_len = 0;
+        new_game(s);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = s };
+        if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("epoll_ctl");
+            close(fd);
+            free(s);
+            continue;
+        }
+        s->prev = NULL;
+        s->next = srv->all;
+        if (srv->all) {
+            srv->all->prev = s;
+        }
+        srv->all = s;
+        srv->sessions++;
+        srv->active++;
+    }
+}
+
+// 取回工作线程算完的各步，输出并继续处理各自的输入
+static void collect_moves(struct server *srv) {
+    uint64_t count;
+    ssize_t n = read(srv->wake_fd, &count, sizeof(count));
+    (void) n;
+    pthread_mutex_lock(&srv->lock);
+    struct session *s = queue_take_all(&srv->done);
+    pthread_mutex_unlock(&srv->lock);
+    while (s) {
+        struct session *next = s->link;
+        s->busy = 0;
+        srv->moves++;
+        if (s->dead) {
+            s->link = srv->graveyard;
+            srv->graveyard = s;
+        } else {
+            memcpy(s->out + s->out_len, s->move, s->move_len);
+            s->out_len += s->move_len;
+            if (s->next_piece == PIECE_END) {
+                new_game(s);
+            } else {
+                s->curr_piece = s->next_piece;
+                s->next_piece = -1;
+            }
+            session_flush(srv, s);
+            session_pump(srv, s);
+        }
+        s = next;
+    }
+}
+
+static int listen_on(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "套接字路径太长: %s\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_server(const struct serve_options *options) {
+    struct server srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.options = options;
+    srv.listen_fd = listen_on(options->path);
+    if (srv.listen_fd < 0) {
+        return -1;
+    }
+    // 先屏蔽 SIGINT 和 SIGTERM 再创建工作线程，工作线程继承屏蔽字，信号只经 signalfd 交给 epoll；
+    // 不安装信号处理函数，返回前恢复原来的屏蔽字
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+    int signal_fd = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    srv.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    srv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (signal_fd < 0 || srv.epoll_fd < 0 || srv.wake_fd < 0) {
+        perror("epoll");
+        close(signal_fd);
+        close(srv.epoll_fd);
+        close(srv.wake_fd);
+        close(srv.listen_fd);
+        unlink(options->path);
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+        return -1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &listen_tag };
+    epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, srv.listen_fd, &ev);
+    ev.data.ptr = &wake_tag;
+    epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, srv.wake_fd, &ev);
+    ev.data.ptr = &signal_tag;
+    epoll_ctl(srv.epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev);
+
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.cond, NULL);
+    int workers = options->workers > 0 ? options->workers : 1;
+    pthread_t *threads = malloc(sizeof(pthread_t) * workers);
+    int started = 0;
+    while (threads && started < workers && pthread_create(&threads[started], NULL, worker_main, &srv) == 0) {
+        started++;
+    }
+
+    fprintf(stderr, "在 %s 上服务，%d 个搜索线程\n", options->path, started);
+    struct epoll_event events[SERVE_MAX_EVENTS];
+    int stop = 0;
+    while (started > 0 && !stop) {
+        int n = epoll_wait(srv.epoll_fd, events, SERVE_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &signal_tag) {
+                stop = 1;          // 本轮其余事件照常处理，下一轮不再等待
+            } else if (ptr == &listen_tag) {
+                accept_sessions(&srv);
+            } else if (ptr == &wake_tag) {
+                collect_moves(&srv);
+            } else {
+                struct session *s = ptr;
+                if (s->dead) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    session_close(&srv, s);    // 对方两个方向都已关闭，结果也送不出去了
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    session_read(&srv, s);
+                }
+                if (!s->dead && (events[i].events & EPOLLOUT)) {
+                    session_flush(&srv, s);
+                }
+                session_pump(&srv, s);
+            }
+        }
+        while (srv.graveyard) {
+            struct session *s = srv.graveyard;
+            srv.graveyard = s->link;
+            session_free(&srv, s);
+        }
+    }
+
+    pthread_mutex_lock(&srv.lock);
+    srv.quit = 1;
+    pthread_cond_broadcast(&srv.cond);
+    pthread_mutex_unlock(&srv.lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    while (srv.all) {
+        if (!srv.all->dead) {
+            close(srv.all->fd);
+        }
+        session_free(&srv, srv.all);
+    }
+    fprintf(stderr, "服务结束：共 %ld 个连接，%ld 步，关闭时仍有 %ld 个连接\n", srv.sessions, srv.moves, srv.active);
+    close(srv.listen_fd);
+    close(srv.wake_fd);
+    close(srv.epoll_fd);
+    unlink(options->path);
+    pthread_mutex_destroy(&srv.lock);
+    pthread_cond_destroy(&srv.cond);
+
+    // 取走已收到的停止信号，恢复屏蔽字后它们不会再按原来的处理方式送达一次
+    struct signalfd_siginfo info;
+    while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+    }
+    close(signal_fd);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    return started > 0 ? 0 : -1;
+}
@@ -0,0 +1,28 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "pta_io.h"
+#include "selfplay.h"
+
+// 多局服务：在 Unix 域套接字上同时进行许多局 PTA 对局
+// 每个连接是一局，输入输出与 play_game_pta() 相同（格式由 format 和 boards 决定），只是每步立即输出，
+// ! 请求被忽略。X 结束一局后连接保留，之后的方块开始新的一局。无法识别的字符使服务端关闭这个连接。
+//
+// 主线程用 epoll 收发所有连接的数据并解码方块；凑齐当前和下一个方块后把这一局交给固定数量的
+// 工作线程搜索，工作线程算完后经 eventfd 通知主线程输出。一局同一时刻最多只有一步在搜索。
+// 对方不读输出时暂停处理它的输入，输入缓冲满时暂停读取，一个连接占用的内存有上限。
+
+struct serve_options {
+    const char *path;                    // 套接字路径，已存在的文件会被替换
+    int workers;                         // 搜索线程数
+    enum pta_format format;
+    int boards;
+    const struct move_options *moves;    // 各工作线程共用，pool 须为 NULL
+};
+
+// 运行到收到 SIGINT 或 SIGTERM 为止，结束时删除套接字文件并在 stderr 输出统计；无法启动时返回 -1
+// 运行期间在调用线程（及工作线程）中屏蔽这两个信号，经 signalfd 接收，不改动进程的信号处理函数；
+// 进程中其他线程也须屏蔽它们，否则发给进程的信号可能按原来的处理方式送到那些线程
+int run_server(const struct serve_options *options);
+
+#endif // SERVER_H
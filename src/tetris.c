@@ -3,249 +3,33 @@
 #include <time.h> 
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
 #include "tetris.h"
 #include "print_utils.h"
+#include "thread_pool.h"
+#include "ttable.h"
+#include "placement_simd.h"
+#include "board_features.h"
+#include "bitboard.h"
+#include "movegen.h"
+#include "beam.h"
+#include "search_stats.h"
 
 const char piece_names[PIECE_TYPES] = {'I', 'T', 'O', 'J', 'L', 'S', 'Z'};
 
-static const int64_t LANDING_HEIGHT = (int64_t) (WEIGHT_LANDING_HEIGHT * 10000);
-static const int64_t HOLES = (int64_t) (WEIGHT_HOLES * 10000);
-static const int64_t ROW_TRANSITIONS = (int64_t) (WEIGHT_ROW_TRANSITIONS * 10000);
-static const int64_t COL_TRANSITIONS = (int64_t) (WEIGHT_COLUMN_TRANSITIONS * 10000);
-static const int64_t WELL_SUMS = (int64_t) (WEIGHT_WELL_SUMS * 10000);
-static const int64_t ROWS_ELIMINATED = (int64_t) (WEIGHT_ROWS_ELIMINATED * 10000);
-
-
-// 俄罗斯方块形状定义
-struct piece pieces[] = {
-    // I
-    {
-        2,  // rotation count
-        {
-            {
-                4,  // width
-                1,  // height
-                { 0b1111 }  // shape
-            },
-            {
-                1,  // width
-                4,  // height
-                { 0b1,
-                  0b1,
-                  0b1,
-                  0b1
-                }
-            }
-        }
-    },
-
-    // T
-    {
-        4,  // rotation count
-        {
-            {
-                3,  // width
-                2,  // height
-                { 0b111,
-                  0b010
-                }
-            },
-            {
-                2,  // width
-                3,  // height
-                { 0b01,
-                  0b11,
-                  0b01
-                }
-            },
-            {
-                3,  // width
-                2,  // height
-                { 0b010,
-                  0b111
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b10,
-                  0b11,
-                  0b10
-                }
-            }
-        }
-    },
-
-    // O
-    {
-        1,  // rotation count
-        {
-            {
-                2,  // width
-                2,  // height
-                { 0b11,
-                  0b11
-                }
-            }
-        }
-    },
-
-    // J
-    {
-        4,  // rotation count
-        {
-            {
-                3,  // width
-                2,  // height
-                { 0b111,
-                  0b001
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b01,
-                  0b01,
-                  0b11
-                }
-            },
-            {
-                3,   // width
-                2,   // height
-                { 0b100,
-                  0b111
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b11,
-                  0b10,
-                  0b10
-                }
-            }
-        }
-    },
-
-    // L
-    {
-        4,  // rotation count
-        {
-            {
-                3,  // width
-                2,  // height
-                { 0b111,
-                  0b100
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b11,
-                  0b01,
-                  0b01
-                }
-            },
-            {
-                3,   // width
-                2,   // height
-                { 0b001,
-                  0b111
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b10,
-                  0b10,
-                  0b11
-                }
-            }
-        }
-    },
-
-    // S
-    {
-        2,  // rotation count
-        {
-            {
-                3,  // width
-                2,  // height
-                { 0b011,
-                  0b110
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b10,
-                  0b11,
-                  0b01
-                }
-            }
-        }
-    },
-
-    // Z
-    {
-        2,  // rotation count
-        {
-            {
-                3,  // width
-                2,  // height
-                { 0b110,
-                  0b011
-                }
-            },
-            {
-                2,   // width
-                3,   // height
-                { 0b01,
-                  0b11,
-                  0b10
-                }
-            }
-        }
-    }
+const struct eval_weights EVAL_WEIGHTS_DEFAULT = {
+    .landing_height  = (int64_t) (WEIGHT_LANDING_HEIGHT * EVAL_WEIGHT_SCALE),
+    .rows_eliminated = (int64_t) (WEIGHT_ROWS_ELIMINATED * EVAL_WEIGHT_SCALE),
+    .row_transitions = (int64_t) (WEIGHT_ROW_TRANSITIONS * EVAL_WEIGHT_SCALE),
+    .col_transitions = (int64_t) (WEIGHT_COLUMN_TRANSITIONS * EVAL_WEIGHT_SCALE),
+    .holes           = (int64_t) (WEIGHT_HOLES * EVAL_WEIGHT_SCALE),
+    .wells           = (int64_t) (WEIGHT_WELL_SUMS * EVAL_WEIGHT_SCALE),
 };
 
 
-static void init_pieces() {
-    for (int i = 0; i < PIECE_TYPES; i++) {
-        for (int j = 0; j < MAX_ROTATIONS; j++) {
-            struct rotation *rot = &pieces[i].rotations[j];
-            for (int k = 0; k < rot->height; k++) {
-                uint16_t s = rot->shape[k];
-                rot->hstart[k] = 0;
-                while ((s & 1) == 0) {
-                    rot->hstart[k]++;
-                    s = s >> 1;
-                }
-                rot->hend[k] = rot->hstart[k];
-                while ((s & 1) == 1) {
-                    rot->hend[k]++;
-                    s = s >> 1;
-                }
-                rot->hspan[k] = rot->hend[k] - rot->hstart[k];
-            }
-            
-            for (int k = 0; k < rot->width; k++) {
-                int v = 0;
-                rot->vstart[k] = 0;
-                while ((rot->shape[v] & (1 << k)) == 0) {
-                    rot->vstart[k]++;
-                    v++;
-                }
-                rot->vend[k] = v;
-                while ((v < rot->height) && (((rot->shape[v] & (1 << k))) != 0)) {
-                    rot->vend[k]++;
-                    v++;
-                }
-                rot->vspan[k] = rot->vend[k] - rot->vstart[k];
-            }
-        }
-    }
-}
+// 俄罗斯方块形状定义及旋转元数据，由 tools/gen_pieces.c 在编译时生成
+#include "pieces_table.h"
 
 // 调用者负责检查行列是否越界
 // col:  0---15
@@ -256,18 +40,6 @@ static inline int get_status(struct tetris *t, int row, int col) {
     return (t->board[row] & (1 << col)); // 检查该位置是否有方块
 }
 
-static inline int get_landing_row(struct tetris *t, const struct rotation *rot, int col) {
-    int row = 0;  // 棋盘的最底行
-    for (int i = 0; i < rot->width; i++) {
-        int r =  t->col_height[col + i] - rot->vstart[i];
-        if (r > row) {
-            row = r;
-        }
-    }
-
-    return row;
-}
-
 static inline int get_center_of_gravity(const struct rotation *rot, int landing_row) {
     int cg = 0;
     for (int i = 0; i < rot->height; i++) {
@@ -278,9 +50,6 @@ static inline int get_center_of_gravity(const struct rotation *rot, int landing_
 }
 
 void init_tetris(struct tetris *t) {
-    srand(time(NULL)); // 初始化随机数种子
-    init_pieces();
-
     memset(t, 0, sizeof(struct tetris)); // 初始化棋盘
     for (int i = 0; i < ROW; i++) {
         t->board[i] = EMPTY_ROW; // 初始化棋盘为空
@@ -295,7 +64,13 @@ int get_piece_name(int piece) {
     return piece_names[piece];
 }
 
+int get_piece_index(int name) {
+    const char *p = name ? memchr(piece_names, name, PIECE_TYPES) : NULL;
+    return p ? (int) (p - piece_names) : -1;
+}
+
 void place_piece(struct tetris *t, const struct piece *p, int rotation, int col) {
+    STATS_ADD(place_piece, 1);
     t->rows_eliminated = 0;
     const struct rotation *rot = &p->rotations[rotation];
     t->landing_row = get_landing_row(t, rot, col);
@@ -384,40 +159,493 @@ void place_piece(struct tetris *t, const struct piece *p, int rotation, int col)
     }
 }
 
-int64_t evaluate_board(const struct tetris *t) {
-    if (t->landing_row == -1) {
-        return INT64_MIN;
+void place_piece_at(struct tetris *t, const struct piece *p, int rotation, int col, int row) {
+    const struct rotation *rot = &p->rotations[rotation];
+    if (row == get_landing_row(t, rot, col)) {
+        place_piece(t, p, rotation, col);
+        return;
+    }
+    STATS_ADD(place_piece, 1);
+    t->rows_eliminated = 0;
+    t->landing_row = row;
+    if (row < 0 || row + rot->height > ROW) {
+        t->landing_row = -1;
+        return;
+    }
+
+    // 塞在悬空方块下面，增量计数的前提（方块落在各列顶上）不成立，落子消行后整盘重算
+    int max_height = t->max_height > row + rot->height ? t->max_height : row + rot->height;
+    for (int i = 0; i < rot->height; i++) {
+        t->board[row + i] |= rot->shape[i] << col;
+    }
+    for (int i = rot->height - 1; i >= 0; i--) {
+        int r = row + i;
+        if (t->board[r] == FULL_ROW) {
+            memmove(&t->board[r], &t->board[r + 1], sizeof(uint16_t) * (ROW - 1 - r));
+            t->board[ROW - 1] = EMPTY_ROW;
+            t->rows_eliminated++;
+            max_height--;
+        }
+    }
+    struct board_features f;
+    compute_board_features(t, &f);
+    memcpy(t->col_height, f.col_height, sizeof(t->col_height));
+    t->max_height = max_height;      // 与 place_piece() 一样只保证是上界
+    t->holes = f.holes;
+    t->row_transitions = f.row_transitions;
+    t->col_transitions = f.col_transitions;
+    t->wells = f.wells;
+}
+
+void place_piece_undoable(struct tetris *t, const struct piece *p, int rotation, int col, struct undo_record *undo) {
+    const struct rotation *rot = &p->rotations[rotation];
+    int landing_row = get_landing_row(t, rot, col);
+
+    _Static_assert(offsetof(struct tetris, reserved) + 1 - offsetof(struct tetris, max_height)
+                   == sizeof(undo->scalars), "undo_record.scalars must cover max_height..reserved");
+    memcpy(undo->scalars, &t->max_height, sizeof(undo->scalars));
+    undo->first_row = 0;
+    undo->row_count = 0;
+    undo->first_col = 0;
+    undo->col_count = 0;
+    if (landing_row + rot->height > ROW) {
+        place_piece(t, p, rotation, col);   // 非法落点只改写 landing_row 与 rows_eliminated
+        return;
+    }
+
+    // 会消行时上方各行整体下移、所有列高度都可能变化，否则只涉及方块覆盖的行和列
+    int clears = 0;
+    for (int i = 0; i < rot->height; i++) {
+        if ((t->board[landing_row + i] | (rot->shape[i] << col)) == FULL_ROW) {
+            clears = 1;
+            break;
+        }
+    }
+    int row_end = landing_row + rot->height;
+    if (clears && t->max_height > row_end) {
+        row_end = t->max_height;
     }
+    undo->first_row = landing_row;
+    undo->row_count = row_end - landing_row;
+    memcpy(undo->rows, &t->board[landing_row], sizeof(uint16_t) * undo->row_count);
 
+    undo->first_col = clears ? 0 : col;
+    undo->col_count = clears ? COL + 2 * COL_SHIFT : rot->width;
+    memcpy(undo->col_height, &t->col_height[undo->first_col], undo->col_count);
+
+    place_piece(t, p, rotation, col);
+}
+
+void undo_piece(struct tetris *t, const struct undo_record *undo) {
+    memcpy(&t->board[undo->first_row], undo->rows, sizeof(uint16_t) * undo->row_count);
+    memcpy(&t->col_height[undo->first_col], undo->col_height, undo->col_count);
+    memcpy(&t->max_height, undo->scalars, sizeof(undo->scalars));
+}
+
+// 按 Dellacherie 特征计算评分，evaluate_board() 与向量化内核共用
+static inline int64_t score_features(const struct eval_weights *w, const struct tetris *t, int landing_row,
+                                     int rows_eliminated, int max_height,
+                                     int holes, int row_transitions, int col_transitions, int wells) {
     int64_t score = 0;
-    if (t->rows_eliminated == 1 && t->max_height < 11) {
-        score -= (int64_t) 12 * ROWS_ELIMINATED;
+    if (rows_eliminated == 1 && max_height < 11) {
+        score -= (int64_t) 12 * w->rows_eliminated;
     }
     else {
-        score += (int64_t) 2 * t->rows_eliminated * ROWS_ELIMINATED;
+        score += (int64_t) 2 * rows_eliminated * w->rows_eliminated;
     }
-    struct rotation *rot = &pieces[t->piece].rotations[t->rotation];
-    score += (int64_t )get_center_of_gravity(rot, t->landing_row) * LANDING_HEIGHT;
-    score += (int64_t) t->col_transitions * COL_TRANSITIONS;
-    score += (int64_t) t->row_transitions * ROW_TRANSITIONS; 
-    score += (int64_t) t->wells * WELL_SUMS;
-    score += (int64_t) t->holes * HOLES;
+    const struct rotation *rot = &pieces[t->piece].rotations[t->rotation];
+    score += (int64_t )get_center_of_gravity(rot, landing_row) * w->landing_height;
+    score += (int64_t) col_transitions * w->col_transitions;
+    score += (int64_t) row_transitions * w->row_transitions; 
+    score += (int64_t) wells * w->wells;
+    score += (int64_t) holes * w->holes;
 
     return score;
 }
 
+static inline int64_t evaluate_board_incremental(const struct tetris *t, const struct eval_weights *w) {
+    if (t->landing_row == -1) {
+        return INT64_MIN;
+    }
+    return score_features(w, t, t->landing_row, t->rows_eliminated, t->max_height,
+                          t->holes, t->row_transitions, t->col_transitions, t->wells);
+}
+
+// max_height 沿用增量计数中的值（消行后是上界），保证与增量版本的评分逐位一致
+int64_t evaluate_board_full(const struct tetris *t, const struct eval_weights *w) {
+    if (t->landing_row == -1) {
+        return INT64_MIN;
+    }
+    struct board_features f;
+    compute_board_features(t, &f);
+    return score_features(w ? w : &EVAL_WEIGHTS_DEFAULT, t, t->landing_row, t->rows_eliminated, t->max_height,
+                          f.holes, f.row_transitions, f.col_transitions, f.wells);
+}
+
+#if defined(TETRIS_CHECK_EVAL)
+// 每次评估都与整盘重算的特征核对，发现漂移立即报告并退出
+int64_t evaluate_board(const struct tetris *t, const struct eval_weights *w) {
+    struct board_features f;
+    int diff = t->landing_row == -1 ? 0 : check_board_features(t, &f);
+    if (diff) {
+        fprintf(stderr, "增量特征漂移 (0x%x): holes %d/%d, row_transitions %d/%d, col_transitions %d/%d, wells %d/%d\n",
+                diff, t->holes, f.holes, t->row_transitions, f.row_transitions,
+                t->col_transitions, f.col_transitions, t->wells, f.wells);
+        print_board(t);
+        abort();
+    }
+    return evaluate_board_incremental(t, w ? w : &EVAL_WEIGHTS_DEFAULT);
+}
+#elif defined(TETRIS_FULL_EVAL)
+int64_t evaluate_board(const struct tetris *t, const struct eval_weights *w) {
+    return evaluate_board_full(t, w);
+}
+#else
+int64_t evaluate_board(const struct tetris *t, const struct eval_weights *w) {
+    return evaluate_board_incremental(t, w ? w : &EVAL_WEIGHTS_DEFAULT);
+}
+#endif
+
+// -1 表示尚未检测 CPU
+static atomic_int placement_simd = -1;
+
+void set_placement_simd(int enabled) {
+    atomic_store(&placement_simd, enabled && placement_simd_supported());
+}
+
+static inline int use_placement_simd(void) {
+#if defined(TETRIS_FULL_EVAL) || defined(TETRIS_CHECK_EVAL)
+    return 0;    // 向量化内核自己算特征，绕过了所选的评估函数
+#endif
+    int mode = atomic_load_explicit(&placement_simd, memory_order_relaxed);
+    if (mode < 0) {
+        mode = placement_simd_supported();
+        atomic_store(&placement_simd, mode);
+    }
+    return mode;
+}
+
+static atomic_int board_backend = BOARD_BACKEND_ROWS;
+
+void set_board_backend(enum board_backend backend) {
+    atomic_store(&board_backend, backend);
+}
+
+enum board_backend get_board_backend(void) {
+    return atomic_load_explicit(&board_backend, memory_order_relaxed);
+}
+
+static inline int use_bitboard(void) {
+#if defined(TETRIS_FULL_EVAL) || defined(TETRIS_CHECK_EVAL)
+    return 0;    // 与向量化内核一样绕过了所选的评估函数
+#endif
+    return get_board_backend() == BOARD_BACKEND_BITBOARD;
+}
+
+static int score_placements_bitboard(const struct tetris *t, const struct eval_weights *w, int piece_index,
+                                     int rotation, int64_t *scores) {
+    const struct rotation *rot = &pieces[piece_index].rotations[rotation];
+    struct bitboard board;
+    bitboard_from_tetris(&board, t);
+    int count = 0;
+    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+        struct bitboard b = board;
+        int rows_eliminated;
+        int landing_row = bitboard_place(&b, rot, col, &rows_eliminated);
+        if (landing_row == -1) {
+            STATS_ADD(invalid, 1);
+            scores[count++] = INT64_MIN;
+            continue;
+        }
+        struct board_features f;
+        bitboard_features(&b, &f);
+        // max_height 按 place_piece() 的口径取落子前的上界与方块顶部中较高者，再减去消除的行数
+        int max_height = t->max_height > landing_row + rot->height ? t->max_height : landing_row + rot->height;
+        scores[count++] = score_features(w, t, landing_row, rows_eliminated, max_height - rows_eliminated,
+                                         f.holes, f.row_transitions, f.col_transitions, f.wells);
+    }
+    STATS_ADD(placements, count);
+    return count;
+}
+
+static int score_placements_scalar(const struct tetris *t, const struct eval_weights *w, int piece_index,
+                                   int rotation, int64_t *scores) {
+    const struct rotation *rot = &pieces[piece_index].rotations[rotation];
+    int count = 0;
+    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+        struct tetris temp_tetris = *t;
+        place_piece(&temp_tetris, &pieces[piece_index], rotation, col);
+        STATS_ADD(invalid, temp_tetris.landing_row == -1);
+        scores[count++] = evaluate_board(&temp_tetris, w);
+    }
+    STATS_ADD(placements, count);
+    return count;
+}
+
+int score_placements(const struct tetris *t, const struct eval_weights *w, int piece_index, int rotation,
+                     int64_t *scores) {
+    if (w == NULL) {
+        w = &EVAL_WEIGHTS_DEFAULT;
+    }
+    if (use_bitboard()) {
+        return score_placements_bitboard(t, w, piece_index, rotation, scores);
+    }
+    if (!use_placement_simd()) {
+        return score_placements_scalar(t, w, piece_index, rotation, scores);
+    }
+
+    const struct rotation *rot = &pieces[piece_index].rotations[rotation];
+    struct placement_features f;
+    int count = placement_features_avx2(t, rot, &f);
+    STATS_ADD(placements, count);
+    for (int i = 0; i < count; i++) {
+        if (f.landing_row[i] == -1) {
+            STATS_ADD(invalid, 1);
+            scores[i] = INT64_MIN;
+        } else if (f.needs_scalar & (1 << i)) {
+            // 会消行的列交给标量版处理
+            struct tetris temp_tetris = *t;
+            place_piece(&temp_tetris, &pieces[piece_index], rotation, COL_SHIFT + i);
+            scores[i] = evaluate_board(&temp_tetris, w);
+        } else {
+            scores[i] = score_features(w, t, f.landing_row[i], 0, t->max_height,
+                                       f.holes[i], f.row_transitions[i], f.col_transitions[i], f.wells[i]);
+        }
+    }
+    return count;
+}
+
+void board_batch_set(struct board_batch *batch, int index, const struct tetris *t) {
+    for (int r = 0; r < ROW; r++) {
+        batch->rows[r][index] = t->board[r];
+    }
+    for (int c = 0; c < COL + 2 * COL_SHIFT; c++) {
+        batch->col_height[c][index] = t->col_height[c];
+    }
+    batch->landing_row[index] = t->landing_row;
+    batch->rows_eliminated[index] = t->rows_eliminated;
+    batch->max_height[index] = t->max_height;
+    batch->holes[index] = t->holes;
+    batch->row_transitions[index] = t->row_transitions;
+    batch->col_transitions[index] = t->col_transitions;
+    batch->wells[index] = t->wells;
+    batch->piece[index] = t->piece;
+    batch->rotation[index] = t->rotation;
+}
+
+void board_batch_get(const struct board_batch *batch, int index, struct tetris *t) {
+    t->pad0 = FULL_ROW;
+    t->reserved = 0;
+    for (int r = 0; r < ROW; r++) {
+        t->board[r] = batch->rows[r][index];
+    }
+    for (int c = 0; c < COL + 2 * COL_SHIFT; c++) {
+        t->col_height[c] = batch->col_height[c][index];
+    }
+    t->landing_row = batch->landing_row[index];
+    t->rows_eliminated = batch->rows_eliminated[index];
+    t->max_height = batch->max_height[index];
+    t->holes = batch->holes[index];
+    t->row_transitions = batch->row_transitions[index];
+    t->col_transitions = batch->col_transitions[index];
+    t->wells = batch->wells[index];
+    t->piece = batch->piece[index];
+    t->rotation = batch->rotation[index];
+}
+
+#ifdef TETRIS_STATS
+static int count_invalid(const struct board_batch *batch) {
+    int invalid = 0;
+    for (int i = 0; i < batch->count; i++) {
+        invalid += batch->landing_row[i] == -1;
+    }
+    return invalid;
+}
+#endif
+
+int place_piece_batch(const struct tetris *t, int piece_index, struct board_batch *batch) {
+    const struct piece *p = &pieces[piece_index];
+    int n = 0;
+    for (int j = 0; j < p->count; j++) {
+        n += COL - p->rotations[j].width + 1;
+    }
+    batch->count = n;
+
+    // 先把父局面广播到所有落点，再逐个改动方块覆盖的行和列
+    for (int r = 0; r < ROW; r++) {
+        for (int i = 0; i < n; i++) {
+            batch->rows[r][i] = t->board[r];
+        }
+    }
+    for (int c = 0; c < COL + 2 * COL_SHIFT; c++) {
+        for (int i = 0; i < n; i++) {
+            batch->col_height[c][i] = t->col_height[c];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        batch->rows_eliminated[i] = 0;
+        batch->piece[i] = t->piece;
+        batch->rotation[i] = t->rotation;
+    }
+
+    int simd = use_placement_simd();
+    n = 0;
+    for (int j = 0; j < p->count; j++) {
+        const struct rotation *rot = &p->rotations[j];
+        struct placement_features f;
+        int count = COL - rot->width + 1;
+        if (simd) {
+            placement_features_avx2(t, rot, &f);
+        }
+        for (int i = 0; i < count; i++, n++) {
+            int col = COL_SHIFT + i;
+            batch->move_rotation[n] = j;
+            batch->move_col[n] = col;
+            if (!simd || f.landing_row[i] == -1 || (f.needs_scalar & (1 << i))) {
+                // 没有内核、非法落点或会消行时走标量路径
+                struct tetris child = *t;
+                place_piece(&child, p, j, col);
+                board_batch_set(batch, n, &child);
+                continue;
+            }
+            int landing = f.landing_row[i];
+            batch->landing_row[n] = landing;
+            batch->holes[n] = f.holes[i];
+            batch->row_transitions[n] = f.row_transitions[i];
+            batch->col_transitions[n] = f.col_transitions[i];
+            batch->wells[n] = f.wells[i];
+            batch->max_height[n] = landing + rot->height > t->max_height ? landing + rot->height : t->max_height;
+            for (int k = 0; k < rot->height; k++) {
+                batch->rows[landing + k][n] |= rot->shape[k] << col;
+            }
+            for (int k = 0; k < rot->width; k++) {
+                batch->col_height[col + k][n] = landing + rot->vend[k];
+            }
+        }
+    }
+    STATS_ADD(placements, n);
+    STATS_ADD(invalid, count_invalid(batch));
+    return n;
+}
+
+#if !defined(TETRIS_FULL_EVAL) && !defined(TETRIS_CHECK_EVAL)
+// 只读取特征计数，不访问行与列高度
+static void evaluate_batch_features(const struct board_batch *batch, const struct eval_weights *w, int64_t *out) {
+    int n = batch->count;
+    int32_t cg[BOARD_BATCH_MAX];
+    for (int i = 0; i < n; i++) {
+        cg[i] = get_center_of_gravity(&pieces[batch->piece[i]].rotations[batch->rotation[i]], batch->landing_row[i]);
+    }
+    // 与 score_features() 相同的公式，逐棋盘独立、没有分支依赖，可以向量化
+    for (int i = 0; i < n; i++) {
+        int64_t rows_eliminated = batch->rows_eliminated[i];
+        int64_t score = (rows_eliminated == 1 && batch->max_height[i] < 11)
+                      ? -12 * w->rows_eliminated : 2 * rows_eliminated * w->rows_eliminated;
+        score += (int64_t) cg[i] * w->landing_height;
+        score += (int64_t) batch->col_transitions[i] * w->col_transitions;
+        score += (int64_t) batch->row_transitions[i] * w->row_transitions;
+        score += (int64_t) batch->wells[i] * w->wells;
+        score += (int64_t) batch->holes[i] * w->holes;
+        out[i] = batch->landing_row[i] == -1 ? INT64_MIN : score;
+    }
+}
+#endif
+
+void evaluate_batch(const struct board_batch *batch, const struct eval_weights *w, int64_t *out) {
+    if (w == NULL) {
+        w = &EVAL_WEIGHTS_DEFAULT;
+    }
+#if defined(TETRIS_FULL_EVAL) || defined(TETRIS_CHECK_EVAL)
+    // 所选的评估函数需要整块棋盘
+    for (int i = 0; i < batch->count; i++) {
+        struct tetris t;
+        board_batch_get(batch, i, &t);
+        out[i] = evaluate_board(&t, w);
+    }
+#else
+    evaluate_batch_features(batch, w, out);
+#endif
+}
+
+void evaluate_boards(const struct tetris *boards, size_t n, const struct eval_weights *w, int64_t *out) {
+#if defined(TETRIS_FULL_EVAL) || defined(TETRIS_CHECK_EVAL)
+    for (size_t i = 0; i < n; i++) {
+        out[i] = evaluate_board(&boards[i], w);
+    }
+#else
+    if (w == NULL) {
+        w = &EVAL_WEIGHTS_DEFAULT;
+    }
+    struct board_batch batch;
+    for (size_t start = 0; start < n; start += BOARD_BATCH_MAX) {
+        int m = n - start < BOARD_BATCH_MAX ? (int) (n - start) : BOARD_BATCH_MAX;
+        for (int i = 0; i < m; i++) {
+            const struct tetris *t = &boards[start + i];
+            batch.landing_row[i] = t->landing_row;
+            batch.rows_eliminated[i] = t->rows_eliminated;
+            batch.max_height[i] = t->max_height;
+            batch.holes[i] = t->holes;
+            batch.row_transitions[i] = t->row_transitions;
+            batch.col_transitions[i] = t->col_transitions;
+            batch.wells[i] = t->wells;
+            batch.piece[i] = t->piece;
+            batch.rotation[i] = t->rotation;
+        }
+        batch.count = m;
+        evaluate_batch_features(&batch, w, out + start);
+    }
+#endif
+}
+
+// 置换表中区分是否考虑了硬降以外的落点
+#define REACHABLE_TAG 0x5BD1E9955BD1E995ULL
+
+// 在局面 t 上枚举 piece_index 的所有落点，返回最高评分；reachable 非 0 时还包括 generate_tucks() 的落点
+// 结果只取决于局面本身，所以按局面哈希缓存在置换表中（剩余深度为 1）
+// 置换表关闭时 hash 不会被使用，调用者可以传 0 省去哈希计算；非默认权重须由调用者混入 hash
+static int64_t best_placement_score(const struct tetris *t, const struct eval_weights *w, uint64_t hash,
+                                    int piece_index, int reachable) {
+    uint64_t key = tt_key(reachable ? hash ^ REACHABLE_TAG : hash, piece_index, 1);
+    int64_t best = INT64_MIN;
+    if (tt_probe(key, &best)) {
+        return best;
+    }
+    for (int j = 0; j < pieces[piece_index].count; j++) {
+        int64_t scores[COL];
+        int count = score_placements(t, w, piece_index, j, scores);
+        for (int i = 0; i < count; i++) {
+            if (scores[i] > best) {
+                best = scores[i];
+            }
+        }
+    }
+    if (reachable) {
+        struct placement tucks[MAX_REACHABLE_PLACEMENTS];
+        int n = generate_tucks(t, piece_index, tucks);
+        STATS_ADD(placements, n);
+        for (int i = 0; i < n; i++) {
+            struct tetris child = *t;
+            place_piece_at(&child, &pieces[piece_index], tucks[i].rotation, tucks[i].col, tucks[i].row);
+            int64_t score = evaluate_board(&child, w);
+            if (score > best) {
+                best = score;
+            }
+        }
+    }
+    tt_store(key, best);
+    return best;
+}
+
 void select_best_move(struct tetris *t, int piece_index, int *best_rotation, int *best_col) {
     int64_t best_score = INT64_MIN;
     for (int j = 0; j < pieces[piece_index].count; j++) {
-        const struct rotation *rot = &pieces[piece_index].rotations[j];
-        for (int col = COL_SHIFT; col < COL_SHIFT + COL - rot->width + 1; col++) {
-            struct tetris temp_tetris = *t;
-            place_piece(&temp_tetris, &pieces[piece_index], j, col);
-            int64_t score = evaluate_board(&temp_tetris);
-            if (score > best_score) {
-                best_score = score;
+        int64_t scores[COL];
+        int count = score_placements(t, &EVAL_WEIGHTS_DEFAULT, piece_index, j, scores);
+        for (int i = 0; i < count; i++) {
+            if (scores[i] > best_score) {
+                best_score = scores[i];
                 *best_rotation = j;
-                *best_col = col;
+                *best_col = COL_SHIFT + i;
             }
         }
     }
@@ -431,25 +659,17 @@ void select_best_move_with_next(
     int *best_col
 ) {
     int64_t best_score = INT64_MIN;
+    struct tetris work = *t;
     for (int j = 0; j < pieces[curr_piece_index].count; j++) {
         const struct rotation *rot = &pieces[curr_piece_index].rotations[j];
         for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
-            struct tetris temp_tetris = *t;
-            place_piece(&temp_tetris, &pieces[curr_piece_index], j, col);
-            int64_t bonus = (int64_t) get_center_of_gravity(rot, t->landing_row) * LANDING_HEIGHT / 4;
-
-            int64_t next_best = INT64_MIN;
-            for (int nj = 0; nj < pieces[next_piece_index].count; nj++) {
-                const struct rotation *nrot = &pieces[next_piece_index].rotations[nj];
-                for (int ncol = COL_SHIFT; ncol <= COL_SHIFT + COL - nrot->width; ncol++) {
-                    struct tetris next_tetris = temp_tetris;
-                    place_piece(&next_tetris, &pieces[next_piece_index], nj, ncol);
-                    int64_t score = evaluate_board(&next_tetris);
-                    if (score > next_best) {
-                        next_best = score;
-                    }
-                }
-            }
+            struct undo_record undo;
+            place_piece_undoable(&work, &pieces[curr_piece_index], j, col, &undo);
+            int64_t bonus = (int64_t) get_center_of_gravity(rot, t->landing_row) * EVAL_WEIGHTS_DEFAULT.landing_height / 4;
+
+            int64_t next_best = best_placement_score(&work, &EVAL_WEIGHTS_DEFAULT,
+                                                     tt_enabled() ? hash_tetris(&work) : 0, next_piece_index, 0);
+            undo_piece(&work, &undo);
             int64_t total_score = bonus + next_best;
             if (total_score > best_score) {
                 best_score = total_score;
@@ -461,139 +681,792 @@ void select_best_move_with_next(
 }
 
 
-// 辅助函数：生成 beam 节点
-static int generate_beam(struct tetris *t, int piece_index, struct BeamNode *beam, int beam_width) {
-    int beam_size = 0;
-    for (int i = 0; i < pieces[piece_index].count; i++) {
-        const struct rotation *rot = &pieces[piece_index].rotations[i];
-        for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
-            struct tetris temp_tetris = *t;
-            place_piece(&temp_tetris, &pieces[piece_index], i, col);
-            int64_t curr_score = evaluate_board(&temp_tetris);
-
-            // 插入 beam 数组，按分数从大到小排序，保留前 beam_width 个
-            int insert_pos = beam_size;
-            while (insert_pos > 0 && beam[insert_pos - 1].score < curr_score) {
-                if (insert_pos < beam_width) beam[insert_pos] = beam[insert_pos - 1];
-                insert_pos--;
+// 一个局面上某个方块全部硬降落点的评分，按 score_placements() 逐个旋转排列的顺序
+// 逐节点搜索在根节点的每个候选下展开已知的下一个方块时记下这些评分；
+// 选中的候选落子后，下一步的根节点正是这个局面和这个方块，直接沿用评分
+struct search_expansion {
+    uint64_t hash;                       // 被展开局面的 hash_tetris()
+    uint64_t weights_tag;                // 按权重的取值区分，不比较指针：权重所在的内存可能被释放后另作他用
+    int piece;
+    int count;                           // 0 表示没有记录
+    int64_t scores[BOARD_BATCH_MAX];
+};
+
+// 本线程上一步搜索留下的记录。评分只取决于局面、方块和权重，与是哪一局无关，所以不需要在对局之间清除
+static _Thread_local struct search_expansion carried_expansion;
+
+void forget_search_expansion(void) {
+    carried_expansion.count = 0;
+}
+
+// 按 scores 中的下标（各旋转的落点依次排列）填写 beam 节点的落点，index 为 -1 表示硬降
+static void fill_beam_node(const struct tetris *t, int piece_index, int k, int64_t score, struct BeamNode *node) {
+    const struct piece *p = &pieces[piece_index];
+    int rotation = 0;
+    while (k > COL - p->rotations[rotation].width) {
+        k -= COL - p->rotations[rotation].width + 1;
+        rotation++;
+    }
+    node->rotation = rotation;
+    node->col = COL_SHIFT + k;
+    node->row = score == INT64_MIN ? -1 : get_landing_row(t, &p->rotations[rotation], COL_SHIFT + k);
+    node->index = -1;
+    node->score = score;
+}
+
+// 从 scores 中选出前 beam_width 个落点
+static int select_beam(const struct tetris *t, int piece_index, const int64_t *scores, int count,
+                       struct BeamNode *beam, int beam_width) {
+    int32_t order[BOARD_BATCH_MAX];
+    int beam_size = select_top_scores(scores, count, beam_width, order);
+    STATS_ADD(beam_cutoffs, count - beam_size);
+    for (int i = 0; i < beam_size; i++) {
+        fill_beam_node(t, piece_index, order[i], scores[order[i]], &beam[i]);
+    }
+    return beam_size;
+}
+
+// 辅助函数：生成 beam 节点，只记录落点和评分，子局面由调用者在原棋盘上落子并撤销（见 place_beam_node()）
+// record 非空时记下全部落点的评分
+static int generate_beam(const struct tetris *t, const struct eval_weights *w, int piece_index,
+                         struct BeamNode *beam, int beam_width, struct search_expansion *record) {
+    int64_t local[BOARD_BATCH_MAX];
+    int64_t *scores = record ? record->scores : local;
+    int count = 0;
+    for (int j = 0; j < pieces[piece_index].count; j++) {
+        count += score_placements(t, w, piece_index, j, scores + count);
+    }
+    if (record) {
+        record->count = count;
+    }
+    return select_beam(t, piece_index, scores, count, beam, beam_width);
+}
+
+// 与 generate_beam() 相同，但评分取自上一步的记录
+static int generate_beam_carried(const struct tetris *t, const struct search_expansion *carry,
+                                 struct BeamNode *beam, int beam_width) {
+    STATS_ADD(reused, 1);
+    return select_beam(t, carry->piece, carry->scores, carry->count, beam, beam_width);
+}
+
+// 与 generate_beam() 相同，但候选中还有 generate_tucks() 的落点（排在硬降落点之后）
+// 这类节点的 index 为它在 tucks 中的下标，落点行由 tucks 给出
+static int generate_beam_reachable(const struct tetris *t, const struct eval_weights *w, int piece_index,
+                                   struct BeamNode *beam, int beam_width) {
+    struct placement tucks[MAX_REACHABLE_PLACEMENTS];
+    int extra = generate_tucks(t, piece_index, tucks);
+    if (extra == 0) {
+        return generate_beam(t, w, piece_index, beam, beam_width, NULL);
+    }
+
+    int64_t scores[BOARD_BATCH_MAX + MAX_REACHABLE_PLACEMENTS];
+    int32_t order[BOARD_BATCH_MAX + MAX_REACHABLE_PLACEMENTS];
+    int count = 0;
+    for (int j = 0; j < pieces[piece_index].count; j++) {
+        count += score_placements(t, w, piece_index, j, scores + count);
+    }
+    for (int i = 0; i < extra; i++) {
+        struct tetris child = *t;
+        place_piece_at(&child, &pieces[piece_index], tucks[i].rotation, tucks[i].col, tucks[i].row);
+        scores[count + i] = evaluate_board(&child, w);
+    }
+    STATS_ADD(placements, extra);
+
+    int beam_size = select_top_scores(scores, count + extra, beam_width, order);
+    STATS_ADD(beam_cutoffs, count + extra - beam_size);
+    for (int i = 0; i < beam_size; i++) {
+        int k = order[i];
+        if (k < count) {
+            fill_beam_node(t, piece_index, k, scores[k], &beam[i]);
+            continue;
+        }
+        const struct placement *m = &tucks[k - count];
+        beam[i].rotation = m->rotation;
+        beam[i].col = m->col;
+        beam[i].row = m->row;
+        beam[i].index = k - count;
+        beam[i].score = scores[k];
+    }
+    return beam_size;
+}
+
+// 在 t 上落下 beam 中的一个落点，返回子局面；硬降落点原地落子，之后须用 undo_piece() 撤销，
+// 塞到悬空方块下面的落点没有可撤销的版本，复制到 scratch 上落子
+static inline struct tetris *place_beam_node(struct tetris *t, int piece_index, const struct BeamNode *node,
+                                             struct undo_record *undo, struct tetris *scratch) {
+    if (node->index < 0) {
+        place_piece_undoable(t, &pieces[piece_index], node->rotation, node->col, undo);
+        return t;
+    }
+    *scratch = *t;
+    place_piece_at(scratch, &pieces[piece_index], node->rotation, node->col, node->row);
+    return scratch;
+}
+
+// 通用搜索
+// 第 0 层是当前方块，第 1 层是已知的下一个方块（next 为负数时视为未知），
+// 更深的层次方块未知，按 policy 对 piece_mask 中的方块取平均（expectimax）或取最差（min-max）。
+// 非最后一层只展开按 evaluate_board 排名前 beam_width[ply] 的落点，
+// 每展开一层把该层的落点高度计入总分；最后一层取所有落点中的最高评分。
+
+struct search_ctx {
+    const struct search_policy *policy;
+    int depth;
+    int curr_piece;
+    int next_piece;
+    const struct eval_weights *weights;
+    uint64_t weights_tag;    // 非默认权重时混入置换表键，默认权重为 0
+    uint64_t policy_tag;     // 区分不同策略在置换表中的条目
+    int64_t deadline_ns;     // CLOCK_MONOTONIC 截止时间，0 表示不限时
+    atomic_int *aborted;     // 超时后置 1，本轮搜索的结果作废
+    struct search_expansion *expansion;   // 非空时第 1 层的已知方块节点把全部落点评分记在这里
+};
+
+struct search_root_task {
+    const struct search_ctx *ctx;
+    const struct tetris *root;
+    const struct BeamNode *beam;
+    struct search_expansion *expansions; // 各候选下第 1 层的记录，各任务只写自己的一项；NULL 表示不记录
+    int64_t scores[MAX_PLACEMENTS];
+};
+
+// 未知方块层在置换表中的标记，大于任何方块编号
+#define UNKNOWN_PIECE_TAG  0x100
+#define PLY_TAG_SHIFT      8
+
+static int64_t search_node(const struct search_ctx *ctx, struct tetris *t, int ply, int64_t alpha, int *exact);
+
+static inline int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 检查是否超过截止时间；超时的搜索返回的分数不可信，也不能写入置换表
+static inline int search_timed_out(const struct search_ctx *ctx) {
+    if (ctx->deadline_ns == 0) {
+        return 0;
+    }
+    if (atomic_load_explicit(ctx->aborted, memory_order_relaxed)) {
+        return 1;
+    }
+    if (monotonic_ns() >= ctx->deadline_ns) {
+        atomic_store_explicit(ctx->aborted, 1, memory_order_relaxed);
+        return 1;
+    }
+    return 0;
+}
+
+static inline int search_width(const struct search_ctx *ctx, int ply) {
+    int w = ctx->policy->beam_width[ply];
+    return (w <= 0 || w > MAX_PLACEMENTS) ? MAX_PLACEMENTS : w;
+}
+
+static inline int piece_at_ply(const struct search_ctx *ctx, int ply) {
+    if (ply == 0) {
+        return ctx->curr_piece;
+    }
+    if (ply == 1) {
+        return ctx->next_piece;
+    }
+    return -1;
+}
+
+// alpha - bonus，alpha 为 INT64_MIN 时保持不变
+static inline int64_t child_alpha(int64_t alpha, int64_t bonus) {
+    return alpha == INT64_MIN ? INT64_MIN : alpha - bonus;
+}
+
+// 已知方块的节点：在 beam 内的落点中取最高总分
+// 只有结果大于 alpha 时才保证精确，否则返回值只是不超过 alpha 的上界
+static int64_t search_known(const struct search_ctx *ctx, struct tetris *t, int piece, int ply,
+                            int64_t alpha, int *exact) {
+    *exact = 1;
+    struct search_expansion *record = NULL;
+    if (ply == 1 && ctx->expansion && !ctx->policy->reachable) {
+        record = ctx->expansion;
+        record->hash = hash_tetris(t);
+        record->weights_tag = ctx->weights_tag;
+        record->piece = piece;
+        record->count = 0;
+    }
+    if (ply == ctx->depth - 1) {
+        STATS_ADD(nodes[ply], 1);
+        STATS_CLOCK(start);
+        int64_t best;
+        if (record) {
+            // 要记下每个落点的评分，不走置换表
+            best = INT64_MIN;
+            for (int j = 0; j < pieces[piece].count; j++) {
+                int count = score_placements(t, ctx->weights, piece, j, record->scores + record->count);
+                for (int i = 0; i < count; i++) {
+                    if (record->scores[record->count + i] > best) {
+                        best = record->scores[record->count + i];
+                    }
+                }
+                record->count += count;
             }
-            if (insert_pos < beam_width) {
-                beam[insert_pos].t = temp_tetris;
-                beam[insert_pos].rotation = i;
-                beam[insert_pos].col = col;
-                beam[insert_pos].score = curr_score;
-                if (beam_size < beam_width) beam_size++;
+        } else {
+            best = best_placement_score(t, ctx->weights, tt_enabled() ? hash_tetris(t) ^ ctx->weights_tag : 0,
+                                        piece, ctx->policy->reachable);
+        }
+        STATS_PLY_TIME(ply, start);
+        return best;
+    }
+
+    if (search_timed_out(ctx)) {
+        *exact = 0;
+        return INT64_MIN;
+    }
+
+    uint64_t key = 0;
+    int64_t best = INT64_MIN;
+    if (tt_enabled()) {
+        key = tt_key(hash_tetris(t) ^ ctx->policy_tag, piece, (ply << PLY_TAG_SHIFT) | ctx->depth);
+        if (tt_probe(key, &best)) {
+            return best;
+        }
+    }
+
+    struct BeamNode beam[MAX_PLACEMENTS];
+    STATS_ADD(nodes[ply], 1);
+    STATS_CLOCK(start);
+    int beam_size = ctx->policy->reachable
+                  ? generate_beam_reachable(t, ctx->weights, piece, beam, search_width(ctx, ply))
+                  : generate_beam(t, ctx->weights, piece, beam, search_width(ctx, ply), record);
+    STATS_PLY_TIME(ply, start);
+    for (int i = 0; i < beam_size; i++) {
+        if (beam[i].score == INT64_MIN) {
+            continue;  // 非法落点，直接剪掉
+        }
+        // 在同一块棋盘上落子、搜索子树、再撤销，不复制整个局面
+        struct undo_record undo;
+        struct tetris scratch;
+        struct tetris *child = place_beam_node(t, piece, &beam[i], &undo, &scratch);
+        int64_t bonus = (int64_t) child->landing_row * ctx->weights->landing_height;
+        int e;
+        int64_t sub = search_node(ctx, child, ply + 1, child_alpha(best > alpha ? best : alpha, bonus), &e);
+        if (child == t) {
+            undo_piece(t, &undo);
+        }
+        if (sub == INT64_MIN) {
+            continue;  // 之后必死的分支
+        }
+        int64_t total = bonus + sub;
+        if (total > best) {
+            best = total;
+        }
+    }
+
+    *exact = (alpha == INT64_MIN || best > alpha);
+    if (ctx->deadline_ns && search_timed_out(ctx)) {
+        *exact = 0;
+    }
+    if (*exact && key) {
+        tt_store(key, best);
+    }
+    return best;
+}
+
+// 未知方块的节点：按策略合并 piece_mask 中每种方块的结果
+static int64_t search_unknown(const struct search_ctx *ctx, struct tetris *t, int ply,
+                              int64_t alpha, int *exact) {
+    const struct search_policy *policy = ctx->policy;
+    *exact = 1;
+
+    uint64_t hash = 0;
+    uint64_t key = 0;
+    int64_t value;
+    if (tt_enabled()) {
+        hash = hash_tetris(t);
+        key = tt_key(hash ^ ctx->policy_tag, UNKNOWN_PIECE_TAG, (ply << PLY_TAG_SHIFT) | ctx->depth);
+        if (tt_probe(key, &value)) {
+            return value;
+        }
+    }
+
+    int count = 0;
+    int64_t sum = 0;
+    value = INT64_MAX;
+    for (int p = 0; p < PIECE_TYPES; p++) {
+        if (!(policy->piece_mask & (1 << p))) {
+            continue;
+        }
+        int e;
+        // 平均值无法用 alpha 截断，只有 min-max 才把 alpha 往下传
+        int64_t v = search_known(ctx, t, p, ply, policy->mode == SEARCH_MINMAX ? alpha : INT64_MIN, &e);
+        if (v == INT64_MIN) {
+            value = INT64_MIN;  // 有一种方块放不下，这个局面必死
+            break;
+        }
+        if (policy->mode == SEARCH_MINMAX) {
+            if (v < value) {
+                value = v;
             }
+            if (alpha != INT64_MIN && value <= alpha) {
+                *exact = 0;     // 已经不可能优于兄弟节点，剩下的方块不必再算
+                return value;
+            }
+        } else {
+            sum += v;
         }
+        count++;
     }
-    return beam_size;
+    if (value != INT64_MIN && policy->mode == SEARCH_EXPECTIMAX) {
+        value = count ? sum / count : INT64_MIN;
+    }
+    if (value == INT64_MAX) {
+        value = INT64_MIN;      // piece_mask 为空
+    }
+
+    if (ctx->deadline_ns && search_timed_out(ctx)) {
+        *exact = 0;
+    }
+    if (*exact && key) {
+        tt_store(key, value);
+    }
+    return value;
 }
 
-void select_best_move_with_next_beam(
+static int64_t search_node(const struct search_ctx *ctx, struct tetris *t, int ply, int64_t alpha, int *exact) {
+    int piece = piece_at_ply(ctx, ply);
+    if (piece >= 0) {
+        return search_known(ctx, t, piece, ply, alpha, exact);
+    }
+    return search_unknown(ctx, t, ply, alpha, exact);
+}
+
+static int64_t search_root_child(const struct search_ctx *ctx, struct tetris *t, const struct BeamNode *node,
+                                 int64_t alpha, struct search_expansion *expansion) {
+    if (expansion) {
+        expansion->count = 0;
+    }
+    if (node->score == INT64_MIN) {
+        return INT64_MIN;
+    }
+    struct undo_record undo;
+    struct tetris scratch;
+    struct tetris *child = place_beam_node(t, ctx->curr_piece, node, &undo, &scratch);
+    int64_t bonus = (int64_t) child->landing_row * ctx->weights->landing_height;
+    int exact;
+    struct search_ctx child_ctx = *ctx;
+    child_ctx.expansion = expansion;
+    int64_t sub = search_node(&child_ctx, child, 1, child_alpha(alpha, bonus), &exact);
+    if (child == t) {
+        undo_piece(t, &undo);
+    }
+    if (sub == INT64_MIN) {
+        return INT64_MIN;
+    }
+    return bonus + sub;
+}
+
+static void search_root_worker(void *arg, int index) {
+    struct search_root_task *task = arg;
+    struct tetris work = *task->root;     // 每个任务各用一份棋盘
+    task->scores[index] = search_root_child(task->ctx, &work, &task->beam[index], INT64_MIN,
+                                           task->expansions ? &task->expansions[index] : NULL);
+}
+
+static uint64_t search_policy_tag(const struct search_policy *policy) {
+    uint64_t tag = ((uint64_t) policy->mode << 8) | (uint64_t) policy->piece_mask;
+    for (int i = 0; i < MAX_SEARCH_DEPTH; i++) {
+        tag = tag * 0x100000001B3ULL + (uint64_t) policy->beam_width[i];
+    }
+    tag = tag * 0x100000001B3ULL + (uint64_t) policy->ply_beam_width;
+    tag = tag * 0x100000001B3ULL + (uint64_t) policy->reachable;
+    return tag * 0x9E3779B97F4A7C15ULL;
+}
+
+// 默认权重返回 0，使默认权重下的置换表键保持不变
+static uint64_t eval_weights_tag(const struct eval_weights *w) {
+    if (w == NULL || w == &EVAL_WEIGHTS_DEFAULT) {
+        return 0;
+    }
+    const int64_t v[EVAL_WEIGHT_COUNT] = {
+        w->landing_height, w->rows_eliminated, w->row_transitions, w->col_transitions, w->holes, w->wells
+    };
+    uint64_t tag = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+        tag = (tag ^ (uint64_t) v[i]) * 0x100000001B3ULL;
+    }
+    return tag * 0xD6E8FEB86659FD93ULL;
+}
+
+static void search_ctx_init(struct search_ctx *ctx, int curr_piece_index, int next_piece_index, int depth,
+                            const struct search_policy *policy) {
+    ctx->policy = policy;
+    ctx->depth = depth < 1 ? 1 : (depth > MAX_SEARCH_DEPTH ? MAX_SEARCH_DEPTH : depth);
+    ctx->curr_piece = curr_piece_index;
+    ctx->next_piece = next_piece_index;
+    ctx->weights = policy->weights ? policy->weights : &EVAL_WEIGHTS_DEFAULT;
+    ctx->weights_tag = eval_weights_tag(policy->weights);
+    ctx->policy_tag = search_policy_tag(policy) ^ ctx->weights_tag;
+    ctx->deadline_ns = 0;
+    ctx->aborted = NULL;
+    ctx->expansion = NULL;
+}
+
+struct ply_beam_task {
+    const struct search_ctx *ctx;
+    struct beam_arena *arena;
+    int layer;
+    int ply;
+};
+
+static void ply_beam_worker(void *arg, int index) {
+    struct ply_beam_task *task = arg;
+    struct beam_arena *arena = task->arena;
+    struct tetris child = arena->boards[task->layer][index];
+    int exact;
+    arena->leaf_score[index] = search_node(task->ctx, &child, task->ply, INT64_MIN, &exact);
+}
+
+// 整层 beam 搜索：已知方块的各层不再逐节点保留前几个落点，而是把一层全部局面的全部落点
+// 按“累计落点高度分 + 评估分”放在一起比较，整层只保留前 ply_beam_width 个局面。
+// 到了最后一层或方块未知的一层，再对留下的局面调用 search_node() 继续按逐节点 beam 搜索。
+// 只有整层保留的局面数超过每个节点的落点数时这种方式才有意义，所以宽度通常取 64 到 512。
+// arena 由调用者用 beam_arena_get(ply_beam_width(policy)) 取得
+static inline int ply_beam_width(const struct search_policy *policy) {
+    return policy->ply_beam_width > PLY_BEAM_MAX_WIDTH ? PLY_BEAM_MAX_WIDTH : policy->ply_beam_width;
+}
+
+static int64_t search_root_ply_beam(const struct search_ctx *ctx, struct beam_arena *arena,
+                                    const struct tetris *t, struct placement *best) {
+    const struct search_policy *policy = ctx->policy;
+    int width = ply_beam_width(policy);
+
+    int layer = 0;
+    int size = 1;
+    arena->boards[0][0] = *t;
+    arena->bonus[0][0] = 0;
+    arena->root_rotation[0][0] = -1;
+    arena->root_col[0][0] = -1;
+
+    struct board_batch batch;
+    int64_t scores[BOARD_BATCH_MAX];
+    int ply = 0;
+    while (1) {
+        // 1. 展开本层全部局面的全部落点
+        int piece = piece_at_ply(ctx, ply);
+        int n = 0;
+        STATS_ADD(nodes[ply], size);
+        STATS_CLOCK(start);
+        for (int b = 0; b < size; b++) {
+            int count = place_piece_batch(&arena->boards[layer][b], piece, &batch);
+            evaluate_batch(&batch, ctx->weights, scores);
+            for (int k = 0; k < count; k++, n++) {
+                arena->candidate_score[n] = scores[k] == INT64_MIN ? INT64_MIN : arena->bonus[layer][b] + scores[k];
+                arena->candidate_parent[n] = b;
+                arena->candidate_rotation[n] = batch.move_rotation[k];
+                arena->candidate_col[n] = batch.move_col[k];
+            }
+        }
+
+        // 2. 最后一层直接取评分最高的落点；所有落点都非法时也给出一个落点
+        int last = (ply == ctx->depth - 1);
+        int keep = select_top_scores(arena->candidate_score, n, last ? 1 : width, arena->order);
+        STATS_ADD(beam_cutoffs, n - keep);
+        if (keep == 0) {
+            return INT64_MIN;
+        }
+        int top = arena->order[0];
+        int top_parent = arena->candidate_parent[top];
+        if (ply == 0) {
+            best->rotation = arena->candidate_rotation[top];
+            best->col = arena->candidate_col[top];
+        } else {
+            best->rotation = arena->root_rotation[layer][top_parent];
+            best->col = arena->root_col[layer][top_parent];
+        }
+        if (last || arena->candidate_score[top] == INT64_MIN) {
+            STATS_PLY_TIME(ply, start);
+            return arena->candidate_score[top];
+        }
+
+        // 3. 只为选出的候选落子，生成下一层
+        int next = layer ^ 1;
+        int next_size = 0;
+        for (int i = 0; i < keep; i++) {
+            int c = arena->order[i];
+            if (arena->candidate_score[c] == INT64_MIN) {
+                break;      // 非法落点排在最后
+            }
+            int parent = arena->candidate_parent[c];
+            struct tetris *child = &arena->boards[next][next_size];
+            *child = arena->boards[layer][parent];
+            place_piece(child, &pieces[piece], arena->candidate_rotation[c], arena->candidate_col[c]);
+            arena->bonus[next][next_size] = arena->bonus[layer][parent]
+                                          + (int64_t) child->landing_row * ctx->weights->landing_height;
+            arena->root_rotation[next][next_size] = ply == 0 ? arena->candidate_rotation[c]
+                                                             : arena->root_rotation[layer][parent];
+            arena->root_col[next][next_size] = ply == 0 ? arena->candidate_col[c] : arena->root_col[layer][parent];
+            next_size++;
+        }
+        STATS_PLY_TIME(ply, start);
+        layer = next;
+        size = next_size;
+        ply++;
+
+        if (piece_at_ply(ctx, ply) >= 0 && ply < ctx->depth - 1) {
+            continue;
+        }
+        break;
+    }
+
+    // 4. 下一层方块未知或已是最后一层：对留下的局面逐个搜索剩余各层
+    //    有线程池时并行计算，没有时带着 alpha 串行剪枝，两者结果逐位一致
+    struct ply_beam_task task = { ctx, arena, layer, ply };
+    if (policy->pool != NULL) {
+        thread_pool_run(policy->pool, size, ply_beam_worker, &task);
+    }
+    int64_t best_total_score = INT64_MIN;
+    for (int i = 0; i < size; i++) {
+        int64_t bonus = arena->bonus[layer][i];
+        int64_t sub;
+        if (policy->pool != NULL) {
+            sub = arena->leaf_score[i];
+        } else {
+            struct tetris child = arena->boards[layer][i];
+            int exact;
+            sub = search_node(ctx, &child, ply, child_alpha(best_total_score, bonus), &exact);
+        }
+        if (sub == INT64_MIN) {
+            continue;
+        }
+        if (bonus + sub > best_total_score) {
+            best_total_score = bonus + sub;
+            best->rotation = arena->root_rotation[layer][i];
+            best->col = arena->root_col[layer][i];
+        }
+    }
+    return best_total_score;
+}
+
+// carry_out 非空时写入选中候选下第 1 层的记录（没有时 count 为 0），供下一步的根节点沿用
+static int64_t search_root(const struct search_ctx *ctx, const struct tetris *t, struct placement *best,
+                           struct search_expansion *carry_out) {
+    const struct search_policy *policy = ctx->policy;
+    if (carry_out) {
+        carry_out->count = 0;
+    }
+    struct beam_arena *arena = policy->ply_beam_width > 0 ? beam_arena_get(ply_beam_width(policy)) : NULL;
+    if (arena != NULL) {
+        // 整层 beam 只展开硬降落点；缓冲区分配失败时退回下面的逐节点搜索
+        int64_t score = search_root_ply_beam(ctx, arena, t, best);
+        best->row = get_landing_row(t, &pieces[ctx->curr_piece].rotations[best->rotation], best->col);
+        return score;
+    }
+
+    // 1. 枚举当前方块的落子方式，保留前 beam_width[0] 个；只搜一层时直接取评分最高者
+    struct BeamNode beam[MAX_PLACEMENTS];
+    STATS_ADD(nodes[0], 1);
+    STATS_CLOCK(start);
+    int width = ctx->depth == 1 ? 1 : search_width(ctx, 0);
+    const struct search_expansion *carry = &carried_expansion;
+    int beam_size;
+    if (policy->reachable) {
+        beam_size = generate_beam_reachable(t, ctx->weights, ctx->curr_piece, beam, width);
+    } else if (carry->count && carry->piece == ctx->curr_piece && carry->weights_tag == ctx->weights_tag &&
+               carry->hash == hash_tetris(t)) {
+        beam_size = generate_beam_carried(t, carry, beam, width);
+    } else {
+        beam_size = generate_beam(t, ctx->weights, ctx->curr_piece, beam, width, NULL);
+    }
+    STATS_PLY_TIME(0, start);
+    if (beam_size == 0) {
+        return INT64_MIN;
+    }
+    // 所有分支都必死时，至少给出评分最高的落点
+    best->rotation = beam[0].rotation;
+    best->col = beam[0].col;
+    best->row = beam[0].row;
+    if (ctx->depth == 1) {
+        return beam[0].score;
+    }
+
+    // 2. 逐个展开根节点候选；有线程池时并行计算，没有时带着 alpha 串行剪枝
+    int64_t best_total_score = INT64_MIN;
+    struct search_expansion expansions[MAX_PLACEMENTS];
+    struct search_root_task task;
+    if (policy->pool != NULL) {
+        task.ctx = ctx;
+        task.root = t;
+        task.beam = beam;
+        task.expansions = carry_out ? expansions : NULL;
+        thread_pool_run(policy->pool, beam_size, search_root_worker, &task);
+    }
+    int chosen = 0;
+    struct tetris work = *t;
+    for (int i = 0; i < beam_size; i++) {
+        int64_t total_score = policy->pool != NULL ? task.scores[i]
+                                                   : search_root_child(ctx, &work, &beam[i], best_total_score,
+                                                                       carry_out ? &expansions[i] : NULL);
+        // 按 beam 顺序严格大于才替换，串行与并行的结果逐位一致
+        if (total_score > best_total_score) {
+            best_total_score = total_score;
+            best->rotation = beam[i].rotation;
+            best->col = beam[i].col;
+            best->row = beam[i].row;
+            chosen = i;
+        }
+    }
+    if (carry_out && expansions[chosen].count) {
+        *carry_out = expansions[chosen];
+    }
+    return best_total_score;
+}
+
+int64_t select_best_placement_search(
     struct tetris *t,
     int curr_piece_index,
     int next_piece_index,
+    int depth,
+    const struct search_policy *policy,
+    struct placement *best
+) {
+    struct search_ctx ctx;
+    search_ctx_init(&ctx, curr_piece_index, next_piece_index, depth, policy);
+    struct search_expansion carry;
+    int64_t score = search_root(&ctx, t, best, &carry);
+    carried_expansion = carry;
+    return score;
+}
+
+int64_t select_best_move_search(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int depth,
+    const struct search_policy *policy,
     int *best_rotation,
     int *best_col
 ) {
-    struct BeamNode beam[BEAM_WIDTH];
-    int beam_size = 0;
+    struct placement best = { *best_rotation, *best_col, 0 };
+    int64_t score = select_best_placement_search(t, curr_piece_index, next_piece_index, depth, policy, &best);
+    *best_rotation = best.rotation;
+    *best_col = best.col;
+    return score;
+}
 
-    // 1. 枚举所有当前方块的落子方式，保留前BEAM_WIDTH个
-    beam_size = generate_beam(t, curr_piece_index, beam, BEAM_WIDTH);
+int64_t select_best_placement_anytime(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int max_depth,
+    const struct search_policy *policy,
+    int64_t budget_us,
+    struct placement *best,
+    int *reached_depth
+) {
+    int64_t start = monotonic_ns();
+    int64_t deadline = start + budget_us * 1000;
+    atomic_int aborted;
+    atomic_init(&aborted, 0);
+    if (max_depth > MAX_SEARCH_DEPTH) {
+        max_depth = MAX_SEARCH_DEPTH;
+    }
 
-    // 2. 对每个beam节点，枚举下一个方块所有落子，取最优
-    int64_t best_total_score = INT64_MIN;
-    for (int i = 0; i < beam_size; i++) {
-        int64_t next_best = INT64_MIN;
-        for (int nj = 0; nj < pieces[next_piece_index].count; nj++) {
-            const struct rotation *nrot = &pieces[next_piece_index].rotations[nj];
-            for (int ncol = COL_SHIFT; ncol <= COL_SHIFT + COL - nrot->width; ncol++) {
-                struct tetris next_tetris = beam[i].t;
-                place_piece(&next_tetris, &pieces[next_piece_index], nj, ncol);
-                int64_t score = evaluate_board(&next_tetris);
-                if (score > next_best) {
-                    next_best = score;
-                }
-            }
-        }
-        int64_t bonus = (int64_t) beam[i].t.landing_row * LANDING_HEIGHT;
-        int64_t total_score = bonus + next_best;
-        if (total_score > best_total_score) {
-            best_total_score = total_score;
-            *best_rotation = beam[i].rotation;
-            *best_col = beam[i].col;
-        }
-    }
-}
-
-// 辅助函数：采样第三步的 S 和 Z 型方块
-static int64_t sample_third_step(struct tetris *t, int *third_pieces, int piece_count) {
-    int64_t worst_best_score = INT64_MAX;  // 记录最差情况的最佳分数
-    
-    // 对每种方块（S和Z）
-    for (int tp = 0; tp < piece_count; tp++) {
-        int64_t best_score = INT64_MIN;  // 当前方块的最佳分数
-        int third_piece_index = third_pieces[tp];
-        
-        // 枚举该方块的所有可能落子位置
-        for (int tj = 0; tj < pieces[third_piece_index].count; tj++) {
-            const struct rotation *trot = &pieces[third_piece_index].rotations[tj];
-            for (int tcol = COL_SHIFT; tcol <= COL_SHIFT + COL - trot->width; tcol++) {
-                struct tetris third_tetris = *t;
-                place_piece(&third_tetris, &pieces[third_piece_index], tj, tcol);
-                int64_t score = evaluate_board(&third_tetris);
-                
-                // 更新当前方块的最佳分数
-                if (score > best_score) {
-                    best_score = score;
-                }
-            }
+    // 第一层不设截止时间，保证无论预算多小都有一个落点
+    struct search_ctx ctx;
+    search_ctx_init(&ctx, curr_piece_index, next_piece_index, 1, policy);
+    struct search_expansion carry, next;
+    int64_t best_score = search_root(&ctx, t, best, &carry);
+    *reached_depth = 1;
+
+    int64_t last_start = start;
+    for (int depth = 2; depth <= max_depth; depth++) {
+        int64_t now = monotonic_ns();
+        // 更深一层的耗时不会少于上一层，剩余时间不够时不再开始
+        if (now >= deadline || deadline - now < now - last_start) {
+            break;
         }
-        
-        // 更新最差情况的最佳分数
-        if (best_score < worst_best_score) {
-            worst_best_score = best_score;
+        last_start = now;
+
+        struct placement placement;
+        search_ctx_init(&ctx, curr_piece_index, next_piece_index, depth, policy);
+        ctx.deadline_ns = deadline;
+        ctx.aborted = &aborted;
+        int64_t score = search_root(&ctx, t, &placement, &next);
+        if (atomic_load(&aborted)) {
+            break;       // 本层没有搜完，沿用上一层的结果
         }
+        best_score = score;
+        *best = placement;
+        *reached_depth = depth;
+        carry = next;
     }
-    
-    return worst_best_score;
+    // 各层的根节点都可以沿用上一步的记录，搜完之后才换成这一步的
+    carried_expansion = carry;
+    return best_score;
 }
 
-void select_best_move_with_next_beam_sampleSZ(
+int64_t select_best_move_anytime(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int max_depth,
+    const struct search_policy *policy,
+    int64_t budget_us,
+    int *best_rotation,
+    int *best_col,
+    int *reached_depth
+) {
+    struct placement best = { *best_rotation, *best_col, 0 };
+    int64_t score = select_best_placement_anytime(t, curr_piece_index, next_piece_index, max_depth, policy,
+                                                  budget_us, &best, reached_depth);
+    *best_rotation = best.rotation;
+    *best_col = best.col;
+    return score;
+}
+
+// 低局面：当前方块保留前 BEAM_WIDTH 个落点，再取下一个方块的最佳落点
+const struct search_policy SEARCH_POLICY_NEXT_BEAM = {
+    SEARCH_MINMAX, PIECE_MASK_ALL, { BEAM_WIDTH, 0 }, 0, NULL, NULL
+};
+
+void select_best_move_with_next_beam(
     struct tetris *t,
     int curr_piece_index,
     int next_piece_index,
     int *best_rotation,
     int *best_col
 ) {
-    struct BeamNode beam[BEAM_WIDTH];
-    int beam_size = 0;
+    select_best_move_search(t, curr_piece_index, next_piece_index, 2, &SEARCH_POLICY_NEXT_BEAM,
+                            best_rotation, best_col);
+}
 
-    // 1. 枚举所有当前方块的落子方式，保留前 BEAM_WIDTH 个
-    beam_size = generate_beam(t, curr_piece_index, beam, BEAM_WIDTH);
+// 高局面：前两步各保留 BEAM_WIDTH 个落点，第三步只考虑最难处理的 S 和 Z 中较差的一个
+// 限时搜索加深到第四步以后，后面各层同样保留 BEAM_WIDTH 个落点
+const struct search_policy SEARCH_POLICY_SAMPLE_SZ = {
+    SEARCH_MINMAX, PIECE_MASK_SZ, { BEAM_WIDTH, BEAM_WIDTH, BEAM_WIDTH, BEAM_WIDTH, BEAM_WIDTH, BEAM_WIDTH }, 0, NULL, NULL
+};
 
-    // 2. 对每个 beam 节点，枚举下一个方块的所有落子方式，保留前 BEAM_WIDTH 个
-    struct BeamNode next_beam[BEAM_WIDTH];
-    int next_beam_size = 0;
-    int64_t best_total_score = INT64_MIN;
+// 对全部 7 种方块取平均的 expectimax，默认每层的 beam 逐渐收窄
+const struct search_policy SEARCH_POLICY_EXPECTIMAX = {
+    SEARCH_EXPECTIMAX, PIECE_MASK_ALL, { BEAM_WIDTH, BEAM_WIDTH, 2, 1, 1, 1 }, 0, NULL, NULL
+};
 
-    for (int i = 0; i < beam_size; i++) {
-        next_beam_size = generate_beam(&beam[i].t, next_piece_index, next_beam, BEAM_WIDTH);
-
-        // 3. 第三步只采样 S 和 Z 型 piece（piece_index = 5 和 6）
-        int third_pieces[2] = {5, 6};
-        for (int j = 0; j < next_beam_size; j++) {
-            int64_t third = sample_third_step(&next_beam[j].t, third_pieces, 2);
-            int64_t bonus = (int64_t) (beam[i].t.landing_row + next_beam[j].t.landing_row) * LANDING_HEIGHT;
-            int64_t total_score = bonus + third;
-
-            // 更新最佳分数和第一个方块的落子位置
-            if (total_score > best_total_score) {
-                best_total_score = total_score;
-                *best_rotation = beam[i].rotation; // 返回第一个方块的 rotation
-                *best_col = beam[i].col;           // 返回第一个方块的 col
-            }
-        }
-    }
-}
\ No newline at end of file
+void select_best_move_with_next_beam_sampleSZ_pool(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    struct thread_pool *pool,
+    int *best_rotation,
+    int *best_col
+) {
+    struct search_policy policy = SEARCH_POLICY_SAMPLE_SZ;
+    policy.pool = pool;
+    select_best_move_search(t, curr_piece_index, next_piece_index, 3, &policy, best_rotation, best_col);
+}
+
+void select_best_move_with_next_beam_sampleSZ(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int *best_rotation,
+    int *best_col
+) {
+    select_best_move_search(t, curr_piece_index, next_piece_index, 3, &SEARCH_POLICY_SAMPLE_SZ,
+                            best_rotation, best_col);
+}
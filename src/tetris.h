@@ -1,6 +1,7 @@
 #ifndef TETRIS_H
 #define TETRIS_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define ROW 20
@@ -12,6 +13,11 @@
 #define FULL_CHAR       'X'
 
 #define BEAM_WIDTH 4
+#define MAX_PLACEMENTS   (MAX_ROTATIONS * COL)   // 一个方块最多的落点数
+#define MAX_SEARCH_DEPTH 6
+#define PLY_BEAM_MAX_WIDTH 2048                  // 整层 beam 搜索每层最多保留的局面数
+#define PIECE_MASK_ALL   ((1 << PIECE_TYPES) - 1)
+#define PIECE_MASK_SZ    ((1 << 5) | (1 << 6))   // 只考虑 S、Z（方块编号 5、6）
 
 // Pierre Dellacherie 算法评分权重
 #define WEIGHT_LANDING_HEIGHT     (-4.500158825082766)
@@ -21,6 +27,22 @@
 #define WEIGHT_HOLES              (-7.899265427351652)
 #define WEIGHT_WELL_SUMS          (-3.3855972247263626)
 
+// 运行时使用的评估权重，定点表示：浮点权重乘以 EVAL_WEIGHT_SCALE 后取整
+// 默认值 EVAL_WEIGHTS_DEFAULT 由上面的 WEIGHT_* 得到，也可以从权重文件读入（见 weights.h）
+#define EVAL_WEIGHT_COUNT 6
+#define EVAL_WEIGHT_SCALE 10000
+
+struct eval_weights {
+    int64_t landing_height;
+    int64_t rows_eliminated;
+    int64_t row_transitions;
+    int64_t col_transitions;
+    int64_t holes;
+    int64_t wells;
+};
+
+extern const struct eval_weights EVAL_WEIGHTS_DEFAULT;
+
 #define EMPTY_ROW   0B1111100000000001
 #define FULL_ROW    0B1111111111111111
 #define COL_SHIFT   1
@@ -46,32 +68,108 @@ struct tetris {
     int8_t  reserved;
 };
 
+// 旋转元数据在编译时生成（见 tools/gen_pieces.c），紧凑排列，一个方块的全部旋转只占几条缓存行
 struct rotation {
-    int width;
-    int height;
     uint16_t shape[MAX_BRICK_WIDTH];
-    int hstart[MAX_BRICK_WIDTH];
-    int hend[MAX_BRICK_WIDTH];
-    int hspan[MAX_BRICK_WIDTH];
-    int vstart[MAX_BRICK_WIDTH];
-    int vend[MAX_BRICK_WIDTH];
-    int vspan[MAX_BRICK_WIDTH];
+    int8_t width;
+    int8_t height;
+    int8_t hstart[MAX_BRICK_WIDTH];     // 每行第一个方格所在列
+    int8_t hend[MAX_BRICK_WIDTH];
+    int8_t hspan[MAX_BRICK_WIDTH];
+    int8_t vstart[MAX_BRICK_WIDTH];     // 每列最低方格所在行
+    int8_t vend[MAX_BRICK_WIDTH];
+    int8_t vspan[MAX_BRICK_WIDTH];
 };
 
 struct piece {
-    int count;
+    int8_t count;
     struct rotation rotations[MAX_ROTATIONS];
 };
 
+// 一个落点：旋转、列和方块最低一行所在的行。硬降的落点行总是 get_landing_row()
+struct placement {
+    int8_t rotation;
+    int8_t col;
+    int8_t row;
+};
+
 struct BeamNode {
-    struct tetris t;
     int rotation;
     int col;
+    int row;            // 落点行，reachable 策略下可能低于硬降的落点
+    int index;          // -1 表示硬降落点，否则为 generate_tucks() 给出的第 index 个落点
     int64_t score;
 };
 
+// place_piece_undoable() 的撤销记录，只保存被改动的行、列高度和特征计数
+struct undo_record {
+    uint16_t rows[ROW];
+    int8_t  col_height[COL + 2*COL_SHIFT];
+    int8_t  scalars[10];       // max_height 到 reserved 之间的全部字段
+    int8_t  first_row;
+    int8_t  row_count;
+    int8_t  first_col;
+    int8_t  col_count;
+};
+
+// 结构数组（SoA）形式的一批棋盘：行、列高度和各项特征计数分别连续存放，
+// 第 i 块棋盘的数据在各数组的第 i 项，逐棋盘的循环可以被编译器向量化
+#define BOARD_BATCH_MAX MAX_PLACEMENTS
+
+struct board_batch {
+    int count;
+    int8_t move_rotation[BOARD_BATCH_MAX];   // place_piece_batch() 记录的落子方式
+    int8_t move_col[BOARD_BATCH_MAX];
+    int8_t landing_row[BOARD_BATCH_MAX];
+    int8_t rows_eliminated[BOARD_BATCH_MAX];
+    int8_t max_height[BOARD_BATCH_MAX];
+    int8_t holes[BOARD_BATCH_MAX];
+    int8_t row_transitions[BOARD_BATCH_MAX];
+    int8_t col_transitions[BOARD_BATCH_MAX];
+    int8_t wells[BOARD_BATCH_MAX];
+    int8_t piece[BOARD_BATCH_MAX];
+    int8_t rotation[BOARD_BATCH_MAX];
+    int8_t col_height[COL + 2 * COL_SHIFT][BOARD_BATCH_MAX];
+    uint16_t rows[ROW][BOARD_BATCH_MAX];
+};
+
+// 未知方块层的合并方式
+enum search_mode {
+    SEARCH_EXPECTIMAX,   // 对 piece_mask 中的方块取平均
+    SEARCH_MINMAX,       // 对 piece_mask 中的方块取最差
+};
+
+struct thread_pool;
+
+// 搜索策略
+struct search_policy {
+    enum search_mode mode;
+    int piece_mask;                      // 未知方块层考虑的方块集合，第 i 位表示 pieces[i]
+    int beam_width[MAX_SEARCH_DEPTH];    // 第 i 层保留的候选数，0 表示不限；最后一层总是全部展开
+    int ply_beam_width;                  // 大于 0 时已知方块的各层改为整层 beam：整层只保留评分最高的这么多个局面
+    struct thread_pool *pool;            // 非空时根节点候选交给线程池并行搜索
+    const struct eval_weights *weights;  // 评估权重，NULL 表示 EVAL_WEIGHTS_DEFAULT
+    int reachable;                       // 非 0 时逐节点搜索还考虑硬降到不了、经平移旋转可到达的落点（见 movegen.h）；
+                                         // 整层 beam 搜索忽略此项
+};
+
+extern const struct search_policy SEARCH_POLICY_NEXT_BEAM;
+extern const struct search_policy SEARCH_POLICY_SAMPLE_SZ;
+extern const struct search_policy SEARCH_POLICY_EXPECTIMAX;
+
 void init_tetris(struct tetris *t);
+// 方块的字母 I T O J L S Z，下标越界时返回 -1
+int  get_piece_name(int piece);
+// get_piece_name() 的反查：字母对应的方块下标，不是方块字母时返回 -1
+int  get_piece_index(int name);
 void select_best_move(struct tetris *t, int piece_index, int *best_rotation, int *best_col);
+void select_best_move_with_next(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int *best_rotation,
+    int *best_col
+);
 void select_best_move_with_next_beam(
     struct tetris *t,
     int curr_piece_index,
@@ -87,8 +185,125 @@ void select_best_move_with_next_beam_sampleSZ(
     int *best_col
 );
 
+// 与上面相同，但把根节点各候选的后续搜索分给线程池并行计算，结果与串行版本逐位一致
+// pool 为 NULL 时退化为串行搜索
+void select_best_move_with_next_beam_sampleSZ_pool(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    struct thread_pool *pool,
+    int *best_rotation,
+    int *best_col
+);
+
+// 通用多步搜索：第 0 步为 curr，第 1 步为 next（为负数时视为未知），其余各步方块未知，
+// 共搜索 depth 步（1 到 MAX_SEARCH_DEPTH）。返回最佳总分，所有分支都必死时返回 INT64_MIN
+int64_t select_best_move_search(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int depth,
+    const struct search_policy *policy,
+    int *best_rotation,
+    int *best_col
+);
+
+// 与 select_best_move_search() 相同，但给出完整的落点；policy->reachable 非 0 时 best->row 可能低于硬降落点，
+// 须用 place_piece_at() 落子
+int64_t select_best_placement_search(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int depth,
+    const struct search_policy *policy,
+    struct placement *best
+);
+
+// 丢弃本线程上一步搜索留下的第 1 层记录（见 tetris.c 中的 search_expansion）。
+// 记录按局面哈希和权重取值核对，不清除也不会用错；只在需要从头搜索（如测试对照）时调用
+void forget_search_expansion(void);
+
+// 限时迭代加深搜索：从 1 步开始逐层加深到 max_depth，在 budget_us 微秒内
+// 返回已完整搜索的最深一层的结果，*reached_depth 为该层深度。第 1 层总会完成。
+int64_t select_best_move_anytime(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int max_depth,
+    const struct search_policy *policy,
+    int64_t budget_us,
+    int *best_rotation,
+    int *best_col,
+    int *reached_depth
+);
+int64_t select_best_placement_anytime(
+    struct tetris *t,
+    int curr_piece_index,
+    int next_piece_index,
+    int max_depth,
+    const struct search_policy *policy,
+    int64_t budget_us,
+    struct placement *best,
+    int *reached_depth
+);
+
 void  place_piece(struct tetris *t, const struct piece *p, int rotation, int col);
+// 把方块放在 row 行（调用者保证该位置不与棋盘相交且下方有支撑，例如来自 generate_placements()）。
+// row 就是硬降落点时等同于 place_piece()，否则消行后用 compute_board_features() 重算各项特征
+void  place_piece_at(struct tetris *t, const struct piece *p, int rotation, int col, int row);
+// 按权重 w 评估落子后的局面，w 为 NULL 时使用 EVAL_WEIGHTS_DEFAULT
+int64_t evaluate_board(const struct tetris *t, const struct eval_weights *w);
+// 不用增量计数、从棋盘位图重新计算特征的评估，结果与 evaluate_board() 相同（增量计数没有漂移时）
+// 编译时 EVAL=full 让 evaluate_board() 使用它，EVAL=check 则每次评估都核对两者
+int64_t evaluate_board_full(const struct tetris *t, const struct eval_weights *w);
+
+// 与 place_piece() 相同，同时把撤销所需的信息记录到 undo 中；
+// 之后调用 undo_piece() 即可原地恢复落子前的局面（包括落点非法的情况）
+void place_piece_undoable(struct tetris *t, const struct piece *p, int rotation, int col, struct undo_record *undo);
+void undo_piece(struct tetris *t, const struct undo_record *undo);
+
+// 计算 pieces[piece_index] 以 rotation 在 col = COL_SHIFT.. 各列落下后的评分，返回列数
+// 结果与逐列 place_piece() + evaluate_board() 完全一致，CPU 支持时使用 AVX2 内核
+// w 为 NULL 时使用默认权重
+int  score_placements(const struct tetris *t, const struct eval_weights *w, int piece_index, int rotation,
+                      int64_t *scores);
+// 以下批量接口只供整层 beam 搜索（search_policy.ply_beam_width 大于 0）使用；逐节点搜索用 score_placements()
+// 与 place_piece_undoable()/undo_piece() 展开子节点，不经过 board_batch
+// 把 t 上 pieces[piece_index] 的全部落点（按旋转、列的顺序，与 score_placements() 相同）
+// 一次展开到 batch 中，返回落点数；非法落点与 place_piece() 一样只把 landing_row 置为 -1
+int  place_piece_batch(const struct tetris *t, int piece_index, struct board_batch *batch);
+// 评估 batch 中的全部棋盘，结果与逐个 evaluate_board() 相同；w 为 NULL 时使用默认权重
+void evaluate_batch(const struct board_batch *batch, const struct eval_weights *w, int64_t *out);
+// 评估 n 块普通布局的棋盘，内部按 BOARD_BATCH_MAX 分批转成 SoA 后调用 evaluate_batch()
+void evaluate_boards(const struct tetris *boards, size_t n, const struct eval_weights *w, int64_t *out);
+void board_batch_get(const struct board_batch *batch, int index, struct tetris *t);
+void board_batch_set(struct board_batch *batch, int index, const struct tetris *t);
+
+// 0 强制使用标量路径，非 0 在 CPU 支持时使用 AVX2 内核（默认）
+void set_placement_simd(int enabled);
+
+// score_placements() 落子与评估所用的棋盘表示；搜索的其余部分（撤销、置换表、批量展开）始终使用行布局
+enum board_backend {
+    BOARD_BACKEND_ROWS,        // 每行一个 uint16_t，由增量计数评估，CPU 支持时使用 AVX2 内核（默认）
+    BOARD_BACKEND_BITBOARD,    // 4 个 64 位字的位棋盘（见 bitboard.h），落子后用位运算整盘重算特征
+};
+
+void set_board_backend(enum board_backend backend);
+enum board_backend get_board_backend(void);
+
+extern const struct piece pieces[PIECE_TYPES];
+
+// 方块以 rot 旋转、从 col 列落下时最低一行所在的行号
+static inline int get_landing_row(const struct tetris *t, const struct rotation *rot, int col) {
+    int row = 0;  // 棋盘的最底行
+    for (int i = 0; i < rot->width; i++) {
+        int r =  t->col_height[col + i] - rot->vstart[i];
+        if (r > row) {
+            row = r;
+        }
+    }
 
-extern struct piece pieces[];
+    return row;
+}
 
 #endif // TETRIS_H
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tetris_engine.h"
+#include "tetris.h"
+#include "selfplay.h"
+#include "profile.h"
+#include "weights.h"
+#include "thread_pool.h"
+#include "rng.h"
+
+_Static_assert(TETRIS_ENGINE_ROWS == ROW && TETRIS_ENGINE_COLS == COL, "engine board size must match struct tetris");
+
+struct tetris_engine {
+    pthread_mutex_t lock;
+    struct tetris board;
+    int64_t score;
+    int64_t lines;
+    int64_t pieces;
+    int topped_out;                  // 有方块放不下
+    uint64_t rng;
+    struct eval_weights weights;
+    struct search_profile profile;
+    struct move_options options;     // 指向本结构体中的 weights、profile 和 pool
+};
+
+int tetris_engine_api_version(void) {
+    return TETRIS_ENGINE_API_VERSION;
+}
+
+void tetris_engine_config_init(struct tetris_engine_config *config) {
+    memset(config, 0, sizeof(*config));
+    config->level = 1;
+}
+
+static inline int game_over(const struct tetris_engine *e) {
+    return e->topped_out || e->board.max_height >= ROW - 1;
+}
+
+struct tetris_engine *tetris_engine_create(const struct tetris_engine_config *config) {
+    struct tetris_engine_config defaults;
+    if (config == NULL) {
+        tetris_engine_config_init(&defaults);
+        config = &defaults;
+    }
+    int level = config->level == 0 ? 1 : config->level;
+    if (level < 1 || level > SEARCH_LEVELS || config->move_budget_us < 0 ||
+        config->beam_width < 0 || config->beam_width > PLY_BEAM_MAX_WIDTH || config->search_threads < 0) {
+        return NULL;
+    }
+    struct tetris_engine *e = calloc(1, sizeof(struct tetris_engine));
+    if (e == NULL) {
+        return NULL;
+    }
+    e->weights = EVAL_WEIGHTS_DEFAULT;
+    e->profile = SEARCH_PROFILES[level - 1];
+    if ((config->weights_path && load_eval_weights(config->weights_path, &e->weights) != 0) ||
+        (config->profile_path && load_search_profile(config->profile_path, &e->profile) != 0)) {
+        free(e);
+        return NULL;
+    }
+    e->options.weights = &e->weights;
+    e->options.profile = &e->profile;
+    e->options.budget_us = config->move_budget_us;
+    e->options.beam_width = config->beam_width;
+    if (config->search_threads > 1) {
+        e->options.pool = thread_pool_create(config->search_threads - 1);
+        if (e->options.pool == NULL) {
+            free(e);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&e->lock, NULL);
+    tetris_engine_reset(e, config->seed);
+    return e;
+}
+
+void tetris_engine_destroy(struct tetris_engine *engine) {
+    if (engine == NULL) {
+        return;
+    }
+    thread_pool_destroy(engine->options.pool);
+    pthread_mutex_destroy(&engine->lock);
+    free(engine);
+}
+
+void tetris_engine_reset(struct tetris_engine *engine, uint64_t seed) {
+    pthread_mutex_lock(&engine->lock);
+    init_tetris(&engine->board);
+    engine->score = 0;
+    engine->lines = 0;
+    engine->pieces = 0;
+    engine->topped_out = 0;
+    engine->rng = seed;
+    pthread_mutex_unlock(&engine->lock);
+}
+
+char tetris_engine_random_piece(struct tetris_engine *engine) {
+    pthread_mutex_lock(&engine->lock);
+    int piece = rng_piece(&engine->rng);
+    pthread_mutex_unlock(&engine->lock);
+    return (char) get_piece_name(piece);
+}
+
+// 调用时持有 lock
+static int suggest_locked(struct tetris_engine *e, int curr, int next, struct tetris_engine_move *move) {
+    struct placement best = { 0, 0, 0 };
+    select_game_placement(&e->board, curr, next, &e->options, &best);
+    move->rotation = best.rotation;
+    move->col = best.col - COL_SHIFT;
+    move->lines = 0;
+    return 0;
+}
+
+// 调用时持有 lock，落点已检查
+static void apply_locked(struct tetris_engine *e, int piece, int rotation, int col, struct tetris_engine_move *move) {
+    place_piece(&e->board, &pieces[piece], rotation, col + COL_SHIFT);
+    if (e->board.landing_row == -1) {
+        e->topped_out = 1;
+    }
+    e->score += SCORE_TABLE[e->board.rows_eliminated];
+    e->lines += e->board.rows_eliminated;
+    e->pieces++;
+    if (move) {
+        move->rotation = rotation;
+        move->col = col;
+        move->lines = e->board.rows_eliminated;
+    }
+}
+
+int tetris_engine_suggest(struct tetris_engine *engine, char curr, char next, struct tetris_engine_move *move) {
+    int c = get_piece_index(curr);
+    int n = next ? get_piece_index(next) : -1;
+    if (c < 0 || (next && n < 0) || move == NULL) {
+        return -1;
+    }
+    pthread_mutex_lock(&engine->lock);
+    int ret = game_over(engine) ? -1 : suggest_locked(engine, c, n, move);
+    pthread_mutex_unlock(&engine->lock);
+    return ret;
+}
+
+int tetris_engine_play(struct tetris_engine *engine, char curr, char next, struct tetris_engine_move *move) {
+    int c = get_piece_index(curr);
+    int n = next ? get_piece_index(next) : -1;
+    if (c < 0 || (next && n < 0)) {
+        return -1;
+    }
+    pthread_mutex_lock(&engine->lock);
+    int ret = -1;
+    if (!game_over(engine)) {
+        struct tetris_engine_move chosen;
+        suggest_locked(engine, c, n, &chosen);
+        apply_locked(engine, c, chosen.rotation, chosen.col, move);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return ret;
+}
+
+int tetris_engine_apply(struct tetris_engine *engine, char piece, int rotation, int col,
+                        struct tetris_engine_move *move) {
+    int p = get_piece_index(piece);
+    if (p < 0 || rotation < 0 || rotation >= pieces[p].count ||
+        col < 0 || col + pieces[p].rotations[rotation].width > COL) {
+        return -1;
+    }
+    pthread_mutex_lock(&engine->lock);
+    int ret = -1;
+    if (!game_over(engine)) {
+        apply_locked(engine, p, rotation, col, move);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return ret;
+}
+
+int tetris_engine_get_state(struct tetris_engine *engine, struct tetris_engine_state *state) {
+    pthread_mutex_lock(&engine->lock);
+    state->score = engine->score;
+    state->lines = engine->lines;
+    state->pieces = engine->pieces;
+    state->max_height = engine->board.max_height;
+    state->game_over = game_over(engine);
+    for (int r = 0; r < ROW; r++) {
+        for (int c = 0; c < COL; c++) {
+            state->cells[r][c] = (engine->board.board[r] >> (c + COL_SHIFT)) & 1;
+        }
+    }
+    pthread_mutex_unlock(&engine->lock);
+    return 0;
+}
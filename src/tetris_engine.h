@@ -0,0 +1,82 @@
+#ifndef TETRIS_ENGINE_H
+#define TETRIS_ENGINE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// libtetris 的对外接口
+// 一个引擎对象下一局棋：持有棋盘、分数、随机方块序列、评估权重、搜索配置和自己的搜索线程池。
+// 不同的引擎可以在不同线程中同时使用；同一个引擎的调用由引擎内部的锁串行化。
+// 搜索用的临时缓冲按线程分配，在调用线程第一次搜索时建立，线程结束时释放。
+//
+// 这里只用基本类型，内部结构体不出现在接口中；libtetris.so 只导出 tetris_engine_* 符号。
+// 接口只增不改，不兼容的改动会提高 TETRIS_ENGINE_API_VERSION。
+//
+// 方块用字母 I T O J L S Z 表示。落子用 (rotation, col) 给出，与 PTA 协议的输出相同：
+// rotation 为旋转状态 0-3（PTA 协议输出的角度除以 90），col 为方块左边界所在列 0-9，均按硬降落下。
+// 函数成功时返回 0，参数非法或游戏已经结束时返回 -1。
+
+#define TETRIS_ENGINE_API_VERSION 1
+#define TETRIS_ENGINE_ROWS 20
+#define TETRIS_ENGINE_COLS 10
+
+struct tetris_engine;
+
+struct tetris_engine_config {
+    int level;                   // 内置搜索配置的激进等级 1-5，0 表示 1
+    const char *profile_path;    // 非 NULL 时从文件读取搜索配置，优先于 level（格式见 profile.h）
+    const char *weights_path;    // 非 NULL 时从文件读取评估权重（格式见 weights.h）
+    int64_t move_budget_us;      // 大于 0 时改用限时迭代加深搜索，每步最多用这么多微秒
+    int beam_width;              // 大于 0 时改用整层 beam 搜索，每层保留这么多个局面
+    int search_threads;          // 大于 1 时引擎自带这么多线程（含调用线程）并行搜索
+    uint64_t seed;               // tetris_engine_random_piece() 的随机种子
+};
+
+struct tetris_engine_move {
+    int rotation;
+    int col;
+    int lines;                   // 这一步消除的行数
+};
+
+struct tetris_engine_state {
+    int64_t score;
+    int64_t lines;
+    int64_t pieces;              // 已落下的方块数
+    int max_height;
+    int game_over;               // 堆到顶部后不再接受落子
+    // 第 0 行为底部，1 表示有方块
+    uint8_t cells[TETRIS_ENGINE_ROWS][TETRIS_ENGINE_COLS];
+};
+
+// 返回编译时的 TETRIS_ENGINE_API_VERSION，用来检查头文件与库是否一致
+int tetris_engine_api_version(void);
+
+void tetris_engine_config_init(struct tetris_engine_config *config);
+// config 为 NULL 时使用 tetris_engine_config_init() 的默认值；配置非法或文件读取失败时返回 NULL
+struct tetris_engine *tetris_engine_create(const struct tetris_engine_config *config);
+void tetris_engine_destroy(struct tetris_engine *engine);
+
+// 清空棋盘和分数，随机方块序列从 seed 重新开始
+void tetris_engine_reset(struct tetris_engine *engine, uint64_t seed);
+
+// 从引擎自己的随机序列取下一个方块字母，用于自我对弈
+char tetris_engine_random_piece(struct tetris_engine *engine);
+
+// 为当前方块 curr 选择落点但不落子；next 为下一个方块，未知时传 0
+int tetris_engine_suggest(struct tetris_engine *engine, char curr, char next, struct tetris_engine_move *move);
+// 选择落点并落子，move 可以为 NULL
+int tetris_engine_play(struct tetris_engine *engine, char curr, char next, struct tetris_engine_move *move);
+// 按给定的落点落子；落点越界时返回 -1。move 可以为 NULL，非空时写入消除的行数
+int tetris_engine_apply(struct tetris_engine *engine, char piece, int rotation, int col,
+                        struct tetris_engine_move *move);
+
+int tetris_engine_get_state(struct tetris_engine *engine, struct tetris_engine_state *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TETRIS_ENGINE_H
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "thread_pool.h"
+
+struct thread_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t  work_ready;    // 有新一批任务
+    pthread_cond_t  work_done;     // 本批任务全部完成
+    pthread_t *threads;
+    int thread_count;
+    int shutdown;
+
+    unsigned generation;           // 每批任务加一，用于唤醒工作线程
+    thread_pool_task task;
+    void *arg;
+    int count;
+    // 高 32 位为批次号（generation），低 32 位为下一个待领取的任务
+    // 批次号和下标一起比较交换，上一批的线程不会领到下一批的任务
+    _Atomic uint64_t next_claim;
+    int finished;                  // 已完成的任务数（受 lock 保护）
+};
+
+// 一批任务的快照，在 lock 下读取
+struct batch {
+    unsigned generation;
+    thread_pool_task task;
+    void *arg;
+    int count;
+};
+
+static struct batch current_batch(const struct thread_pool *pool) {
+    return (struct batch) { pool->generation, pool->task, pool->arg, pool->count };
+}
+
+// 领取并执行 batch 的任务直到领完或批次已更换，返回本线程完成的任务数
+static int run_tasks(struct thread_pool *pool, const struct batch *batch) {
+    int done = 0;
+    uint64_t claim = atomic_load(&pool->next_claim);
+    while (1) {
+        if ((unsigned) (claim >> 32) != batch->generation || (int) (uint32_t) claim >= batch->count) {
+            break;
+        }
+        if (!atomic_compare_exchange_weak(&pool->next_claim, &claim, claim + 1)) {
+            continue;
+        }
+        batch->task(batch->arg, (int) (uint32_t) claim);
+        done++;
+        claim = atomic_load(&pool->next_claim);
+    }
+    return done;
+}
+
+static void *pool_worker(void *arg) {
+    struct thread_pool *pool = arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen = pool->generation;
+        struct batch batch = current_batch(pool);
+        pthread_mutex_unlock(&pool->lock);
+
+        int done = run_tasks(pool, &batch);
+
+        pthread_mutex_lock(&pool->lock);
+        // 领到过任务的批次在这些任务完成前不会结束，所以 done > 0 时 generation 仍是本批
+        if (done > 0) {
+            pool->finished += done;
+            if (pool->finished == pool->count) {
+                pthread_cond_signal(&pool->work_done);
+            }
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+struct thread_pool *thread_pool_create(int threads) {
+    if (threads < 0) {
+        threads = 0;
+    }
+    struct thread_pool *pool = calloc(1, sizeof(struct thread_pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->threads = calloc(threads > 0 ? threads : 1, sizeof(pthread_t));
+    if (pool->threads == NULL) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+    atomic_init(&pool->next_claim, 0);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(struct thread_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+void thread_pool_run(struct thread_pool *pool, int count, thread_pool_task task, void *arg) {
+    if (count <= 0) {
+        return;
+    }
+    if (pool == NULL || pool->thread_count == 0 || count == 1) {
+        for (int i = 0; i < count; i++) {
+            task(arg, i);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->count = count;
+    pool->finished = 0;
+    pool->generation++;
+    atomic_store(&pool->next_claim, (uint64_t) pool->generation << 32);
+    struct batch batch = current_batch(pool);
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    int done = run_tasks(pool, &batch);    // 调用线程也参与计算
+
+    pthread_mutex_lock(&pool->lock);
+    pool->finished += done;
+    while (pool->finished < pool->count) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int thread_pool_size(const struct thread_pool *pool) {
+    return pool ? pool->thread_count : 0;
+}
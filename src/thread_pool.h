@@ -0,0 +1,22 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// 常驻线程池
+// 线程在创建时启动，之后每次 thread_pool_run 只是唤醒它们领取任务，
+// 因此可以在每一步落子时反复使用，而不必每次创建、销毁线程
+
+struct thread_pool;
+
+typedef void (*thread_pool_task)(void *arg, int index);
+
+// 创建包含 threads 个线程的线程池（调用线程也会参与计算，所以实际并行度为 threads + 1）
+struct thread_pool *thread_pool_create(int threads);
+void thread_pool_destroy(struct thread_pool *pool);
+
+// 对 index = 0..count-1 执行 task(arg, index)，全部完成后才返回
+// 同一时刻只允许一个调用者使用同一个线程池
+void thread_pool_run(struct thread_pool *pool, int count, thread_pool_task task, void *arg);
+
+int thread_pool_size(const struct thread_pool *pool);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,89 @@
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "ttable.h"
+
+struct tt_entry {
+    _Atomic uint64_t check;   // key ^ score
+    _Atomic uint64_t score;
+};
+
+static struct tt_entry tt_table[TT_SIZE];
+static atomic_int tt_on = 0;
+static _Atomic uint64_t tt_hits;
+static _Atomic uint64_t tt_misses;
+
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// 哈希范围：board[] 开始到 landing_row 之前的所有字段，再加上 rotation
+// landing_row 与 rows_eliminated 在下一次落子时会被覆盖，不影响子树得分
+#define HASH_BEGIN  offsetof(struct tetris, board)
+#define HASH_END    offsetof(struct tetris, landing_row)
+
+uint64_t hash_tetris(const struct tetris *t) {
+    uint64_t words[8] = {0};
+    _Static_assert(HASH_END - HASH_BEGIN + 1 <= sizeof(words), "hash buffer too small");
+    memcpy(words, (const char *) t + HASH_BEGIN, HASH_END - HASH_BEGIN);
+    ((unsigned char *) words)[HASH_END - HASH_BEGIN] = (unsigned char) t->rotation;
+
+    uint64_t h = 0x84222325CBF29CE4ULL;
+    for (int i = 0; i < 8; i++) {
+        h = mix64(h ^ words[i]) + i;
+    }
+    return h;
+}
+
+uint64_t tt_key(uint64_t board_hash, int piece_tag, int depth) {
+    return mix64(board_hash ^ ((uint64_t) piece_tag << 32) ^ (uint64_t) depth);
+}
+
+int tt_probe(uint64_t key, int64_t *score) {
+    if (!atomic_load_explicit(&tt_on, memory_order_relaxed)) {
+        return 0;
+    }
+    struct tt_entry *e = &tt_table[key & (TT_SIZE - 1)];
+    uint64_t check = atomic_load_explicit(&e->check, memory_order_relaxed);
+    uint64_t value = atomic_load_explicit(&e->score, memory_order_relaxed);
+    if ((check ^ value) == key) {
+        atomic_fetch_add_explicit(&tt_hits, 1, memory_order_relaxed);
+        *score = (int64_t) value;
+        return 1;
+    }
+    atomic_fetch_add_explicit(&tt_misses, 1, memory_order_relaxed);
+    return 0;
+}
+
+void tt_store(uint64_t key, int64_t score) {
+    if (!atomic_load_explicit(&tt_on, memory_order_relaxed)) {
+        return;
+    }
+    struct tt_entry *e = &tt_table[key & (TT_SIZE - 1)];
+    atomic_store_explicit(&e->check, key ^ (uint64_t) score, memory_order_relaxed);
+    atomic_store_explicit(&e->score, (uint64_t) score, memory_order_relaxed);
+}
+
+void tt_clear(void) {
+    for (size_t i = 0; i < TT_SIZE; i++) {
+        atomic_store_explicit(&tt_table[i].check, 0, memory_order_relaxed);
+        atomic_store_explicit(&tt_table[i].score, 0, memory_order_relaxed);
+    }
+    atomic_store(&tt_hits, 0);
+    atomic_store(&tt_misses, 0);
+}
+
+void tt_set_enabled(int enabled) {
+    atomic_store(&tt_on, enabled != 0);
+}
+
+int tt_enabled(void) {
+    return atomic_load(&tt_on);
+}
+
+void tt_get_stats(uint64_t *hits, uint64_t *misses) {
+    *hits = atomic_load(&tt_hits);
+    *misses = atomic_load(&tt_misses);
+}
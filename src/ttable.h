@@ -0,0 +1,32 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// 置换表
+// 搜索中不同的落子顺序、不同的 beam 父节点经常得到完全相同的局面，
+// 这里用局面哈希缓存“某局面上剩余若干步的最佳子树得分”，避免重复展开。
+// 表的大小固定，多个线程可以无锁地同时读写：每个表项存放 key^score 和 score，
+// 读到被并发写坏的表项时校验失败，当作未命中处理。
+// 两步搜索里几乎没有重复局面，查表反而是负担，所以置换表默认关闭，由 tt_set_enabled 打开。
+
+#define TT_BITS  20
+#define TT_SIZE  (1u << TT_BITS)
+
+// 局面哈希，覆盖棋盘以及影响后续评分的全部特征计数
+uint64_t hash_tetris(const struct tetris *t);
+
+// 由局面哈希、待落方块（或方块集合）和剩余深度组合出置换表的键
+uint64_t tt_key(uint64_t board_hash, int piece_tag, int depth);
+
+// 命中返回 1 并写入 *score，未命中返回 0
+int  tt_probe(uint64_t key, int64_t *score);
+void tt_store(uint64_t key, int64_t score);
+
+void tt_clear(void);
+void tt_set_enabled(int enabled);
+int  tt_enabled(void);
+void tt_get_stats(uint64_t *hits, uint64_t *misses);
+
+#endif // TTABLE_H
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "weights.h"
+
+const char *const EVAL_WEIGHT_NAMES[EVAL_WEIGHT_COUNT] = {
+    "landing_height", "rows_eliminated", "row_transitions", "col_transitions", "holes", "wells"
+};
+
+static const size_t weight_offsets[EVAL_WEIGHT_COUNT] = {
+    offsetof(struct eval_weights, landing_height),
+    offsetof(struct eval_weights, rows_eliminated),
+    offsetof(struct eval_weights, row_transitions),
+    offsetof(struct eval_weights, col_transitions),
+    offsetof(struct eval_weights, holes),
+    offsetof(struct eval_weights, wells),
+};
+
+static int64_t *weight_field(struct eval_weights *w, int i) {
+    return (int64_t *) ((char *) w + weight_offsets[i]);
+}
+
+void eval_weights_to_vector(const struct eval_weights *w, double *v) {
+    for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+        v[i] = (double) *weight_field((struct eval_weights *) w, i) / EVAL_WEIGHT_SCALE;
+    }
+}
+
+// 与 EVAL_WEIGHTS_DEFAULT 相同的截断方式，默认权重写出再读回后逐位不变
+void eval_weights_from_vector(struct eval_weights *w, const double *v) {
+    for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+        *weight_field(w, i) = (int64_t) (v[i] * EVAL_WEIGHT_SCALE);
+    }
+}
+
+int load_eval_weights(const char *path, struct eval_weights *w) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    // 未出现的权重取浮点默认值，而不是从定点值换算回来，避免截断误差
+    double v[EVAL_WEIGHT_COUNT] = {
+        WEIGHT_LANDING_HEIGHT, WEIGHT_ROWS_ELIMINATED, WEIGHT_ROW_TRANSITIONS,
+        WEIGHT_COLUMN_TRANSITIONS, WEIGHT_HOLES, WEIGHT_WELL_SUMS
+    };
+
+    char line[256];
+    int lineno = 0, ret = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char name[64];
+        double value;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\0') {
+            continue;
+        }
+        if (sscanf(p, "%63s %lf", name, &value) != 2) {
+            fprintf(stderr, "%s:%d: 无法解析: %s", path, lineno, line);
+            ret = -1;
+            break;
+        }
+        int i = 0;
+        while (i < EVAL_WEIGHT_COUNT && strcmp(name, EVAL_WEIGHT_NAMES[i]) != 0) {
+            i++;
+        }
+        if (i == EVAL_WEIGHT_COUNT) {
+            fprintf(stderr, "%s:%d: 未知的权重 %s\n", path, lineno, name);
+            ret = -1;
+            break;
+        }
+        v[i] = value;
+    }
+    fclose(f);
+    if (ret == 0) {
+        eval_weights_from_vector(w, v);
+    }
+    return ret;
+}
+
+void write_eval_weights(FILE *out, const double *v) {
+    for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+        fprintf(out, "%s %.17g\n", EVAL_WEIGHT_NAMES[i], v[i]);
+    }
+}
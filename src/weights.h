@@ -0,0 +1,22 @@
+#ifndef WEIGHTS_H
+#define WEIGHTS_H
+
+#include <stdio.h>
+#include "tetris.h"
+
+// 评估权重的浮点表示与权重文件
+// 权重文件为文本，每行“名字 浮点值”，# 开头的行为注释，未出现的名字保留默认值，例如：
+//   landing_height -4.500158825082766
+//   holes -7.899265427351652
+
+extern const char *const EVAL_WEIGHT_NAMES[EVAL_WEIGHT_COUNT];
+
+// 按 EVAL_WEIGHT_NAMES 的顺序与浮点向量互相转换
+void eval_weights_to_vector(const struct eval_weights *w, double *v);
+void eval_weights_from_vector(struct eval_weights *w, const double *v);
+
+// 成功返回 0；文件无法打开、出现未知名字或数值无法解析时返回 -1 并在 stderr 说明原因
+int  load_eval_weights(const char *path, struct eval_weights *w);
+void write_eval_weights(FILE *out, const double *v);
+
+#endif // WEIGHTS_H
@@ -1,8 +1,33 @@
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
 #include "../src/tetris.h"
+#include "../src/selfplay.h"
+#include "../src/rng.h"
+#include "../src/thread_pool.h"
+#include "../src/ttable.h"
+#include "../src/board_features.h"
+#include "../src/weights.h"
+#include "../src/beam.h"
+#include "../src/pta_io.h"
+#include "../src/game_log.h"
+#include "../src/search_stats.h"
+#include "../src/bitboard.h"
+#include "../src/movegen.h"
+#include "../src/rollout.h"
+#include "../src/ponder.h"
+#include "../src/tetris_engine.h"
+#include "../src/server.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
-void print_piece(struct piece *p) {
+static void print_piece(const struct piece *p) {
     for (int i = 0; i < p->count; i++) {
         printf("Rotation %d:\n", i);
         printf("Width: %d, Height: %d\n", p->rotations[i].width, p->rotations[i].height);
@@ -35,7 +60,7 @@ void print_piece(struct piece *p) {
 }
 
 
-void print_board(struct tetris *t) {
+static void print_board(struct tetris *t) {
     for (int i = ROW - 1; i >= 0; i--) {
         for (int j = COL_SHIFT; j < COL + COL_SHIFT; j++) {
             if (t->board[i] & (1 << j)) {
@@ -230,11 +255,1344 @@ void test_place_piece() {
     printf("max_height: %d\n", tetris.max_height);
 }
 
+void test_rng() {
+    uint64_t a = 42, b = 42;
+    int counts[PIECE_TYPES] = {0};
+    for (int i = 0; i < 7000; i++) {
+        int pa = rng_piece(&a);
+        int pb = rng_piece(&b);
+        CU_ASSERT_EQUAL(pa, pb);
+        CU_ASSERT(pa >= 0 && pa < PIECE_TYPES);
+        counts[pa]++;
+    }
+    for (int i = 0; i < PIECE_TYPES; i++) {
+        CU_ASSERT(counts[i] > 800 && counts[i] < 1200);
+    }
+    CU_ASSERT_NOT_EQUAL(rng_game_seed(1, 0), rng_game_seed(1, 1));
+    CU_ASSERT_NOT_EQUAL(rng_game_seed(1, 0), rng_game_seed(2, 0));
+}
+
+void test_selfplay_deterministic() {
+    enum { GAMES = 6, STEPS = 300 };
+    struct game_result serial[GAMES], parallel[GAMES];
+    CU_ASSERT_EQUAL(run_selfplay(GAMES, 1, 2024, STEPS, NULL, serial), 0);
+    CU_ASSERT_EQUAL(run_selfplay(GAMES, 4, 2024, STEPS, NULL, parallel), 0);
+    for (int i = 0; i < GAMES; i++) {
+        CU_ASSERT_EQUAL(serial[i].seed, rng_game_seed(2024, i));
+        CU_ASSERT_EQUAL(serial[i].seed, parallel[i].seed);
+        CU_ASSERT_EQUAL(serial[i].steps, parallel[i].steps);
+        CU_ASSERT_EQUAL(serial[i].score, parallel[i].score);
+        CU_ASSERT_EQUAL(serial[i].lines, parallel[i].lines);
+    }
+
+    struct game_result single;
+    play_seeded_game(rng_game_seed(2024, 3), STEPS, NULL, &single);
+    CU_ASSERT_EQUAL(single.steps, serial[3].steps);
+    CU_ASSERT_EQUAL(single.lines, serial[3].lines);
+}
+
+static void square_task(void *arg, int index) {
+    int *out = arg;
+    out[index] = index * index;
+}
+
+static void count_task(void *arg, int index) {
+    atomic_int *counts = arg;
+    atomic_fetch_add(&counts[index], 1);
+}
+
+void test_thread_pool() {
+    struct thread_pool *pool = thread_pool_create(3);
+    CU_ASSERT_PTR_NOT_NULL(pool);
+    CU_ASSERT_EQUAL(thread_pool_size(pool), 3);
+    int out[100];
+    for (int round = 0; round < 50; round++) {
+        memset(out, -1, sizeof(out));
+        thread_pool_run(pool, 100, square_task, out);
+        for (int i = 0; i < 100; i++) {
+            CU_ASSERT_EQUAL(out[i], i * i);
+        }
+    }
+    // 连续的小批次：上一批醒得晚的线程不能执行下一批的任务，每个下标恰好执行一次
+    atomic_int counts[2][8];
+    for (int round = 0; round < 2000; round++) {
+        atomic_int *batch = counts[round & 1];
+        int count = 2 + round % 7;
+        for (int i = 0; i < 8; i++) {
+            atomic_init(&batch[i], 0);
+        }
+        thread_pool_run(pool, count, count_task, batch);
+        for (int i = 0; i < 8; i++) {
+            CU_ASSERT_EQUAL(atomic_load(&batch[i]), (i < count ? 1 : 0));
+        }
+    }
+    thread_pool_destroy(pool);
+}
+
+// 随机落子堆出较高的局面，检查并行根节点搜索与串行搜索给出相同的结果
+void test_sampleSZ_pool_matches_serial() {
+    struct thread_pool *pool = thread_pool_create(3);
+    uint64_t rng = 99;
+    int compared = 0;
+    for (int game = 0; game < 20; game++) {
+        struct tetris t;
+        init_tetris(&t);
+        while (t.max_height < 17) {
+            int piece = rng_piece(&rng);
+            int next = rng_piece(&rng);
+            if (t.max_height >= 8) {
+                int r1 = -1, c1 = -1, r2 = -1, c2 = -1;
+                select_best_move_with_next_beam_sampleSZ(&t, piece, next, &r1, &c1);
+                select_best_move_with_next_beam_sampleSZ_pool(&t, piece, next, pool, &r2, &c2);
+                CU_ASSERT_EQUAL(r1, r2);
+                CU_ASSERT_EQUAL(c1, c2);
+                compared++;
+            }
+            const struct rotation *rot = &pieces[piece].rotations[0];
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - rot->width + 1));
+            place_piece(&t, &pieces[piece], 0, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+        }
+    }
+    CU_ASSERT(compared > 0);
+    thread_pool_destroy(pool);
+}
+
+void test_ttable() {
+    struct tetris a, b;
+    init_tetris(&a);
+    init_tetris(&b);
+    CU_ASSERT_EQUAL(hash_tetris(&a), hash_tetris(&b));
+    place_piece(&a, &pieces[0], 0, 1);
+    CU_ASSERT_NOT_EQUAL(hash_tetris(&a), hash_tetris(&b));
+    place_piece(&b, &pieces[0], 0, 1);
+    CU_ASSERT_EQUAL(hash_tetris(&a), hash_tetris(&b));
+
+    uint64_t h = hash_tetris(&a);
+    CU_ASSERT_NOT_EQUAL(tt_key(h, 5, 1), tt_key(h, 6, 1));
+    CU_ASSERT_NOT_EQUAL(tt_key(h, 5, 1), tt_key(h, 5, 2));
+
+    uint64_t hits0, misses0, hits1, misses1;
+    tt_set_enabled(1);
+    tt_get_stats(&hits0, &misses0);
+    int64_t score = 0;
+    uint64_t key = tt_key(h, 3, 7);
+    CU_ASSERT_EQUAL(tt_probe(key, &score), 0);
+    tt_store(key, -123456789);
+    CU_ASSERT_EQUAL(tt_probe(key, &score), 1);
+    CU_ASSERT_EQUAL(score, -123456789);
+    CU_ASSERT_EQUAL(tt_probe(key ^ 1, &score), 0);
+    tt_get_stats(&hits1, &misses1);
+    CU_ASSERT_EQUAL(hits1 - hits0, 1);
+    CU_ASSERT_EQUAL(misses1 - misses0, 2);
+    tt_set_enabled(0);
+}
+
+// 置换表只是缓存，开关置换表不应改变任何一步的选择
+void test_ttable_search_unchanged() {
+    enum { GAMES = 4, STEPS = 400 };
+    struct game_result with_tt[GAMES], without_tt[GAMES];
+    tt_clear();
+    tt_set_enabled(1);
+    run_selfplay(GAMES, 2, 77, STEPS, NULL, with_tt);
+    tt_set_enabled(0);
+    run_selfplay(GAMES, 2, 77, STEPS, NULL, without_tt);
+    for (int i = 0; i < GAMES; i++) {
+        CU_ASSERT_EQUAL(with_tt[i].steps, without_tt[i].steps);
+        CU_ASSERT_EQUAL(with_tt[i].score, without_tt[i].score);
+        CU_ASSERT_EQUAL(with_tt[i].lines, without_tt[i].lines);
+    }
+}
+
+// 随机落子得到一组中高局面，供搜索相关的测试使用
+static int random_boards(struct tetris *boards, int count, uint64_t seed) {
+    uint64_t rng = seed;
+    int n = 0;
+    while (n < count) {
+        struct tetris t;
+        init_tetris(&t);
+        while (n < count && t.max_height < 15) {
+            int piece = rng_piece(&rng);
+            const struct rotation *rot = &pieces[piece].rotations[0];
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - rot->width + 1));
+            place_piece(&t, &pieces[piece], 0, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+            if (t.max_height >= 6 && rng_next(&rng) % 4 == 0) {
+                boards[n++] = t;
+            }
+        }
+    }
+    return n;
+}
+
+void test_search_depth1_is_greedy() {
+    struct tetris boards[30];
+    random_boards(boards, 30, 5);
+    for (int i = 0; i < 30; i++) {
+        for (int piece = 0; piece < PIECE_TYPES; piece++) {
+            int r1 = -1, c1 = -1, r2 = -1, c2 = -1;
+            select_best_move(&boards[i], piece, &r1, &c1);
+            select_best_move_search(&boards[i], piece, -1, 1, &SEARCH_POLICY_EXPECTIMAX, &r2, &c2);
+            CU_ASSERT_EQUAL(r1, r2);
+            CU_ASSERT_EQUAL(c1, c2);
+        }
+    }
+}
+
+// alpha 剪枝、线程池和置换表都不应改变搜索结果
+void test_search_pruning_exact() {
+    struct thread_pool *pool = thread_pool_create(2);
+    struct tetris boards[12];
+    random_boards(boards, 12, 11);
+    const struct search_policy *policies[2] = { &SEARCH_POLICY_SAMPLE_SZ, &SEARCH_POLICY_EXPECTIMAX };
+    for (int k = 0; k < 2; k++) {
+        struct search_policy parallel = *policies[k];
+        parallel.pool = pool;
+        for (int i = 0; i < 12; i++) {
+            int curr = i % PIECE_TYPES, next = (i * 3 + 1) % PIECE_TYPES;
+            int r1 = -1, c1 = -1, r2 = -1, c2 = -1, r3 = -1, c3 = -1;
+            int64_t s1 = select_best_move_search(&boards[i], curr, next, 3, policies[k], &r1, &c1);
+            int64_t s2 = select_best_move_search(&boards[i], curr, next, 3, &parallel, &r2, &c2);
+            tt_set_enabled(1);
+            int64_t s3 = select_best_move_search(&boards[i], curr, next, 3, policies[k], &r3, &c3);
+            s3 = select_best_move_search(&boards[i], curr, next, 3, policies[k], &r3, &c3);
+            tt_set_enabled(0);
+            CU_ASSERT_EQUAL(s1, s2);
+            CU_ASSERT_EQUAL(s1, s3);
+            CU_ASSERT_EQUAL(r1, r2);
+            CU_ASSERT_EQUAL(c1, c2);
+            CU_ASSERT_EQUAL(r1, r3);
+            CU_ASSERT_EQUAL(c1, c3);
+        }
+    }
+    thread_pool_destroy(pool);
+}
+
+void test_search_expectimax_depth4() {
+    struct tetris t;
+    init_tetris(&t);
+    int rotation = -1, col = -1;
+    int64_t score = select_best_move_search(&t, 1, 0, 4, &SEARCH_POLICY_EXPECTIMAX, &rotation, &col);
+    CU_ASSERT(score != INT64_MIN);
+    CU_ASSERT(rotation >= 0 && rotation < pieces[1].count);
+    CU_ASSERT(col >= COL_SHIFT && col + pieces[1].rotations[rotation].width <= COL_SHIFT + COL);
+}
+
+void test_search_anytime() {
+    struct tetris boards[8];
+    random_boards(boards, 8, 21);
+    for (int i = 0; i < 8; i++) {
+        int curr = i % PIECE_TYPES, next = (i + 2) % PIECE_TYPES;
+        int r1 = -1, c1 = -1, r2 = -1, c2 = -1, depth = 0;
+
+        // 预算充足时与固定深度搜索结果一致
+        int64_t s1 = select_best_move_search(&boards[i], curr, next, 3, &SEARCH_POLICY_SAMPLE_SZ, &r1, &c1);
+        int64_t s2 = select_best_move_anytime(&boards[i], curr, next, 3, &SEARCH_POLICY_SAMPLE_SZ, 10000000,
+                                              &r2, &c2, &depth);
+        CU_ASSERT_EQUAL(depth, 3);
+        CU_ASSERT_EQUAL(s1, s2);
+        CU_ASSERT_EQUAL(r1, r2);
+        CU_ASSERT_EQUAL(c1, c2);
+
+        // 预算耗尽时仍然返回一个合法落点
+        select_best_move_anytime(&boards[i], curr, next, MAX_SEARCH_DEPTH, &SEARCH_POLICY_EXPECTIMAX, 1,
+                                 &r2, &c2, &depth);
+        CU_ASSERT(depth >= 1 && depth <= MAX_SEARCH_DEPTH);
+        if (depth == 1) {
+            select_best_move(&boards[i], curr, &r1, &c1);
+            CU_ASSERT_EQUAL(r1, r2);
+            CU_ASSERT_EQUAL(c1, c2);
+        }
+    }
+}
+
+// 向量化内核与逐列 place_piece() + evaluate_board() 的评分必须完全一致
+void test_score_placements_simd() {
+    uint64_t rng = 7;
+    int boards = 0;
+    for (int game = 0; game < 40; game++) {
+        struct tetris t;
+        init_tetris(&t);
+        while (1) {
+            boards++;
+            for (int piece = 0; piece < PIECE_TYPES; piece++) {
+                for (int r = 0; r < pieces[piece].count; r++) {
+                    int64_t expected[COL], simd[COL], scalar[COL];
+                    int n = 0;
+                    const struct rotation *rot = &pieces[piece].rotations[r];
+                    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                        struct tetris temp = t;
+                        place_piece(&temp, &pieces[piece], r, col);
+                        expected[n++] = evaluate_board(&temp, NULL);
+                    }
+                    set_placement_simd(1);
+                    CU_ASSERT_EQUAL(score_placements(&t, NULL, piece, r, simd), n);
+                    set_placement_simd(0);
+                    CU_ASSERT_EQUAL(score_placements(&t, NULL, piece, r, scalar), n);
+                    set_placement_simd(1);
+                    for (int i = 0; i < n; i++) {
+                        CU_ASSERT_EQUAL(simd[i], expected[i]);
+                        CU_ASSERT_EQUAL(scalar[i], expected[i]);
+                    }
+                }
+            }
+            int piece = rng_piece(&rng);
+            int r = (int) (rng_next(&rng) % pieces[piece].count);
+            const struct rotation *rot = &pieces[piece].rotations[r];
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - rot->width + 1));
+            place_piece(&t, &pieces[piece], r, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+        }
+    }
+    CU_ASSERT(boards > 100);
+}
+
+// 落子后撤销必须逐字节恢复原局面，落子结果也必须与 place_piece() 相同
+void test_place_piece_undoable() {
+    uint64_t rng = 13;
+    int clears = 0;
+    for (int game = 0; game < 30; game++) {
+        struct tetris t;
+        init_tetris(&t);
+        while (1) {
+            for (int piece = 0; piece < PIECE_TYPES; piece++) {
+                for (int r = 0; r < pieces[piece].count; r++) {
+                    const struct rotation *rot = &pieces[piece].rotations[r];
+                    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                        struct tetris before = t, expected = t;
+                        struct undo_record undo;
+                        place_piece(&expected, &pieces[piece], r, col);
+                        place_piece_undoable(&t, &pieces[piece], r, col, &undo);
+                        CU_ASSERT_EQUAL(memcmp(&t, &expected, sizeof(t)), 0);
+                        clears += t.rows_eliminated > 0;
+                        undo_piece(&t, &undo);
+                        CU_ASSERT_EQUAL(memcmp(&t, &before, sizeof(t)), 0);
+                    }
+                }
+            }
+            int piece = rng_piece(&rng);
+            int r = (int) (rng_next(&rng) % pieces[piece].count);
+            const struct rotation *rot = &pieces[piece].rotations[r];
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - rot->width + 1));
+            place_piece(&t, &pieces[piece], r, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+        }
+    }
+    CU_ASSERT(clears > 0);
+}
+
+// 编译期生成的元数据必须与形状本身一致
+void test_piece_metadata() {
+    for (int i = 0; i < PIECE_TYPES; i++) {
+        for (int j = 0; j < pieces[i].count; j++) {
+            const struct rotation *rot = &pieces[i].rotations[j];
+            int cells = 0;
+            for (int k = 0; k < rot->height; k++) {
+                uint16_t row = rot->shape[k];
+                CU_ASSERT(row != 0);
+                CU_ASSERT_EQUAL(row, ((1 << rot->hspan[k]) - 1) << rot->hstart[k]);
+                CU_ASSERT_EQUAL(rot->hend[k], rot->hstart[k] + rot->hspan[k]);
+                cells += rot->hspan[k];
+            }
+            CU_ASSERT_EQUAL(cells, 4);
+            for (int c = 0; c < rot->width; c++) {
+                int lowest = -1, highest = -1;
+                for (int k = 0; k < rot->height; k++) {
+                    if (rot->shape[k] & (1 << c)) {
+                        if (lowest < 0) {
+                            lowest = k;
+                        }
+                        highest = k;
+                    }
+                }
+                CU_ASSERT_EQUAL(rot->vstart[c], lowest);
+                CU_ASSERT_EQUAL(rot->vend[c], highest + 1);
+                CU_ASSERT_EQUAL(rot->vspan[c], highest + 1 - lowest);
+            }
+        }
+    }
+}
+
+// 随机落子直到触顶，每一步整盘重算的特征都应与增量计数一致
+void test_board_features() {
+    uint64_t rng = 11;
+    int moves = 0;
+    for (int g = 0; g < 200; g++) {
+        struct tetris t;
+        init_tetris(&t);
+        while (1) {
+            int p = rng_piece(&rng);
+            int r = rng_next(&rng) % pieces[p].count;
+            int col = COL_SHIFT + rng_next(&rng) % (COL - pieces[p].rotations[r].width + 1);
+            place_piece(&t, &pieces[p], r, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+            struct board_features f;
+            CU_ASSERT_EQUAL(check_board_features(&t, &f), 0);
+            CU_ASSERT(f.max_height <= t.max_height);
+            CU_ASSERT_EQUAL(evaluate_board_full(&t, NULL), evaluate_board(&t, NULL));
+            moves++;
+        }
+    }
+    CU_ASSERT(moves > 1000);
+
+    // 手工构造：底行只留第 1、3 列两个空格，上一行第 1 列压着一个方块
+    struct tetris t;
+    init_tetris(&t);
+    t.board[0] = FULL_ROW & ~(1 << 1) & ~(1 << 3);
+    t.board[1] = EMPTY_ROW | (1 << 1);
+    struct board_features f;
+    compute_board_features(&t, &f);
+    CU_ASSERT_EQUAL(f.max_height, 2);
+    CU_ASSERT_EQUAL(f.col_height[1], 2);
+    CU_ASSERT_EQUAL(f.col_height[2], 1);
+    CU_ASSERT_EQUAL(f.holes, 1);
+    CU_ASSERT_EQUAL(f.wells, 2);             // 底行两个空格左右都是方块或墙
+    CU_ASSERT_EQUAL(f.row_transitions, 1);   // 底行中间的方块不与墙相连
+    CU_ASSERT_EQUAL(f.col_transitions, 1);   // 第 1 列的方块压在空洞上
+}
+
+// 权重文件读写与运行时权重
+void test_eval_weights() {
+    // 默认权重写出再读回逐位不变
+    const char *path = "test_weights.txt";
+    double v[EVAL_WEIGHT_COUNT] = {
+        WEIGHT_LANDING_HEIGHT, WEIGHT_ROWS_ELIMINATED, WEIGHT_ROW_TRANSITIONS,
+        WEIGHT_COLUMN_TRANSITIONS, WEIGHT_HOLES, WEIGHT_WELL_SUMS
+    };
+    FILE *f = fopen(path, "w");
+    CU_ASSERT_PTR_NOT_NULL(f);
+    if (f == NULL) {
+        return;
+    }
+    fprintf(f, "# comment\n");
+    write_eval_weights(f, v);
+    fclose(f);
+    struct eval_weights w;
+    CU_ASSERT_EQUAL(load_eval_weights(path, &w), 0);
+    CU_ASSERT_EQUAL(memcmp(&w, &EVAL_WEIGHTS_DEFAULT, sizeof(w)), 0);
+
+    f = fopen(path, "w");
+    fprintf(f, "holes -20\nbogus 1\n");
+    fclose(f);
+    CU_ASSERT_EQUAL(load_eval_weights(path, &w), -1);
+    remove(path);
+
+    // 传入默认权重的副本与传 NULL 结果相同；改变权重后评分随之改变
+    struct tetris boards[40];
+    int count = random_boards(boards, 40, 99);
+    struct eval_weights copy = EVAL_WEIGHTS_DEFAULT;
+    struct eval_weights heavy = EVAL_WEIGHTS_DEFAULT;
+    heavy.holes *= 10;
+    int differ = 0;
+    for (int i = 0; i < count; i++) {
+        struct tetris t = boards[i];
+        place_piece(&t, &pieces[i % PIECE_TYPES], 0, COL_SHIFT + i % 7);
+        CU_ASSERT_EQUAL(evaluate_board(&t, &copy), evaluate_board(&t, NULL));
+        differ += t.holes && evaluate_board(&t, &heavy) != evaluate_board(&t, NULL);
+
+        struct search_policy policy = SEARCH_POLICY_EXPECTIMAX;
+        int r1 = -1, c1 = -1, r2 = -1, c2 = -1;
+        int64_t s1 = select_best_move_search(&boards[i], i % PIECE_TYPES, (i + 3) % PIECE_TYPES, 3, &policy, &r1, &c1);
+        policy.weights = &copy;
+        int64_t s2 = select_best_move_search(&boards[i], i % PIECE_TYPES, (i + 3) % PIECE_TYPES, 3, &policy, &r2, &c2);
+        CU_ASSERT_EQUAL(s1, s2);
+        CU_ASSERT_EQUAL(r1, r2);
+        CU_ASSERT_EQUAL(c1, c2);
+    }
+    CU_ASSERT(differ > 0);
+
+    struct game_result a, b;
+    play_seeded_game(rng_game_seed(5, 0), 300, NULL, &a);
+    struct move_options options = {0};
+    options.weights = &copy;
+    play_seeded_game(rng_game_seed(5, 0), 300, &options, &b);
+    CU_ASSERT_EQUAL(a.lines, b.lines);
+    CU_ASSERT_EQUAL(a.score, b.score);
+}
+
+// 整层展开的 SoA 批量接口必须与逐个 place_piece() + evaluate_board() 完全一致
+void test_place_piece_batch() {
+    struct tetris boards[60];
+    int count = random_boards(boards, 60, 123);
+    static struct tetris children[PIECE_TYPES * 60 * MAX_PLACEMENTS];
+    static int64_t expected_scores[PIECE_TYPES * 60 * MAX_PLACEMENTS];
+    int total = 0;
+    for (int simd = 0; simd <= 1; simd++) {
+        set_placement_simd(simd);
+        total = 0;
+        for (int b = 0; b < count; b++) {
+            for (int piece = 0; piece < PIECE_TYPES; piece++) {
+                struct board_batch batch;
+                int64_t scores[BOARD_BATCH_MAX];
+                int n = place_piece_batch(&boards[b], piece, &batch);
+                evaluate_batch(&batch, NULL, scores);
+                int k = 0;
+                for (int r = 0; r < pieces[piece].count; r++) {
+                    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - pieces[piece].rotations[r].width; col++, k++) {
+                        struct tetris expected = boards[b];
+                        place_piece(&expected, &pieces[piece], r, col);
+                        struct tetris got;
+                        board_batch_get(&batch, k, &got);
+                        CU_ASSERT_EQUAL(batch.move_rotation[k], r);
+                        CU_ASSERT_EQUAL(batch.move_col[k], col);
+                        CU_ASSERT_EQUAL(scores[k], evaluate_board(&expected, NULL));
+                        if (expected.landing_row != -1) {
+                            CU_ASSERT_EQUAL(memcmp(&got, &expected, sizeof(got)), 0);
+                        } else {
+                            CU_ASSERT_EQUAL(got.landing_row, -1);
+                        }
+                        children[total] = expected;
+                        expected_scores[total++] = scores[k];
+                    }
+                }
+                CU_ASSERT_EQUAL(n, k);
+            }
+        }
+    }
+    set_placement_simd(1);
+
+    // 普通布局的接口跨越多个批次
+    static int64_t out[PIECE_TYPES * 60 * MAX_PLACEMENTS];
+    evaluate_boards(children, total, NULL, out);
+    CU_ASSERT_EQUAL(memcmp(out, expected_scores, sizeof(int64_t) * total), 0);
+}
+
+// 部分选择与对全部下标稳定排序后取前 k 个的结果相同
+void test_select_top_scores() {
+    uint64_t rng = 99;
+    static int64_t scores[3000];
+    static int32_t order[3000], expected[3000];
+    const int sizes[] = {1, 5, 40, 400, 3000};
+    const int widths[] = {1, 4, 16, 17, 64, 512, 5000};
+    for (int s = 0; s < 5; s++) {
+        int n = sizes[s];
+        for (int i = 0; i < n; i++) {
+            // 取值范围很小，制造大量相同评分；偶尔出现非法落点
+            scores[i] = (rng_next(&rng) % 8 == 0) ? INT64_MIN : (int64_t) (rng_next(&rng) % 50);
+        }
+        // 稳定的插入排序作为参照
+        for (int i = 0; i < n; i++) {
+            int j = i;
+            while (j > 0 && scores[expected[j - 1]] < scores[i]) {
+                expected[j] = expected[j - 1];
+                j--;
+            }
+            expected[j] = i;
+        }
+        for (int w = 0; w < 7; w++) {
+            int k = widths[w];
+            int got = select_top_scores(scores, n, k, order);
+            CU_ASSERT_EQUAL(got, k < n ? k : n);
+            CU_ASSERT_EQUAL(memcmp(order, expected, sizeof(int32_t) * got), 0);
+        }
+    }
+    CU_ASSERT_EQUAL(select_top_scores(scores, 0, 4, order), 0);
+}
+
+// 整层 beam 足够宽时与逐节点不限宽度的搜索得分相同；并行与串行的结果逐位一致
+void test_ply_beam_search() {
+    struct tetris boards[12];
+    int count = random_boards(boards, 12, 321);
+    struct thread_pool *pool = thread_pool_create(3);
+    for (int b = 0; b < count; b++) {
+        int curr = b % PIECE_TYPES, next = (b * 3 + 1) % PIECE_TYPES;
+        for (int depth = 1; depth <= 3; depth++) {
+            struct search_policy full = SEARCH_POLICY_SAMPLE_SZ;
+            for (int i = 0; i < MAX_SEARCH_DEPTH; i++) {
+                full.beam_width[i] = 0;
+            }
+            struct search_policy wide = full;
+            wide.ply_beam_width = PLY_BEAM_MAX_WIDTH;
+            int r1, c1, r2, c2;
+            struct tetris t1 = boards[b], t2 = boards[b];
+            int64_t s1 = select_best_move_search(&t1, curr, next, depth, &full, &r1, &c1);
+            int64_t s2 = select_best_move_search(&t2, curr, next, depth, &wide, &r2, &c2);
+            CU_ASSERT_EQUAL(s1, s2);
+            CU_ASSERT_EQUAL(memcmp(&t2, &boards[b], sizeof(struct tetris)), 0);
+
+            // 窄一些的整层 beam：串行剪枝与线程池并行的结果一致
+            struct search_policy narrow = SEARCH_POLICY_SAMPLE_SZ;
+            narrow.ply_beam_width = 64;
+            int64_t s3 = select_best_move_search(&t1, curr, next, depth, &narrow, &r1, &c1);
+            narrow.pool = pool;
+            int64_t s4 = select_best_move_search(&t1, curr, next, depth, &narrow, &r2, &c2);
+            CU_ASSERT_EQUAL(s3, s4);
+            CU_ASSERT_EQUAL(r1, r2);
+            CU_ASSERT_EQUAL(c1, c2);
+            CU_ASSERT(s3 <= s1);
+        }
+    }
+    thread_pool_destroy(pool);
+}
+
+void test_search_profile() {
+    // 内置配置写出再读回不变
+    const char *path = "test_profile.txt";
+    for (int level = 0; level < SEARCH_LEVELS; level++) {
+        FILE *f = fopen(path, "w");
+        CU_ASSERT_PTR_NOT_NULL(f);
+        if (f == NULL) {
+            return;
+        }
+        fprintf(f, "# comment\n");
+        write_search_profile(f, &SEARCH_PROFILES[level]);
+        fclose(f);
+        struct search_profile loaded;
+        CU_ASSERT_EQUAL(load_search_profile(path, &loaded), 0);
+        CU_ASSERT_EQUAL(loaded.tier_count, SEARCH_PROFILES[level].tier_count);
+        CU_ASSERT_EQUAL(memcmp(loaded.tiers, SEARCH_PROFILES[level].tiers,
+                               sizeof(struct search_tier) * loaded.tier_count), 0);
+    }
+
+    // 省略的字段取默认值；格式错误、高度没有递增都拒绝
+    FILE *f = fopen(path, "w");
+    fprintf(f, "tier 10 depth 2\ntier 20 depth 4 mode expectimax pieces IO beam 3,2 ply_beam 100\n");
+    fclose(f);
+    struct search_profile profile;
+    CU_ASSERT_EQUAL(load_search_profile(path, &profile), 0);
+    CU_ASSERT_EQUAL(profile.tier_count, 2);
+    CU_ASSERT_EQUAL(profile.tiers[0].mode, SEARCH_MINMAX);
+    CU_ASSERT_EQUAL(profile.tiers[0].piece_mask, PIECE_MASK_ALL);
+    CU_ASSERT_EQUAL(profile.tiers[1].piece_mask, (1 << 0) | (1 << 2));
+    CU_ASSERT_EQUAL(profile.tiers[1].beam_width[1], 2);
+    CU_ASSERT_EQUAL(profile.tiers[1].beam_width[2], 0);
+    CU_ASSERT_EQUAL(profile.tiers[1].ply_beam_width, 100);
+    CU_ASSERT(search_profile_tier(&profile, 9) == &profile.tiers[0]);
+    CU_ASSERT(search_profile_tier(&profile, 10) == &profile.tiers[1]);
+    CU_ASSERT(search_profile_tier(&profile, 25) == &profile.tiers[1]);
+    const char *bad[] = {
+        "tier 10 depth 9\n", "tier 10 depth 2 pieces X\n", "tier 10 depth 2 speed 3\n",
+        "tier 10 depth 2\ntier 5 depth 3\n", "tier 10 depth\n", "\n",
+    };
+    for (int i = 0; i < 6; i++) {
+        f = fopen(path, "w");
+        fputs(bad[i], f);
+        fclose(f);
+        CU_ASSERT_EQUAL(load_search_profile(path, &profile), -1);
+    }
+    remove(path);
+
+    // 等级 1 与原来写死的策略逐位一致
+    struct tetris boards[40];
+    int count = random_boards(boards, 40, 17);
+    for (int i = 0; i < count; i++) {
+        int curr = i % PIECE_TYPES, next = (i + 2) % PIECE_TYPES;
+        int r1, c1, r2, c2;
+        struct tetris t = boards[i];
+        int depth = select_game_move(&t, curr, next, NULL, &r1, &c1);
+        if (boards[i].max_height < 13) {
+            select_best_move_with_next_beam(&boards[i], curr, next, &r2, &c2);
+            CU_ASSERT_EQUAL(depth, 2);
+        } else {
+            select_best_move_with_next_beam_sampleSZ(&boards[i], curr, next, &r2, &c2);
+            CU_ASSERT_EQUAL(depth, 3);
+        }
+        CU_ASSERT_EQUAL(r1, r2);
+        CU_ASSERT_EQUAL(c1, c2);
+    }
+}
+
+void test_pta_io() {
+    // 同一个方块序列的 token 与 binary 两种写法，分别用内存映射和文件描述符读
+    const char *path = "test_pieces.txt";
+    const int expected[] = {0, 1, 5, PIECE_FLUSH, 6, 2, 3, 4, PIECE_END, PIECE_INVALID, PIECE_EOF};
+    FILE *f = fopen(path, "w");
+    CU_ASSERT_PTR_NOT_NULL(f);
+    if (f == NULL) {
+        return;
+    }
+    fputs("IT\nS\n! Z\r\nO J\tL\nX\n?", f);
+    fclose(f);
+    struct piece_reader reader;
+    CU_ASSERT_EQUAL(piece_reader_open_file(&reader, path, PTA_FORMAT_TOKEN), 0);
+    for (int i = 0; i < 11; i++) {
+        CU_ASSERT_EQUAL(piece_reader_next(&reader), expected[i]);
+    }
+    piece_reader_close(&reader);
+
+    f = fopen(path, "wb");
+    const unsigned char bytes[] = {0, 1, 5, 8, 6, 2, 3, 4, 7, 'I'};
+    fwrite(bytes, 1, sizeof(bytes), f);
+    fclose(f);
+    int fd = open(path, O_RDONLY);
+    CU_ASSERT_EQUAL(piece_reader_open_fd(&reader, fd, PTA_FORMAT_BINARY), 0);
+    for (int i = 0; i < 11; i++) {
+        CU_ASSERT_EQUAL(piece_reader_next(&reader), expected[i]);
+    }
+    piece_reader_close(&reader);
+    close(fd);
+    CU_ASSERT_EQUAL(piece_reader_open_file(&reader, "no_such_pieces_file", PTA_FORMAT_TOKEN), -1);
+    remove(path);
+
+    // 三种输出格式；text 格式与原来的 print_board + 两行结果相同
+    struct tetris t;
+    init_tetris(&t);
+    place_piece(&t, &pieces[0], 0, COL_SHIFT + 3);
+    char *text;
+    size_t size;
+    FILE *out = open_memstream(&text, &size);
+    struct move_writer writer = { out, PTA_FORMAT_TEXT, 1, 1, 0 };
+    move_writer_put(&writer, &t, 0, COL_SHIFT + 3, 100);
+    CU_ASSERT_EQUAL(size, ROW * (COL + 1) + 1 + strlen("0 3\n100\n"));
+    CU_ASSERT(strncmp(text + ROW * (COL + 1) - (COL + 1), "...XXXX...\n\n0 3\n100\n", COL + 11) == 0);
+    fclose(out);
+    free(text);
+
+    out = open_memstream(&text, &size);
+    struct move_writer token = { out, PTA_FORMAT_TOKEN, 0, 0, 0 };
+    move_writer_put(&token, &t, 0, COL_SHIFT + 3, 100);
+    move_writer_put(&token, &t, 0, COL_SHIFT, 400);
+    CU_ASSERT_EQUAL(token.pending, 2);
+    move_writer_flush(&token);
+    CU_ASSERT_EQUAL(token.pending, 0);
+    CU_ASSERT_STRING_EQUAL(text, "0 3 100\n0 0 400\n");
+    fclose(out);
+    free(text);
+
+    out = open_memstream(&text, &size);
+    struct move_writer binary = { out, PTA_FORMAT_BINARY, 1, 0, 0 };
+    move_writer_put(&binary, &t, 1, COL_SHIFT + 3, 100);
+    move_writer_put(&binary, &t, 3, COL_SHIFT + 9, 100);
+    move_writer_flush(&binary);
+    CU_ASSERT_EQUAL(size, 2);
+    CU_ASSERT_EQUAL((unsigned char) text[0], 0x13);
+    CU_ASSERT_EQUAL((unsigned char) text[1], 0x39);
+    fclose(out);
+    free(text);
+}
+
+void test_game_log() {
+    const char *path = "test_game.log";
+    struct game_log_header header = { 0x0123456789ABCDEFULL, 3, 128 };
+    struct game_log log;
+    CU_ASSERT_EQUAL(game_log_create(&log, path, &header), 0);
+    struct game_log_move moves[200];
+    uint64_t rng = 7;
+    for (int i = 0; i < 200; i++) {
+        moves[i].piece = rng_piece(&rng);
+        moves[i].rotation = (int) (rng_next(&rng) % 4);
+        moves[i].col = COL_SHIFT + (int) (rng_next(&rng) % COL);
+        moves[i].score_delta = SCORE_TABLE[rng_next(&rng) % 5];
+        CU_ASSERT_EQUAL(game_log_write_move(&log, &moves[i]), 0);
+    }
+    CU_ASSERT_EQUAL(game_log_finish(&log, 4), 0);
+
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    CU_ASSERT(size < 200 * 3 + 32);     // 每步不超过 3 字节
+
+    CU_ASSERT_EQUAL(game_log_open(&log, path), 0);
+    CU_ASSERT_EQUAL(log.header.seed, header.seed);
+    CU_ASSERT_EQUAL(log.header.level, 3);
+    CU_ASSERT_EQUAL(log.header.beam_width, 128);
+    struct game_log_move move;
+    for (int i = 0; i < 200; i++) {
+        CU_ASSERT_EQUAL(game_log_read_move(&log, &move), 1);
+        CU_ASSERT_EQUAL(memcmp(&move, &moves[i], sizeof(move)), 0);
+    }
+    CU_ASSERT_EQUAL(game_log_read_move(&log, &move), 0);
+    CU_ASSERT_EQUAL(log.next_piece, 4);
+    game_log_close(&log);
+
+    // 截断的记录读到中途报错
+    if (truncate(path, size / 2) == 0) {
+        CU_ASSERT_EQUAL(game_log_open(&log, path), 0);
+        int ret;
+        while ((ret = game_log_read_move(&log, &move)) == 1) {
+        }
+        CU_ASSERT_EQUAL(ret, -1);
+        game_log_close(&log);
+    }
+    remove(path);
+    CU_ASSERT_EQUAL(game_log_open(&log, "no_such_game.log"), -1);
+}
+
+static void *search_one_move(void *arg) {
+    struct tetris t;
+    init_tetris(&t);
+    int rotation, col;
+    select_game_move(&t, 2, 3, NULL, &rotation, &col);
+    return arg;
+}
+
+void test_search_stats() {
+    struct search_stats a = {0}, b = {0}, out;
+    a.nodes[0] = 1; a.nodes[1] = 4; a.placements = 40; a.invalid = 2; a.beam_cutoffs = 3;
+    b.nodes[1] = 6; b.ply_ns[1] = 100; b.place_piece = 7; b.placements = 10;
+    search_stats_add(&a, &b);
+    CU_ASSERT_EQUAL(a.nodes[1], 10);
+    CU_ASSERT_EQUAL(a.ply_ns[1], 100);
+    CU_ASSERT_EQUAL(a.place_piece, 7);
+    CU_ASSERT_EQUAL(a.placements, 50);
+
+    // 高度越界时归入两端
+    static struct search_stats_table table;
+    search_stats_record(&table, 5, &a);
+    search_stats_record(&table, 5, &b);
+    search_stats_record(&table, ROW + 3, &b);
+    CU_ASSERT_EQUAL(table.moves[5], 2);
+    CU_ASSERT_EQUAL(table.moves[ROW], 1);
+    CU_ASSERT_EQUAL(table.by_height[5].nodes[1], 16);
+
+    // 搜索一步后汇总：未打开时全为 0，打开时根节点计数为 1，汇总后清零
+    search_stats_collect(&out);
+    struct tetris t;
+    init_tetris(&t);
+    int rotation, col;
+    select_game_move(&t, 2, 3, NULL, &rotation, &col);
+    search_stats_collect(&out);
+    CU_ASSERT_EQUAL(out.nodes[0], (search_stats_enabled() ? 1 : 0));
+    CU_ASSERT(search_stats_enabled() ? out.placements > 0 : out.placements == 0);
+    search_stats_collect(&out);
+    CU_ASSERT_EQUAL(out.nodes[0], 0);
+
+    // 线程退出后它的计数仍然计入汇总，槽位留给下一个线程
+    for (int round = 0; round < 3; round++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, search_one_move, NULL);
+        pthread_join(thread, NULL);
+        search_stats_collect(&out);
+        CU_ASSERT_EQUAL(out.nodes[0], (search_stats_enabled() ? 1 : 0));
+    }
+}
+
+// 位棋盘的落点、消行和特征必须与行布局的 place_piece() 和 compute_board_features() 完全一致
+void test_bitboard() {
+    uint64_t rng = 11;
+    for (int game = 0; game < 20; game++) {
+        struct tetris t;
+        init_tetris(&t);
+        while (1) {
+            struct bitboard board;
+            struct tetris back;
+            bitboard_from_tetris(&board, &t);
+            bitboard_to_tetris(&board, &back);
+            CU_ASSERT_EQUAL(memcmp(back.board, t.board, sizeof(t.board)), 0);
+            CU_ASSERT_EQUAL(memcmp(back.col_height, t.col_height, sizeof(t.col_height)), 0);
+            CU_ASSERT_EQUAL(back.holes, t.holes);
+
+            for (int piece = 0; piece < PIECE_TYPES; piece++) {
+                for (int r = 0; r < pieces[piece].count; r++) {
+                    const struct rotation *rot = &pieces[piece].rotations[r];
+                    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                        struct tetris expected = t;
+                        place_piece(&expected, &pieces[piece], r, col);
+                        if (expected.landing_row != -1) {
+                            CU_ASSERT_EQUAL(bitboard_landing_row(&board, rot, col), expected.landing_row);
+                        }
+                        for (int pext = 0; pext <= 1; pext++) {
+                            set_bitboard_pext(pext);
+                            struct bitboard b = board;
+                            int rows_eliminated;
+                            int row = bitboard_place(&b, rot, col, &rows_eliminated);
+                            CU_ASSERT_EQUAL(row, expected.landing_row);
+                            if (row == -1) {
+                                CU_ASSERT_EQUAL(memcmp(&b, &board, sizeof(b)), 0);
+                                continue;
+                            }
+                            CU_ASSERT_EQUAL(rows_eliminated, expected.rows_eliminated);
+                            bitboard_to_tetris(&b, &back);
+                            CU_ASSERT_EQUAL(memcmp(back.board, expected.board, sizeof(expected.board)), 0);
+
+                            struct board_features want, got;
+                            compute_board_features(&expected, &want);
+                            bitboard_features(&b, &got);
+                            CU_ASSERT_EQUAL(got.max_height, want.max_height);
+                            CU_ASSERT_EQUAL(got.holes, want.holes);
+                            CU_ASSERT_EQUAL(got.row_transitions, want.row_transitions);
+                            CU_ASSERT_EQUAL(got.col_transitions, want.col_transitions);
+                            CU_ASSERT_EQUAL(got.wells, want.wells);
+                        }
+                    }
+
+                    // 两种棋盘表示给出的评分逐位相同
+                    int64_t rows[COL], bits[COL];
+                    set_board_backend(BOARD_BACKEND_ROWS);
+                    int n = score_placements(&t, NULL, piece, r, rows);
+                    set_board_backend(BOARD_BACKEND_BITBOARD);
+                    CU_ASSERT_EQUAL(score_placements(&t, NULL, piece, r, bits), n);
+                    set_board_backend(BOARD_BACKEND_ROWS);
+                    CU_ASSERT_EQUAL(memcmp(rows, bits, sizeof(int64_t) * n), 0);
+                }
+            }
+            set_bitboard_pext(1);
+
+            int piece = rng_piece(&rng);
+            int r = (int) (rng_next(&rng) % pieces[piece].count);
+            const struct rotation *rot = &pieces[piece].rotations[r];
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - rot->width + 1));
+            place_piece(&t, &pieces[piece], r, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+        }
+    }
+}
+
+// 落点 (rotation, col, row) 不与棋盘相交、不越界，且再往下一行就会相交
+static int placement_is_legal(const struct tetris *t, int piece, const struct placement *pl) {
+    const struct rotation *rot = &pieces[piece].rotations[pl->rotation];
+    if (pl->row < 0 || pl->row + rot->height > ROW) {
+        return 0;
+    }
+    for (int i = 0; i < rot->height; i++) {
+        if (t->board[pl->row + i] & (rot->shape[i] << pl->col)) {
+            return 0;
+        }
+    }
+    if (pl->row == 0) {
+        return 1;
+    }
+    for (int i = 0; i < rot->height; i++) {
+        if (t->board[pl->row - 1 + i] & (rot->shape[i] << pl->col)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void check_placed_counters(const struct tetris *t) {
+    struct board_features f;
+    compute_board_features(t, &f);
+    CU_ASSERT_EQUAL(memcmp(f.col_height, t->col_height, sizeof(f.col_height)), 0);
+    CU_ASSERT(t->max_height >= f.max_height);
+    CU_ASSERT_EQUAL(f.holes, t->holes);
+    CU_ASSERT_EQUAL(f.row_transitions, t->row_transitions);
+    CU_ASSERT_EQUAL(f.col_transitions, t->col_transitions);
+    CU_ASSERT_EQUAL(f.wells, t->wells);
+}
+
+void test_movegen() {
+    // 第 1 行左边两格悬空，横放的 I 只能从右边平移进第 0 行
+    struct tetris t;
+    struct bitboard b;
+    init_tetris(&t);
+    t.board[1] |= 3 << COL_SHIFT;
+    bitboard_from_tetris(&b, &t);
+    bitboard_to_tetris(&b, &t);
+    CU_ASSERT(t.holes > 0);
+    struct placement out[MAX_REACHABLE_PLACEMENTS];
+    int found = 0;
+    for (int piece = 0; piece < PIECE_TYPES; piece++) {
+        int n = generate_tucks(&t, piece, out);
+        for (int i = 0; i < n; i++) {
+            const struct rotation *rot = &pieces[piece].rotations[out[i].rotation];
+            if (rot->height == 1 && out[i].col == COL_SHIFT && out[i].row == 0) {
+                found = 1;
+            }
+        }
+    }
+    CU_ASSERT(found);
+
+    uint64_t rng = 23;
+    for (int game = 0; game < 10; game++) {
+        init_tetris(&t);
+        for (int step = 0; step < 200; step++) {
+            for (int piece = 0; piece < PIECE_TYPES; piece++) {
+                int n = generate_placements(&t, piece, out);
+                int drops = 0;
+                for (int r = 0; r < pieces[piece].count; r++) {
+                    const struct rotation *rot = &pieces[piece].rotations[r];
+                    for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                        int row = get_landing_row(&t, rot, col);
+                        if (row + rot->height <= ROW) {
+                            CU_ASSERT(drops < n && out[drops].rotation == r && out[drops].col == col &&
+                                      out[drops].row == row);
+                            drops++;
+                        }
+                    }
+                }
+                for (int i = 0; i < n; i++) {
+                    CU_ASSERT(placement_is_legal(&t, piece, &out[i]));
+                    for (int j = 0; j < i; j++) {
+                        CU_ASSERT(out[i].rotation != out[j].rotation || out[i].col != out[j].col ||
+                                  out[i].row != out[j].row);
+                    }
+                    // 按硬降落点落子与 place_piece() 相同，塞进去的落子增量计数与重算一致
+                    struct tetris placed = t;
+                    place_piece_at(&placed, &pieces[piece], out[i].rotation, out[i].col, out[i].row);
+                    if (i < drops) {
+                        struct tetris expected = t;
+                        place_piece(&expected, &pieces[piece], out[i].rotation, out[i].col);
+                        CU_ASSERT_EQUAL(memcmp(&placed, &expected, sizeof(placed)), 0);
+                    } else {
+                        CU_ASSERT_EQUAL(placed.landing_row, out[i].row);
+                        check_placed_counters(&placed);
+                    }
+                }
+            }
+
+            int piece = rng_piece(&rng);
+            int r = (int) (rng_next(&rng) % pieces[piece].count);
+            const struct rotation *rot = &pieces[piece].rotations[r];
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - rot->width + 1));
+            place_piece(&t, &pieces[piece], r, col);
+            if (t.landing_row == -1) {
+                break;
+            }
+        }
+    }
+
+    // 打开 reachable 的搜索给出合法落点
+    init_tetris(&t);
+    t.board[1] |= 3 << COL_SHIFT;
+    bitboard_from_tetris(&b, &t);
+    bitboard_to_tetris(&b, &t);
+    struct move_options options = { 0 };
+    options.reachable = 1;
+    for (int piece = 0; piece < PIECE_TYPES; piece++) {
+        struct placement best = { -1, -1, -1 };
+        select_game_placement(&t, piece, (piece + 1) % PIECE_TYPES, &options, &best);
+        CU_ASSERT(placement_is_legal(&t, piece, &best));
+    }
+}
+
+void test_rollout() {
+    // 随机落子直到局面够高
+    struct tetris t;
+    uint64_t rng = 5;
+    do {
+        init_tetris(&t);
+        while (t.max_height < 13) {
+            int piece = rng_piece(&rng);
+            int r = (int) (rng_next(&rng) % pieces[piece].count);
+            int col = COL_SHIFT + (int) (rng_next(&rng) % (COL - pieces[piece].rotations[r].width + 1));
+            place_piece(&t, &pieces[piece], r, col);
+        }
+    } while (t.landing_row == -1 || t.max_height >= ROW - 2);
+
+    struct rollout_policy policy = { 13, 24, ROLLOUT_DEFAULT_LENGTH, 0, 42, NULL, NULL, 0 };
+    struct placement serial = { -1, -1, -1 }, parallel = { -1, -1, -1 };
+    int rounds;
+    int64_t score = select_best_placement_rollout(&t, 1, 5, &policy, &serial, &rounds);
+    CU_ASSERT(score != INT64_MIN);
+    CU_ASSERT_EQUAL(rounds, 24);
+    CU_ASSERT(serial.rotation >= 0 && serial.rotation < pieces[1].count);
+    CU_ASSERT_EQUAL(serial.row, get_landing_row(&t, &pieces[1].rotations[serial.rotation], serial.col));
+
+    // 固定轮数时结果与线程数无关
+    policy.pool = thread_pool_create(3);
+    CU_ASSERT_EQUAL(select_best_placement_rollout(&t, 1, 5, &policy, &parallel, &rounds), score);
+    CU_ASSERT_EQUAL(rounds, 24);
+    CU_ASSERT_EQUAL(memcmp(&serial, &parallel, sizeof(serial)), 0);
+
+    // 限时且不限轮数时至少完成一轮
+    policy.playouts = 0;
+    policy.budget_us = 2000;
+    CU_ASSERT(select_best_placement_rollout(&t, 1, 5, &policy, &parallel, &rounds) != INT64_MIN);
+    CU_ASSERT(rounds >= 1);
+    thread_pool_destroy(policy.pool);
+
+    // 经 select_game_placement() 在高局面上走推演
+    struct move_options options = { 0 };
+    policy.pool = NULL;
+    policy.playouts = 24;
+    policy.budget_us = 0;
+    options.rollout = &policy;
+    struct placement best = { -1, -1, -1 };
+    CU_ASSERT_EQUAL(select_game_placement(&t, 1, 5, &options, &best), 2);
+    CU_ASSERT_EQUAL(memcmp(&best, &serial, sizeof(best)), 0);
+}
+
+void test_search_reuse() {
+    // 每步先按常规调用（根节点沿用上一步的记录），再对同一局面重搜一次（记录对不上，从头展开），两次结果相同
+    struct thread_pool *pool = thread_pool_create(2);
+    for (int variant = 0; variant < 3; variant++) {
+        struct search_policy policy = SEARCH_POLICY_SAMPLE_SZ;
+        int depth = variant == 0 ? 2 : 3;
+        if (variant == 2) {
+            policy.pool = pool;
+        }
+        struct tetris t;
+        init_tetris(&t);
+        uint64_t rng = 77 + variant;
+        int curr = rng_piece(&rng), next = rng_piece(&rng);
+        for (int step = 0; step < 300; step++) {
+            struct placement reused, fresh;
+            int64_t a = select_best_placement_search(&t, curr, next, depth, &policy, &reused);
+            int64_t b = select_best_placement_search(&t, curr, next, depth, &policy, &fresh);
+            CU_ASSERT_EQUAL(a, b);
+            CU_ASSERT_EQUAL(memcmp(&reused, &fresh, sizeof(reused)), 0);
+            place_piece_at(&t, &pieces[curr], fresh.rotation, fresh.col, fresh.row);
+            if (t.landing_row == -1 || t.max_height >= ROW - 1) {
+                break;
+            }
+            curr = next;
+            next = rng_piece(&rng);
+        }
+    }
+    thread_pool_destroy(pool);
+
+    // 同一地址上换了取值的权重（例如引擎销毁后另一个引擎分配到同一块内存）不能沿用旧权重下的记录
+    struct eval_weights w = EVAL_WEIGHTS_DEFAULT;
+    w.holes += 1;
+    struct search_policy policy = SEARCH_POLICY_SAMPLE_SZ;
+    policy.weights = &w;
+    struct tetris t;
+    init_tetris(&t);
+    uint64_t rng = 5;
+    int curr = rng_piece(&rng), next = rng_piece(&rng), after = rng_piece(&rng);
+    struct placement first, reused, fresh;
+    select_best_placement_search(&t, curr, next, 2, &policy, &first);
+    place_piece_at(&t, &pieces[curr], first.rotation, first.col, first.row);
+    w.holes = -100000;
+    w.landing_height = 100000;
+    int64_t a = select_best_placement_search(&t, next, after, 2, &policy, &reused);
+    forget_search_expansion();
+    int64_t b = select_best_placement_search(&t, next, after, 2, &policy, &fresh);
+    CU_ASSERT_EQUAL(a, b);
+    CU_ASSERT_EQUAL(memcmp(&reused, &fresh, sizeof(reused)), 0);
+}
+
+void test_ponder() {
+    // 后台预先算出的落点与主线程直接搜索的结果相同；取结果时有的已算好，有的要等后台线程先算这一种
+    struct thread_pool *pool = thread_pool_create(2);
+    struct move_options options = { 0 };
+    options.pool = pool;
+    struct ponder *p = ponder_create(&options);
+    CU_ASSERT_PTR_NOT_NULL(p);
+    struct tetris t;
+    init_tetris(&t);
+    uint64_t rng = 31;
+    int curr = rng_piece(&rng);
+    for (int step = 0; step < 200; step++) {
+        int next = rng_piece(&rng);
+        ponder_start(p, &t, curr);
+        CU_ASSERT(ponder_pending(p));
+        struct placement pondered, direct;
+        int depth = ponder_take(p, next, &pondered);
+        CU_ASSERT(!ponder_pending(p));
+        ponder_stop(p);
+        CU_ASSERT_EQUAL(depth, select_game_placement(&t, curr, next, &options, &direct));
+        CU_ASSERT_EQUAL(memcmp(&pondered, &direct, sizeof(direct)), 0);
+        place_piece(&t, &pieces[curr], direct.rotation, direct.col);
+        if (t.landing_row == -1 || t.max_height >= ROW - 1) {
+            break;
+        }
+        curr = next;
+    }
+    long ready, waited;
+    ponder_get_stats(p, &ready, &waited);
+    CU_ASSERT(ready + waited > 0);
+    ponder_destroy(p);
+    thread_pool_destroy(pool);
+}
+
+struct engine_game {
+    uint64_t seed;
+    int steps;
+    struct tetris_engine_state state;
+    int ok;
+};
+
+// 用引擎自己的随机序列下一局，与 play_seeded_game() 的取方块顺序相同
+static void *engine_game_thread(void *arg) {
+    struct engine_game *g = arg;
+    struct tetris_engine *e = tetris_engine_create(NULL);
+    g->ok = e != NULL;
+    if (e == NULL) {
+        return NULL;
+    }
+    tetris_engine_reset(e, g->seed);
+    char curr = tetris_engine_random_piece(e);
+    char next = tetris_engine_random_piece(e);
+    for (int step = 0; step < g->steps; step++) {
+        if (tetris_engine_play(e, curr, next, NULL) != 0) {
+            g->ok = 0;
+            break;
+        }
+        tetris_engine_get_state(e, &g->state);
+        if (g->state.game_over) {
+            break;
+        }
+        curr = next;
+        next = tetris_engine_random_piece(e);
+    }
+    tetris_engine_destroy(e);
+    return NULL;
+}
+
+void test_tetris_engine() {
+    CU_ASSERT_EQUAL(tetris_engine_api_version(), TETRIS_ENGINE_API_VERSION);
+
+    // 几个引擎在不同线程中同时下棋，结果与单线程的 play_seeded_game() 相同
+    enum { GAMES = 4, STEPS = 300 };
+    struct engine_game games[GAMES];
+    pthread_t threads[GAMES];
+    for (int i = 0; i < GAMES; i++) {
+        games[i].seed = rng_game_seed(99, i);
+        games[i].steps = STEPS;
+        CU_ASSERT_EQUAL(pthread_create(&threads[i], NULL, engine_game_thread, &games[i]), 0);
+    }
+    for (int i = 0; i < GAMES; i++) {
+        pthread_join(threads[i], NULL);
+        struct game_result expected;
+        play_seeded_game(games[i].seed, STEPS, NULL, &expected);
+        CU_ASSERT(games[i].ok);
+        CU_ASSERT_EQUAL(games[i].state.pieces, expected.steps);
+        CU_ASSERT_EQUAL(games[i].state.lines, expected.lines);
+        CU_ASSERT_EQUAL(games[i].state.score, expected.score);
+    }
+
+    struct tetris_engine_config config;
+    tetris_engine_config_init(&config);
+    config.level = SEARCH_LEVELS + 1;
+    CU_ASSERT_PTR_NULL(tetris_engine_create(&config));
+    config.level = 2;
+    config.search_threads = 2;
+    struct tetris_engine *e = tetris_engine_create(&config);
+    CU_ASSERT_PTR_NOT_NULL(e);
+    if (e == NULL) {
+        return;
+    }
+    struct tetris_engine_move move;
+    CU_ASSERT_EQUAL(tetris_engine_suggest(e, 'Q', 'I', &move), -1);
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'I', 0, COL - 3, NULL), -1);    // 横放的 I 超出右边界
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'O', 4, 0, NULL), -1);
+    // 下一个方块未知时也能给出落点，suggest 不改变局面
+    CU_ASSERT_EQUAL(tetris_engine_suggest(e, 'T', 0, &move), 0);
+    struct tetris_engine_state state;
+    tetris_engine_get_state(e, &state);
+    CU_ASSERT_EQUAL(state.pieces, 0);
+    // 两个横放的 I 加一个竖放的 O 填满底部两行
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'I', 0, 0, &move), 0);
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'I', 0, 4, &move), 0);
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'I', 0, 0, &move), 0);
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'I', 0, 4, &move), 0);
+    CU_ASSERT_EQUAL(move.lines, 0);
+    CU_ASSERT_EQUAL(tetris_engine_apply(e, 'O', 0, 8, &move), 0);
+    CU_ASSERT_EQUAL(move.lines, 2);
+    tetris_engine_get_state(e, &state);
+    CU_ASSERT_EQUAL(state.lines, 2);
+    CU_ASSERT_EQUAL(state.pieces, 5);
+    CU_ASSERT_EQUAL(state.max_height, 0);
+    tetris_engine_destroy(e);
+}
+
+// 返回 run_server() 返回后 SIGINT 是否仍被屏蔽
+static void *server_thread(void *arg) {
+    run_server(arg);
+    sigset_t mask;
+    pthread_sigmask(SIG_SETMASK, NULL, &mask);
+    return sigismember(&mask, SIGINT) ? arg : NULL;
+}
+
+void test_server() {
+    // 一个连接连下两局，每局的输出与 play_game_pta() 的逐步计算相同
+    const char *pieces_text = "IZ\nT\nSOLJ ZZ\nSIT\nLX";
+    char expected[4096];
+    size_t expected_len = 0;
+    for (int game = 0; game < 2; game++) {
+        struct tetris t;
+        init_tetris(&t);
+        int sequence[16], n = 0, score = 0;
+        for (const char *p = pieces_text; *p; p++) {
+            int piece = piece_decode(PTA_FORMAT_TOKEN, (unsigned char) *p);
+            if (piece >= 0) {
+                sequence[n++] = piece;
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            int rotation, col;
+            if (i + 1 < n) {
+                select_game_move(&t, sequence[i], sequence[i + 1], NULL, &rotation, &col);
+            } else {
+                select_best_move_with_next_beam(&t, sequence[i], 0, &rotation, &col);
+            }
+            place_piece(&t, &pieces[sequence[i]], rotation, col);
+            score += SCORE_TABLE[t.rows_eliminated];
+            expected_len += move_format(expected + expected_len, PTA_FORMAT_TOKEN, 0, &t, rotation, col, score);
+        }
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/test_tetris_%d.sock", (int) getpid());
+    struct serve_options options = { path, 2, PTA_FORMAT_TOKEN, 0, NULL };
+    pthread_t thread;
+    CU_ASSERT_EQUAL(pthread_create(&thread, NULL, server_thread, &options), 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    int fd = -1;
+    for (int attempt = 0; attempt < 200 && fd < 0; attempt++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+            usleep(10000);
+        }
+    }
+    CU_ASSERT(fd >= 0);
+    if (fd >= 0) {
+        for (int game = 0; game < 2; game++) {
+            CU_ASSERT_EQUAL(write(fd, pieces_text, strlen(pieces_text)), (ssize_t) strlen(pieces_text));
+        }
+        shutdown(fd, SHUT_WR);
+        char got[4096];
+        size_t got_len = 0;
+        ssize_t r;
+        while ((r = read(fd, got + got_len, sizeof(got) - got_len)) > 0) {
+            got_len += r;
+        }
+        close(fd);
+        CU_ASSERT_EQUAL(got_len, expected_len);
+        CU_ASSERT_EQUAL(memcmp(got, expected, expected_len), 0);
+    }
+    // 信号经 signalfd 送达，服务端返回后屏蔽字已恢复
+    pthread_kill(thread, SIGINT);
+    void *still_blocked = &still_blocked;
+    pthread_join(thread, &still_blocked);
+    CU_ASSERT(still_blocked == NULL);
+    CU_ASSERT_NOT_EQUAL(access(path, F_OK), 0);
+}
+
 int main() {
     CU_initialize_registry();
     CU_pSuite suite = CU_add_suite("Tetris Test Suite", NULL, NULL);
     CU_add_test(suite, "test_init", test_init);
     CU_add_test(suite, "test_place_piece", test_place_piece);
+    CU_add_test(suite, "test_rng", test_rng);
+    CU_add_test(suite, "test_selfplay_deterministic", test_selfplay_deterministic);
+    CU_add_test(suite, "test_thread_pool", test_thread_pool);
+    CU_add_test(suite, "test_sampleSZ_pool_matches_serial", test_sampleSZ_pool_matches_serial);
+    CU_add_test(suite, "test_ttable", test_ttable);
+    CU_add_test(suite, "test_ttable_search_unchanged", test_ttable_search_unchanged);
+    CU_add_test(suite, "test_search_depth1_is_greedy", test_search_depth1_is_greedy);
+    CU_add_test(suite, "test_search_pruning_exact", test_search_pruning_exact);
+    CU_add_test(suite, "test_search_expectimax_depth4", test_search_expectimax_depth4);
+    CU_add_test(suite, "test_search_anytime", test_search_anytime);
+    CU_add_test(suite, "test_score_placements_simd", test_score_placements_simd);
+    CU_add_test(suite, "test_place_piece_undoable", test_place_piece_undoable);
+    CU_add_test(suite, "test_piece_metadata", test_piece_metadata);
+    CU_add_test(suite, "test_board_features", test_board_features);
+    CU_add_test(suite, "test_eval_weights", test_eval_weights);
+    CU_add_test(suite, "test_place_piece_batch", test_place_piece_batch);
+    CU_add_test(suite, "test_select_top_scores", test_select_top_scores);
+    CU_add_test(suite, "test_ply_beam_search", test_ply_beam_search);
+    CU_add_test(suite, "test_search_profile", test_search_profile);
+    CU_add_test(suite, "test_pta_io", test_pta_io);
+    CU_add_test(suite, "test_game_log", test_game_log);
+    CU_add_test(suite, "test_search_stats", test_search_stats);
+    CU_add_test(suite, "test_bitboard", test_bitboard);
+    CU_add_test(suite, "test_movegen", test_movegen);
+    CU_add_test(suite, "test_rollout", test_rollout);
+    CU_add_test(suite, "test_search_reuse", test_search_reuse);
+    CU_add_test(suite, "test_ponder", test_ponder);
+    CU_add_test(suite, "test_tetris_engine", test_tetris_engine);
+    CU_add_test(suite, "test_server", test_server);
     CU_basic_run_tests();
     CU_cleanup_registry();
     return 0;
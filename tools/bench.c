@@ -0,0 +1,642 @@
+// 微基准测试
+// 在固定的中局局面语料（tools/bench_corpus.txt）上测量 place_piece、place_piece_batch、evaluate_board、
+// evaluate_board_full、evaluate_boards、get_landing_row、score_placements、位棋盘上的对应操作
+// 以及各搜索策略每次调用的耗时；内核允许时通过 perf_event_open
+// 同时统计 cycles / instructions / cache-misses。结果以 JSON 输出，每项一行，便于在提交之间 diff。
+// 每项附带 checksum，搜索策略的选择一旦改变，checksum 也会随之改变。
+//
+// 用法: tetris_bench [-o out.json] [-m ms] [--no-simd] [--board rows|bitboard] [corpus]
+//       tetris_bench --record N [-S seed] > corpus   重新录制语料
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "tetris.h"
+#include "selfplay.h"
+#include "rng.h"
+#include "placement_simd.h"
+#include "bitboard.h"
+#include "movegen.h"
+
+#define DEFAULT_CORPUS "tools/bench_corpus.txt"
+#define MAX_CORPUS     1024
+
+struct bench_board {
+    int curr_piece;
+    int next_piece;
+    struct tetris t;
+};
+
+struct corpus {
+    int count;
+    struct bench_board boards[MAX_CORPUS];
+};
+
+// 语料每行: curr next max_height holes row_transitions col_transitions wells piece landing_row
+//           rotation rows_eliminated col_height[0..11] board[0..19]（十六进制，第 0 行在前）
+// 直接保存增量计数器而不是从棋盘重算，保证与对局中出现的状态逐字节一致
+static int load_corpus(const char *path, struct corpus *c) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    char line[1024];
+    c->count = 0;
+    while (fgets(line, sizeof(line), f) && c->count < MAX_CORPUS) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        struct bench_board *b = &c->boards[c->count];
+        init_tetris(&b->t);
+        long v[11 + COL + 2 * COL_SHIFT];
+        char *p = line, *end;
+        int n = 0;
+        for (; n < (int) (sizeof(v) / sizeof(v[0])); n++, p = end) {
+            v[n] = strtol(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+        }
+        for (int r = 0; r < ROW && n == (int) (sizeof(v) / sizeof(v[0])); r++, p = end) {
+            unsigned long row = strtoul(p, &end, 16);
+            if (end == p) {
+                n = -1;
+                break;
+            }
+            b->t.board[r] = (uint16_t) row;
+        }
+        if (n != (int) (sizeof(v) / sizeof(v[0])) || v[0] < 0 || v[0] >= PIECE_TYPES || v[1] < 0 || v[1] >= PIECE_TYPES) {
+            fprintf(stderr, "语料格式错误: %s", line);
+            fclose(f);
+            return -1;
+        }
+        b->curr_piece = v[0];
+        b->next_piece = v[1];
+        b->t.max_height = v[2];
+        b->t.holes = v[3];
+        b->t.row_transitions = v[4];
+        b->t.col_transitions = v[5];
+        b->t.wells = v[6];
+        b->t.piece = v[7];
+        b->t.landing_row = v[8];
+        b->t.rotation = v[9];
+        b->t.rows_eliminated = v[10];
+        for (int i = 0; i < COL + 2 * COL_SHIFT; i++) {
+            b->t.col_height[i] = v[11 + i];
+        }
+        c->count++;
+    }
+    fclose(f);
+    return c->count > 0 ? 0 : -1;
+}
+
+static void write_board(FILE *out, const struct tetris *t, int curr_piece, int next_piece) {
+    fprintf(out, "%d %d %d %d %d %d %d %d %d %d %d", curr_piece, next_piece, t->max_height, t->holes,
+            t->row_transitions, t->col_transitions, t->wells, t->piece, t->landing_row, t->rotation,
+            t->rows_eliminated);
+    for (int i = 0; i < COL + 2 * COL_SHIFT; i++) {
+        fprintf(out, " %d", t->col_height[i]);
+    }
+    for (int r = 0; r < ROW; r++) {
+        fprintf(out, " %04x", t->board[r]);
+    }
+    fputc('\n', out);
+}
+
+// 用默认策略下种子对局，每隔若干步截取一个局面；每个高度最多取 count/8 个，避免语料全是低局面
+static void record_corpus(int count, uint64_t seed) {
+    int per_height = count / 8 > 0 ? count / 8 : 1;
+    int taken[ROW + 1] = {0};
+    int recorded = 0;
+
+    printf("# tetris bench corpus, seed %llu\n", (unsigned long long) seed);
+    printf("# curr next max_height holes row_transitions col_transitions wells piece landing_row rotation "
+           "rows_eliminated col_height[%d] board[%d]\n", COL + 2 * COL_SHIFT, ROW);
+    for (int g = 0; g < 256 && recorded < count; g++) {
+        struct tetris t;
+        init_tetris(&t);
+        uint64_t rng = rng_game_seed(seed, g);
+        int curr_piece = rng_piece(&rng);
+        int next_piece = rng_piece(&rng);
+        for (int step = 1; step <= MAX_GAME_STEPS && recorded < count; step++) {
+            int best_rotation = 0, best_col = 0;
+            select_game_move(&t, curr_piece, next_piece, NULL, &best_rotation, &best_col);
+            place_piece(&t, &pieces[curr_piece], best_rotation, best_col);
+            if (t.max_height >= 19) {
+                break;
+            }
+            curr_piece = next_piece;
+            next_piece = rng_piece(&rng);
+            if (step % 97 == 0 && taken[t.max_height] < per_height) {
+                taken[t.max_height]++;
+                write_board(stdout, &t, curr_piece, next_piece);
+                recorded++;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 硬件计数器
+
+enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_COUNTERS };
+
+static const char *const perf_names[PERF_COUNTERS] = {"cycles", "instructions", "cache_misses"};
+static const uint64_t perf_configs[PERF_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+};
+
+struct perf_group {
+    int leader;                     // -1 表示不可用（内核不支持、权限不足或在虚拟机中）
+    int fds[PERF_COUNTERS];
+    int slot[PERF_COUNTERS];        // 在组读取结果中的位置，-1 表示该计数器没能打开
+    int opened;
+};
+
+static int perf_open(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void perf_group_open(struct perf_group *g) {
+    g->leader = -1;
+    g->opened = 0;
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        g->fds[i] = perf_open(perf_configs[i], g->leader);
+        g->slot[i] = g->fds[i] >= 0 ? g->opened++ : -1;
+        if (g->leader < 0 && g->fds[i] >= 0) {
+            g->leader = g->fds[i];
+        }
+    }
+}
+
+static void perf_group_close(struct perf_group *g) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (g->fds[i] >= 0) {
+            close(g->fds[i]);
+        }
+    }
+}
+
+static void perf_group_start(struct perf_group *g) {
+    if (g->leader >= 0) {
+        ioctl(g->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(g->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+// 读出本组计数，不可用的计数器记为 -1
+static void perf_group_stop(struct perf_group *g, int64_t *values) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        values[i] = -1;
+    }
+    if (g->leader < 0) {
+        return;
+    }
+    ioctl(g->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t buf[1 + PERF_COUNTERS];
+    if (read(g->leader, buf, sizeof(buf)) < (ssize_t) sizeof(uint64_t)) {
+        return;
+    }
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (g->slot[i] >= 0 && (uint64_t) g->slot[i] < buf[0]) {
+            values[i] = (int64_t) buf[1 + g->slot[i]];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 各测量项：每项在整份语料上跑一遍，返回调用次数，checksum 累加结果防止被优化掉
+
+static long bench_place_piece(const struct corpus *c, uint64_t *checksum) {
+    long calls = 0;
+    for (int i = 0; i < c->count; i++) {
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            for (int j = 0; j < pieces[p].count; j++) {
+                const struct rotation *rot = &pieces[p].rotations[j];
+                for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                    struct tetris t = c->boards[i].t;   // 计时包含这次 64 字节的复制
+                    place_piece(&t, &pieces[p], j, col);
+                    *checksum = *checksum * 31 + (uint8_t) t.max_height + (uint8_t) t.holes;
+                    calls++;
+                }
+            }
+        }
+    }
+    return calls;
+}
+
+static long bench_evaluate_board(const struct corpus *c, uint64_t *checksum) {
+    for (int i = 0; i < c->count; i++) {
+        *checksum = *checksum * 31 + (uint64_t) evaluate_board(&c->boards[i].t, NULL);
+    }
+    return c->count;
+}
+
+static long bench_evaluate_board_full(const struct corpus *c, uint64_t *checksum) {
+    for (int i = 0; i < c->count; i++) {
+        *checksum = *checksum * 31 + (uint64_t) evaluate_board_full(&c->boards[i].t, NULL);
+    }
+    return c->count;
+}
+
+// 每个局面对 7 种方块各展开一整层，按落点数计次，与 place_piece 一项可比
+static long bench_place_piece_batch(const struct corpus *c, uint64_t *checksum) {
+    long calls = 0;
+    struct board_batch batch;
+    for (int i = 0; i < c->count; i++) {
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            int n = place_piece_batch(&c->boards[i].t, p, &batch);
+            for (int k = 0; k < n; k++) {
+                *checksum = *checksum * 31 + (uint8_t) batch.max_height[k] + (uint8_t) batch.holes[k];
+            }
+            calls += n;
+        }
+    }
+    return calls;
+}
+
+static long bench_evaluate_boards(const struct corpus *c, uint64_t *checksum) {
+    struct tetris boards[MAX_CORPUS];
+    int64_t scores[MAX_CORPUS];
+    for (int i = 0; i < c->count; i++) {
+        boards[i] = c->boards[i].t;
+    }
+    evaluate_boards(boards, c->count, NULL, scores);
+    for (int i = 0; i < c->count; i++) {
+        *checksum = *checksum * 31 + (uint64_t) scores[i];
+    }
+    return c->count;
+}
+
+static long bench_get_landing_row(const struct corpus *c, uint64_t *checksum) {
+    long calls = 0;
+    for (int i = 0; i < c->count; i++) {
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            for (int j = 0; j < pieces[p].count; j++) {
+                const struct rotation *rot = &pieces[p].rotations[j];
+                for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                    *checksum = *checksum * 31 + get_landing_row(&c->boards[i].t, rot, col);
+                    calls++;
+                }
+            }
+        }
+    }
+    return calls;
+}
+
+// 以下几项与上面行布局的 place_piece、get_landing_row、evaluate_board_full 逐项对应
+static long bench_bitboard_place(const struct corpus *c, uint64_t *checksum) {
+    long calls = 0;
+    for (int i = 0; i < c->count; i++) {
+        struct bitboard board;
+        bitboard_from_tetris(&board, &c->boards[i].t);
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            for (int j = 0; j < pieces[p].count; j++) {
+                const struct rotation *rot = &pieces[p].rotations[j];
+                for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                    struct bitboard b = board;
+                    int rows_eliminated;
+                    int row = bitboard_place(&b, rot, col, &rows_eliminated);
+                    *checksum = *checksum * 31 + (uint8_t) row + (uint8_t) rows_eliminated + (uint8_t) b.w[0];
+                    calls++;
+                }
+            }
+        }
+    }
+    return calls;
+}
+
+static long bench_bitboard_landing_row(const struct corpus *c, uint64_t *checksum) {
+    long calls = 0;
+    for (int i = 0; i < c->count; i++) {
+        struct bitboard board;
+        bitboard_from_tetris(&board, &c->boards[i].t);
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            for (int j = 0; j < pieces[p].count; j++) {
+                const struct rotation *rot = &pieces[p].rotations[j];
+                for (int col = COL_SHIFT; col <= COL_SHIFT + COL - rot->width; col++) {
+                    *checksum = *checksum * 31 + bitboard_landing_row(&board, rot, col);
+                    calls++;
+                }
+            }
+        }
+    }
+    return calls;
+}
+
+// 语料事先转换好，只计特征本身
+static long bench_bitboard_features(const struct corpus *c, uint64_t *checksum) {
+    static struct bitboard boards[MAX_CORPUS];
+    static const struct corpus *converted = NULL;
+    if (converted != c) {
+        for (int i = 0; i < c->count; i++) {
+            bitboard_from_tetris(&boards[i], &c->boards[i].t);
+        }
+        converted = c;
+    }
+    for (int i = 0; i < c->count; i++) {
+        struct board_features f;
+        bitboard_features(&boards[i], &f);
+        *checksum = *checksum * 31 + (uint8_t) f.holes + (uint8_t) f.row_transitions * 7 + (uint8_t) f.wells * 13;
+    }
+    return c->count;
+}
+
+// 每个局面对 7 种方块的全部旋转调用 score_placements，按落点数计次
+static long score_all_placements(const struct corpus *c, uint64_t *checksum) {
+    long calls = 0;
+    for (int i = 0; i < c->count; i++) {
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            for (int j = 0; j < pieces[p].count; j++) {
+                int64_t scores[COL];
+                int n = score_placements(&c->boards[i].t, NULL, p, j, scores);
+                for (int k = 0; k < n; k++) {
+                    *checksum = *checksum * 31 + (uint64_t) scores[k];
+                }
+                calls += n;
+            }
+        }
+    }
+    return calls;
+}
+
+static long bench_score_placements_rows(const struct corpus *c, uint64_t *checksum) {
+    enum board_backend backend = get_board_backend();
+    set_board_backend(BOARD_BACKEND_ROWS);
+    long calls = score_all_placements(c, checksum);
+    set_board_backend(backend);
+    return calls;
+}
+
+static long bench_score_placements_bitboard(const struct corpus *c, uint64_t *checksum) {
+    enum board_backend backend = get_board_backend();
+    set_board_backend(BOARD_BACKEND_BITBOARD);
+    long calls = score_all_placements(c, checksum);
+    set_board_backend(backend);
+    return calls;
+}
+
+// 每次调用生成一个方块在一个局面上的全部可到达落点
+static long bench_generate_placements(const struct corpus *c, uint64_t *checksum) {
+    struct placement out[MAX_REACHABLE_PLACEMENTS];
+    for (int i = 0; i < c->count; i++) {
+        for (int p = 0; p < PIECE_TYPES; p++) {
+            int n = generate_placements(&c->boards[i].t, p, out);
+            *checksum = *checksum * 31 + (uint64_t) n;
+            if (n > 0) {
+                *checksum = *checksum * 31 + (uint64_t) out[n - 1].row;
+            }
+        }
+    }
+    return (long) c->count * PIECE_TYPES;
+}
+
+static void mix_move(uint64_t *checksum, int rotation, int col) {
+    *checksum = *checksum * 31 + (uint64_t) (rotation * 16 + col);
+}
+
+static long bench_select_best_move(const struct corpus *c, uint64_t *checksum) {
+    for (int i = 0; i < c->count; i++) {
+        struct tetris t = c->boards[i].t;
+        int rotation = 0, col = 0;
+        select_best_move(&t, c->boards[i].curr_piece, &rotation, &col);
+        mix_move(checksum, rotation, col);
+    }
+    return c->count;
+}
+
+static long bench_with_next(const struct corpus *c, uint64_t *checksum) {
+    for (int i = 0; i < c->count; i++) {
+        struct tetris t = c->boards[i].t;
+        int rotation = 0, col = 0;
+        select_best_move_with_next(&t, c->boards[i].curr_piece, c->boards[i].next_piece, &rotation, &col);
+        mix_move(checksum, rotation, col);
+    }
+    return c->count;
+}
+
+static long bench_with_next_beam(const struct corpus *c, uint64_t *checksum) {
+    for (int i = 0; i < c->count; i++) {
+        struct tetris t = c->boards[i].t;
+        int rotation = 0, col = 0;
+        select_best_move_with_next_beam(&t, c->boards[i].curr_piece, c->boards[i].next_piece, &rotation, &col);
+        mix_move(checksum, rotation, col);
+    }
+    return c->count;
+}
+
+static long bench_with_next_beam_sampleSZ(const struct corpus *c, uint64_t *checksum) {
+    for (int i = 0; i < c->count; i++) {
+        struct tetris t = c->boards[i].t;
+        int rotation = 0, col = 0;
+        select_best_move_with_next_beam_sampleSZ(&t, c->boards[i].curr_piece, c->boards[i].next_piece,
+                                                 &rotation, &col);
+        mix_move(checksum, rotation, col);
+    }
+    return c->count;
+}
+
+// 高局面策略改用宽度 128 的整层 beam
+static long bench_ply_beam_128(const struct corpus *c, uint64_t *checksum) {
+    struct search_policy policy = SEARCH_POLICY_SAMPLE_SZ;
+    policy.ply_beam_width = 128;
+    for (int i = 0; i < c->count; i++) {
+        struct tetris t = c->boards[i].t;
+        int rotation = 0, col = 0;
+        select_best_move_search(&t, c->boards[i].curr_piece, c->boards[i].next_piece, 3, &policy, &rotation, &col);
+        mix_move(checksum, rotation, col);
+    }
+    return c->count;
+}
+
+struct bench_case {
+    const char *name;
+    long (*run)(const struct corpus *c, uint64_t *checksum);
+};
+
+static const struct bench_case bench_cases[] = {
+    {"place_piece", bench_place_piece},
+    {"place_piece_batch", bench_place_piece_batch},
+    {"evaluate_board", bench_evaluate_board},
+    {"evaluate_board_full", bench_evaluate_board_full},
+    {"evaluate_boards", bench_evaluate_boards},
+    {"get_landing_row", bench_get_landing_row},
+    {"bitboard_place", bench_bitboard_place},
+    {"bitboard_landing_row", bench_bitboard_landing_row},
+    {"bitboard_features", bench_bitboard_features},
+    {"score_placements", bench_score_placements_rows},
+    {"score_placements_bitboard", bench_score_placements_bitboard},
+    {"generate_placements", bench_generate_placements},
+    {"select_best_move", bench_select_best_move},
+    {"select_best_move_with_next", bench_with_next},
+    {"select_best_move_with_next_beam", bench_with_next_beam},
+    {"select_best_move_with_next_beam_sampleSZ", bench_with_next_beam_sampleSZ},
+    {"select_best_move_ply_beam_128", bench_ply_beam_128},
+};
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 先预热一遍，然后整遍重复语料直到累计至少 min_ms 毫秒
+static void run_case(FILE *out, const struct bench_case *bc, const struct corpus *c, struct perf_group *perf,
+                     int min_ms, int last) {
+    uint64_t checksum = 0;
+    bc->run(c, &checksum);
+
+    long calls = 0;
+    int passes = 0;
+    int64_t counters[PERF_COUNTERS];
+    // 计时窗口只包住被测调用，perf 的 ioctl 落在窗口之外
+    perf_group_start(perf);
+    int64_t start = monotonic_ns(), elapsed;
+    do {
+        checksum = 0;
+        calls += bc->run(c, &checksum);
+        passes++;
+        elapsed = monotonic_ns() - start;
+    } while (elapsed < (int64_t) min_ms * 1000000);
+    perf_group_stop(perf, counters);
+
+    fprintf(out, "    {\"name\": \"%s\", \"calls\": %ld, \"passes\": %d, \"ns_per_call\": %.2f",
+            bc->name, calls, passes, (double) elapsed / calls);
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (counters[i] >= 0) {
+            fprintf(out, ", \"%s_per_call\": %.2f", perf_names[i], (double) counters[i] / calls);
+        } else {
+            fprintf(out, ", \"%s_per_call\": null", perf_names[i]);
+        }
+    }
+    fprintf(out, ", \"checksum\": \"%016llx\"}%s\n", (unsigned long long) checksum, last ? "" : ",");
+    fflush(out);
+}
+
+static void print_usage(const char *prog) {
+    printf("用法: %s [选项] [语料文件]\n", prog);
+    printf("选项:\n");
+    printf("  -h, --help           显示帮助信息\n");
+    printf("  -o, --output FILE    JSON 结果写入 FILE（默认标准输出）\n");
+    printf("  -m, --min-ms MS      每项至少测量 MS 毫秒（默认 300）\n");
+    printf("      --no-simd        关闭 AVX2 落点内核，测量标量路径\n");
+    printf("      --board B        搜索各项使用的棋盘表示：rows（默认）或 bitboard\n");
+    printf("  -r, --record N       用种子对局重新录制 N 个局面的语料并输出到标准输出\n");
+    printf("  -S, --seed S         录制语料时使用的种子（默认 1）\n");
+    printf("语料文件默认为 %s\n", DEFAULT_CORPUS);
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"help",    no_argument,       0, 'h'},
+        {"output",  required_argument, 0, 'o'},
+        {"min-ms",  required_argument, 0, 'm'},
+        {"no-simd", no_argument,       0, 'N'},
+        {"board",   required_argument, 0, 'B'},
+        {"record",  required_argument, 0, 'r'},
+        {"seed",    required_argument, 0, 'S'},
+        {0, 0, 0, 0}
+    };
+    const char *output = NULL;
+    int min_ms = 300;
+    int simd = 1;
+    enum board_backend backend = BOARD_BACKEND_ROWS;
+    int record = 0;
+    uint64_t seed = 1;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ho:m:r:S:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h': print_usage(argv[0]); return 0;
+            case 'o': output = optarg; break;
+            case 'm': min_ms = atoi(optarg); break;
+            case 'N': simd = 0; break;
+            case 'B':
+                if (strcmp(optarg, "rows") == 0) {
+                    backend = BOARD_BACKEND_ROWS;
+                } else if (strcmp(optarg, "bitboard") == 0) {
+                    backend = BOARD_BACKEND_BITBOARD;
+                } else {
+                    fprintf(stderr, "未知的棋盘表示 %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r': record = atoi(optarg); break;
+            case 'S': seed = strtoull(optarg, NULL, 0); break;
+            default: print_usage(argv[0]); return 1;
+        }
+    }
+
+    if (record > 0) {
+        if (record > MAX_CORPUS) {
+            fprintf(stderr, "语料最多 %d 个局面\n", MAX_CORPUS);
+            return 1;
+        }
+        record_corpus(record, seed);
+        return 0;
+    }
+    if (min_ms < 1) {
+        fprintf(stderr, "最短测量时间必须为正整数\n");
+        return 1;
+    }
+
+    const char *path = optind < argc ? argv[optind] : DEFAULT_CORPUS;
+    static struct corpus corpus;
+    if (load_corpus(path, &corpus) != 0) {
+        fprintf(stderr, "无法读取语料 %s\n", path);
+        return 1;
+    }
+    set_placement_simd(simd);
+    set_board_backend(backend);
+
+    FILE *out = stdout;
+    if (output && (out = fopen(output, "w")) == NULL) {
+        perror(output);
+        return 1;
+    }
+
+    struct perf_group perf;
+    perf_group_open(&perf);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"corpus\": \"%s\",\n", path);
+    fprintf(out, "  \"boards\": %d,\n", corpus.count);
+    fprintf(out, "  \"simd\": %s,\n", simd && placement_simd_supported() ? "true" : "false");
+    fprintf(out, "  \"board\": \"%s\",\n", backend == BOARD_BACKEND_BITBOARD ? "bitboard" : "rows");
+    fprintf(out, "  \"pext\": %s,\n", bitboard_pext_supported() ? "true" : "false");
+    fprintf(out, "  \"perf_events\": %s,\n", perf.leader >= 0 ? "true" : "false");
+    fprintf(out, "  \"results\": [\n");
+    int cases = sizeof(bench_cases) / sizeof(bench_cases[0]);
+    // 不计时地把各项都跑一遍、开关一次计数器，免得第一项替进程启动时的缺页和降频买单
+    int64_t counters[PERF_COUNTERS];
+    perf_group_start(&perf);
+    for (int i = 0; i < cases; i++) {
+        uint64_t checksum = 0;
+        bench_cases[i].run(&corpus, &checksum);
+    }
+    perf_group_stop(&perf, counters);
+    for (int i = 0; i < cases; i++) {
+        run_case(out, &bench_cases[i], &corpus, &perf, min_ms, i == cases - 1);
+    }
+    fprintf(out, "  ]\n}\n");
+
+    perf_group_close(&perf);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
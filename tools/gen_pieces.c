@@ -0,0 +1,290 @@
+// 方块旋转元数据生成器
+// 由 makefile 编译运行，把下面的形状定义展开成 src/pieces_table.h 中的 static const 表：
+// 每行的 hstart/hend/hspan 与每列的 vstart/vend/vspan。
+// 运行时不再需要 init_pieces()，pieces 只读，可以在线程间共享。
+
+#include <stdio.h>
+#include <stdint.h>
+#include "tetris.h"
+
+struct shape_rotation {
+    int width;
+    int height;
+    uint16_t shape[MAX_BRICK_WIDTH];
+};
+
+struct shape_def {
+    int count;
+    struct shape_rotation rotations[MAX_ROTATIONS];
+};
+
+static const char names[PIECE_TYPES] = {'I', 'T', 'O', 'J', 'L', 'S', 'Z'};
+
+// 俄罗斯方块形状定义（唯一的数据来源）
+static const struct shape_def shapes[PIECE_TYPES] = {
+    // I
+    {
+        2,  // rotation count
+        {
+            {
+                4,  // width
+                1,  // height
+                { 0b1111 }  // shape
+            },
+            {
+                1,  // width
+                4,  // height
+                { 0b1,
+                  0b1,
+                  0b1,
+                  0b1
+                }
+            }
+        }
+    },
+
+    // T
+    {
+        4,  // rotation count
+        {
+            {
+                3,  // width
+                2,  // height
+                { 0b111,
+                  0b010
+                }
+            },
+            {
+                2,  // width
+                3,  // height
+                { 0b01,
+                  0b11,
+                  0b01
+                }
+            },
+            {
+                3,  // width
+                2,  // height
+                { 0b010,
+                  0b111
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b10,
+                  0b11,
+                  0b10
+                }
+            }
+        }
+    },
+
+    // O
+    {
+        1,  // rotation count
+        {
+            {
+                2,  // width
+                2,  // height
+                { 0b11,
+                  0b11
+                }
+            }
+        }
+    },
+
+    // J
+    {
+        4,  // rotation count
+        {
+            {
+                3,  // width
+                2,  // height
+                { 0b111,
+                  0b001
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b01,
+                  0b01,
+                  0b11
+                }
+            },
+            {
+                3,   // width
+                2,   // height
+                { 0b100,
+                  0b111
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b11,
+                  0b10,
+                  0b10
+                }
+            }
+        }
+    },
+
+    // L
+    {
+        4,  // rotation count
+        {
+            {
+                3,  // width
+                2,  // height
+                { 0b111,
+                  0b100
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b11,
+                  0b01,
+                  0b01
+                }
+            },
+            {
+                3,   // width
+                2,   // height
+                { 0b001,
+                  0b111
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b10,
+                  0b10,
+                  0b11
+                }
+            }
+        }
+    },
+
+    // S
+    {
+        2,  // rotation count
+        {
+            {
+                3,  // width
+                2,  // height
+                { 0b011,
+                  0b110
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b10,
+                  0b11,
+                  0b01
+                }
+            }
+        }
+    },
+
+    // Z
+    {
+        2,  // rotation count
+        {
+            {
+                3,  // width
+                2,  // height
+                { 0b110,
+                  0b011
+                }
+            },
+            {
+                2,   // width
+                3,   // height
+                { 0b01,
+                  0b11,
+                  0b10
+                }
+            }
+        }
+    }
+};
+
+static void print_array(const char *name, const int *values, int n) {
+    printf("                .%s = {", name);
+    for (int i = 0; i < n; i++) {
+        printf("%s%d", i ? ", " : " ", values[i]);
+    }
+    printf(" },\n");
+}
+
+static void emit_rotation(const struct shape_rotation *src) {
+    int hstart[MAX_BRICK_WIDTH] = {0}, hend[MAX_BRICK_WIDTH] = {0}, hspan[MAX_BRICK_WIDTH] = {0};
+    int vstart[MAX_BRICK_WIDTH] = {0}, vend[MAX_BRICK_WIDTH] = {0}, vspan[MAX_BRICK_WIDTH] = {0};
+
+    // 每行：第一个方格的位置和连续方格的长度
+    for (int k = 0; k < src->height; k++) {
+        uint16_t s = src->shape[k];
+        while ((s & 1) == 0) {
+            hstart[k]++;
+            s >>= 1;
+        }
+        hend[k] = hstart[k];
+        while ((s & 1) == 1) {
+            hend[k]++;
+            s >>= 1;
+        }
+        hspan[k] = hend[k] - hstart[k];
+    }
+
+    // 每列：最低方格所在的行和连续方格的长度
+    for (int k = 0; k < src->width; k++) {
+        int v = 0;
+        while ((src->shape[v] & (1 << k)) == 0) {
+            v++;
+        }
+        vstart[k] = v;
+        while (v < src->height && (src->shape[v] & (1 << k)) != 0) {
+            v++;
+        }
+        vend[k] = v;
+        vspan[k] = vend[k] - vstart[k];
+    }
+
+    printf("            {\n");
+    printf("                .shape = {");
+    for (int k = 0; k < MAX_BRICK_WIDTH; k++) {
+        printf("%s0x%x", k ? ", " : " ", src->shape[k]);
+    }
+    printf(" },\n");
+    printf("                .width = %d,\n", src->width);
+    printf("                .height = %d,\n", src->height);
+    print_array("hstart", hstart, MAX_BRICK_WIDTH);
+    print_array("hend", hend, MAX_BRICK_WIDTH);
+    print_array("hspan", hspan, MAX_BRICK_WIDTH);
+    print_array("vstart", vstart, MAX_BRICK_WIDTH);
+    print_array("vend", vend, MAX_BRICK_WIDTH);
+    print_array("vspan", vspan, MAX_BRICK_WIDTH);
+    printf("            },\n");
+}
+
+int main(void) {
+    printf("// 由 tools/gen_pieces.c 自动生成，请勿手工修改\n\n");
+    printf("const struct piece pieces[PIECE_TYPES] = {\n");
+    for (int i = 0; i < PIECE_TYPES; i++) {
+        printf("    // %c\n", names[i]);
+        printf("    {\n");
+        printf("        .count = %d,\n", shapes[i].count);
+        printf("        .rotations = {\n");
+        for (int j = 0; j < shapes[i].count; j++) {
+            emit_rotation(&shapes[i].rotations[j]);
+        }
+        printf("        }\n");
+        printf("    },\n");
+    }
+    printf("};\n");
+    return 0;
+}
@@ -0,0 +1,47 @@
+// 行特征查找表生成器
+// 由 makefile 编译运行，生成 src/row_lut_table.h，两张表都以一行中间 COL 位（去掉两侧填充）为下标：
+// row_popcount_lut 为其中的方块数（不依赖 CPU 的 popcnt 指令）；
+// row_feature_lut 低 4 位为该行对行转换数的贡献，高 4 位为该行中的井格数，与 place_piece() 的增量计数口径一致：
+//   行转换：不与墙相连的方块段数，即空白段数减一（满行与空行为 0）
+//   井格：左右两侧都是方块（或墙）的空格
+
+#include <stdio.h>
+#include "tetris.h"
+
+static int filled(int row, int col) {
+    return (row >> col) & 1;
+}
+
+int main(void) {
+    printf("// 由 tools/gen_row_lut.c 自动生成，请勿手工修改\n\n");
+    printf("const uint8_t row_feature_lut[1 << COL] = {\n");
+    for (int m = 0; m < (1 << COL); m++) {
+        int row = EMPTY_ROW | (m << COL_SHIFT);
+        int runs = 0, wells = 0;
+        for (int c = COL_SHIFT; c < COL_SHIFT + COL; c++) {
+            if (filled(row, c)) {
+                continue;
+            }
+            if (filled(row, c - 1)) {
+                runs++;
+                if (filled(row, c + 1)) {
+                    wells++;
+                }
+            }
+        }
+        int transitions = runs > 0 ? runs - 1 : 0;
+        printf("%s0x%02x,%s", m % 16 == 0 ? "    " : "", wells << 4 | transitions, m % 16 == 15 ? "\n" : " ");
+    }
+    printf("};\n\n");
+
+    printf("const uint8_t row_popcount_lut[1 << COL] = {\n");
+    for (int m = 0; m < (1 << COL); m++) {
+        int count = 0;
+        for (int c = 0; c < COL; c++) {
+            count += (m >> c) & 1;
+        }
+        printf("%s%d,%s", m % 16 == 0 ? "    " : "", count, m % 16 == 15 ? "\n" : " ");
+    }
+    printf("};\n");
+    return 0;
+}
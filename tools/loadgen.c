@@ -0,0 +1,247 @@
+// tetris --serve 的压力测试
+// 同时打开若干个连接，每个连接按自己的种子生成方块序列下一局：先发两个方块，之后每收到一步回答
+// 再发下一个方块，下满指定步数后发 X 结束。测量每一步从发出方块到收齐回答的延迟，
+// 最后输出吞吐量（步/秒）和延迟分布。服务端须用 --no-board 启动，格式与 -f 一致（默认 token）。
+//
+// 用法: tetris_loadgen -s /path.sock [-c 连接数] [-m 每局步数] [-S seed] [-f text|token]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "tetris.h"
+#include "rng.h"
+
+#define MAX_EVENTS 256
+#define LINE_BUF   256
+
+struct connection {
+    int fd;
+    uint64_t rng;
+    int moves;                   // 已收到回答的步数
+    int finishing;               // 已发出 X
+    int lines;                   // 当前这一步已收到的行数
+    int64_t sent_ns;
+    size_t len;
+    char buf[LINE_BUF];
+};
+
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int connect_to(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    // 阻塞地连接，服务端的等待队列满时在这里等它接受
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 发出下一个方块，下满步数后发 X
+static int send_next(struct connection *c, int moves_per_game) {
+    char text[4];
+    size_t len = 0;
+    if (c->moves == 0) {
+        text[len++] = get_piece_name(rng_piece(&c->rng));
+        text[len++] = get_piece_name(rng_piece(&c->rng));
+    } else if (c->moves < moves_per_game) {
+        text[len++] = get_piece_name(rng_piece(&c->rng));
+    } else {
+        text[len++] = 'X';
+        c->finishing = 1;
+    }
+    text[len++] = '\n';
+    c->sent_ns = monotonic_ns();
+    return send_all(c->fd, text, len);
+}
+
+static void print_usage(const char *prog) {
+    printf("用法: %s -s 套接字 [选项]\n", prog);
+    printf("选项:\n");
+    printf("  -h, --help              显示帮助信息\n");
+    printf("  -s, --socket PATH       tetris --serve 监听的套接字\n");
+    printf("  -c, --connections N     同时进行的对局数（默认 100）\n");
+    printf("  -m, --moves N           每局的步数（默认 1000），最后还有 X 之后的一步\n");
+    printf("  -S, --seed S            方块序列的种子（默认 1），第 i 个连接用 rng_game_seed(S, i)\n");
+    printf("  -f, --format F          服务端的输出格式 token（默认）或 text，服务端须用 --no-board\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"help",        no_argument,       0, 'h'},
+        {"socket",      required_argument, 0, 's'},
+        {"connections", required_argument, 0, 'c'},
+        {"moves",       required_argument, 0, 'm'},
+        {"seed",        required_argument, 0, 'S'},
+        {"format",      required_argument, 0, 'f'},
+        {0, 0, 0, 0}
+    };
+    const char *path = NULL;
+    int connections = 100;
+    int moves_per_game = 1000;
+    uint64_t seed = 1;
+    int lines_per_move = 1;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hs:c:m:S:f:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h': print_usage(argv[0]); return 0;
+            case 's': path = optarg; break;
+            case 'c': connections = atoi(optarg); break;
+            case 'm': moves_per_game = atoi(optarg); break;
+            case 'S': seed = strtoull(optarg, NULL, 0); break;
+            case 'f':
+                if (strcmp(optarg, "token") == 0) {
+                    lines_per_move = 1;
+                } else if (strcmp(optarg, "text") == 0) {
+                    lines_per_move = 2;
+                } else {
+                    fprintf(stderr, "未知的格式 %s\n", optarg);
+                    return 1;
+                }
+                break;
+            default: print_usage(argv[0]); return 1;
+        }
+    }
+    if (path == NULL || connections < 1 || moves_per_game < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    size_t capacity = (size_t) connections * (moves_per_game + 1);
+    struct connection *conns = calloc(connections, sizeof(struct connection));
+    int64_t *latency = malloc(sizeof(int64_t) * capacity);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (conns == NULL || latency == NULL || epoll_fd < 0) {
+        perror("loadgen");
+        return 1;
+    }
+    for (int i = 0; i < connections; i++) {
+        struct connection *c = &conns[i];
+        c->fd = connect_to(path);
+        if (c->fd < 0) {
+            fprintf(stderr, "第 %d 个连接失败: %s\n", i, strerror(errno));
+            return 1;
+        }
+        c->rng = rng_game_seed(seed, i);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+    }
+
+    int64_t start = monotonic_ns();
+    for (int i = 0; i < connections; i++) {
+        if (send_next(&conns[i], moves_per_game) != 0) {
+            perror("send");
+            return 1;
+        }
+    }
+    size_t recorded = 0;
+    int remaining = connections;
+    struct epoll_event events[MAX_EVENTS];
+    while (remaining > 0) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            return 1;
+        }
+        for (int e = 0; e < n; e++) {
+            struct connection *c = events[e].data.ptr;
+            ssize_t got = read(c->fd, c->buf + c->len, LINE_BUF - c->len);
+            if (got <= 0) {
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                fprintf(stderr, "连接在第 %d 步意外关闭\n", c->moves);
+                return 1;
+            }
+            c->len += got;
+            // 按行处理，凑齐一步的行数即为一步的回答
+            char *line = c->buf, *end;
+            while ((end = memchr(line, '\n', c->buf + c->len - line)) != NULL) {
+                int rotation, col;
+                if (c->lines == 0 && sscanf(line, "%d %d", &rotation, &col) != 2) {
+                    fprintf(stderr, "无法解析回答（服务端须用 --no-board，格式与 -f 一致）: %.*s\n",
+                            (int) (end - line), line);
+                    return 1;
+                }
+                line = end + 1;
+                if (++c->lines < lines_per_move) {
+                    continue;
+                }
+                c->lines = 0;
+                latency[recorded++] = monotonic_ns() - c->sent_ns;
+                if (c->finishing) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+                    close(c->fd);
+                    c->fd = -1;
+                    remaining--;
+                    break;
+                }
+                c->moves++;
+                if (send_next(c, moves_per_game) != 0) {
+                    perror("send");
+                    return 1;
+                }
+            }
+            c->len = c->buf + c->len - line;
+            memmove(c->buf, line, c->len);
+        }
+    }
+    double elapsed = (monotonic_ns() - start) / 1e9;
+
+    qsort(latency, recorded, sizeof(int64_t), compare_int64);
+    double sum = 0;
+    for (size_t i = 0; i < recorded; i++) {
+        sum += latency[i];
+    }
+    printf("Connections: %d, Moves: %zu, Elapsed: %.2f s\n", connections, recorded, elapsed);
+    printf("Throughput: %.0f moves/s\n", recorded / elapsed);
+    printf("Latency (us): mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+           sum / recorded / 1e3, latency[recorded / 2] / 1e3, latency[recorded * 9 / 10] / 1e3,
+           latency[recorded * 99 / 100] / 1e3, latency[recorded - 1] / 1e3);
+    free(latency);
+    free(conns);
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,182 @@
+// 对局记录回放工具
+// 只用 place_piece() 按记录重新模拟一局，核对方块序列与种子、每步得分以及结束标记；
+// 加 --check 时在每一步用当前编译的搜索重新选择落点，报告第一处与记录不同的决策及当时的棋盘，
+// 用于判断一次修改是否改变了引擎的行为。需要用与记录时相同的 --weights / --profile 运行。
+//
+// 用法: tetris_replay [--check] [-W weights] [--profile FILE] game.log
+// 退出码：0 回放一致，1 有决策不同，2 记录文件损坏或与种子、得分不符
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+#include "tetris.h"
+#include "selfplay.h"
+#include "rng.h"
+#include "weights.h"
+#include "game_log.h"
+#include "print_utils.h"
+
+static void print_usage(const char *prog) {
+    printf("用法: %s [选项] game.log\n", prog);
+    printf("  -c, --check          每一步用当前的搜索重新选择落点，报告第一处不同的决策\n");
+    printf("  -W, --weights FILE   记录时使用的评估权重\n");
+    printf("      --profile FILE   记录时使用的搜索配置（记录中的等级为 0 时必须给出）\n");
+}
+
+static double elapsed_since(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int check = 0;
+    struct eval_weights weights;
+    struct search_profile profile;
+    struct move_options options = {0};
+    static struct option long_options[] = {
+        {"help",    no_argument,       0, 'h'},
+        {"check",   no_argument,       0, 'c'},
+        {"weights", required_argument, 0, 'W'},
+        {"profile", required_argument, 0, 'F'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hcW:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h': print_usage(argv[0]); return 0;
+            case 'c': check = 1; break;
+            case 'W':
+                if (load_eval_weights(optarg, &weights) != 0) {
+                    return 2;
+                }
+                options.weights = &weights;
+                break;
+            case 'F':
+                if (load_search_profile(optarg, &profile) != 0) {
+                    return 2;
+                }
+                options.profile = &profile;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    struct game_log log;
+    if (game_log_open(&log, argv[optind]) != 0) {
+        return 2;
+    }
+    if (options.profile == NULL) {
+        if (log.header.level < 1 || log.header.level > SEARCH_LEVELS) {
+            fprintf(stderr, "记录使用了自定义搜索配置，请用 --profile 给出\n");
+            game_log_close(&log);
+            return 2;
+        }
+        options.profile = &SEARCH_PROFILES[log.header.level - 1];
+    }
+    options.beam_width = log.header.beam_width;
+
+    // 先读入全部步骤，--check 需要知道每一步的下一个方块
+    int capacity = 1024, count = 0, ret;
+    struct game_log_move *moves = malloc(sizeof(struct game_log_move) * capacity);
+    struct game_log_move move;
+    while (moves && (ret = game_log_read_move(&log, &move)) == 1) {
+        if (count == capacity) {
+            capacity *= 2;
+            struct game_log_move *grown = realloc(moves, sizeof(struct game_log_move) * capacity);
+            if (grown == NULL) {
+                free(moves);
+                moves = NULL;
+                break;
+            }
+            moves = grown;
+        }
+        moves[count++] = move;
+    }
+    game_log_close(&log);
+    if (moves == NULL) {
+        perror("malloc");
+        return 2;
+    }
+    if (ret != 0) {
+        free(moves);
+        return 2;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct tetris t;
+    init_tetris(&t);
+    uint64_t rng = log.header.seed;
+    int expected_piece = rng_piece(&rng);
+    int score = 0, lines = 0, status = 0, diverged = 0;
+    for (int i = 0; i < count; i++) {
+        const struct game_log_move *m = &moves[i];
+        int next_piece = i + 1 < count ? moves[i + 1].piece : log.next_piece;
+        if (m->piece != expected_piece && status == 0) {
+            fprintf(stderr, "第 %d 步：方块 %d 与种子生成的 %d 不符\n", i + 1, m->piece, expected_piece);
+            status = 2;
+        }
+        expected_piece = rng_piece(&rng);
+
+        if (check) {
+            int rotation, col;
+            struct tetris copy = t;
+            select_game_move(&copy, m->piece, next_piece, &options, &rotation, &col);
+            if (rotation != m->rotation || col != m->col) {
+                if (diverged == 0) {
+                    printf("第 %d 步决策不同：方块 %d，下一个 %d，记录为 (%d, %d)，现在为 (%d, %d)\n",
+                           i + 1, m->piece, next_piece, m->rotation, m->col, rotation, col);
+                    print_board(&t);
+                }
+                diverged++;
+            }
+        }
+
+        if (m->rotation >= pieces[m->piece].count) {
+            fprintf(stderr, "第 %d 步：方块 %d 没有旋转 %d\n", i + 1, m->piece, m->rotation);
+            free(moves);
+            return 2;
+        }
+        // 列占 4 位，可以超出棋盘，place_piece() 不检查
+        int width = pieces[m->piece].rotations[m->rotation].width;
+        if (m->col < COL_SHIFT || m->col > COL_SHIFT + COL - width) {
+            fprintf(stderr, "第 %d 步：落点 (%d, %d) 超出棋盘\n", i + 1, m->rotation, m->col);
+            free(moves);
+            return 2;
+        }
+        place_piece(&t, &pieces[m->piece], m->rotation, m->col);
+        if (t.landing_row == -1) {
+            fprintf(stderr, "第 %d 步：落点 (%d, %d) 非法\n", i + 1, m->rotation, m->col);
+            free(moves);
+            return 2;
+        }
+        if (SCORE_TABLE[t.rows_eliminated] != m->score_delta && status == 0) {
+            fprintf(stderr, "第 %d 步：记录的得分 %d 与消除 %d 行不符\n", i + 1, m->score_delta, t.rows_eliminated);
+            status = 2;
+        }
+        score += SCORE_TABLE[t.rows_eliminated];
+        lines += t.rows_eliminated;
+    }
+    double elapsed = elapsed_since(&start);
+    free(moves);
+
+    printf("Seed: %llu, Level: %d, Beam width: %d\n",
+           (unsigned long long) log.header.seed, log.header.level, log.header.beam_width);
+    printf("Steps: %d, Score: %d, Lines: %d\n", count, score, lines);
+    printf("Replayed in %.3f seconds, %.0f moves/s\n", elapsed, elapsed > 0 ? count / elapsed : 0.0);
+    if (check) {
+        printf("Diverged decisions: %d\n", diverged);
+    }
+    if (status == 0 && diverged) {
+        status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,346 @@
+// 评估权重调优工具（交叉熵方法）
+// 每一代从以 mean、sigma 为参数的正态分布中抽取一组候选权重（第 0 个候选就是 mean 本身），
+// 每个候选在同一批种子对局上各下若干局，以平均消行数为适应度；
+// 取前 elite 个候选的均值和方差作为下一代的分布，方差上再加一个逐代递减的噪声项防止过早收敛。
+// 全部“候选 × 对局”交给线程池并行计算，每代结束后把优化器状态写入检查点，
+// 并把迄今为止适应度最高的权重写成 tetris --weights 可以读取的文件。
+//
+// 用法: tetris_tune [选项]，--resume 从检查点继续
+
+#define _GNU_SOURCE     // qsort_r
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include "tetris.h"
+#include "selfplay.h"
+#include "rng.h"
+#include "thread_pool.h"
+#include "weights.h"
+
+#define MAX_POPULATION 256
+
+struct tune_state {
+    int generation;                    // 已完成的代数
+    uint64_t rng;
+    double mean[EVAL_WEIGHT_COUNT];
+    double sigma[EVAL_WEIGHT_COUNT];
+    double best_fitness;               // 迄今最好的适应度，尚无结果时为负数
+    double best[EVAL_WEIGHT_COUNT];
+};
+
+struct tune_job {
+    const struct eval_weights *candidates;
+    int games;
+    int max_steps;
+    uint64_t seed;
+    struct game_result *results;       // 第 c 个候选的第 g 局在 results[c * games + g]
+};
+
+static void tune_task(void *arg, int index) {
+    struct tune_job *job = arg;
+    int c = index / job->games;
+    int g = index % job->games;
+    struct move_options options = {0};
+    options.weights = &job->candidates[c];
+    play_seeded_game(rng_game_seed(job->seed, g), job->max_steps, &options, &job->results[index]);
+}
+
+// Box-Muller 变换，返回标准正态分布的随机数
+static double rng_gaussian(uint64_t *state) {
+    double u1 = ((rng_next(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    double u2 = (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static void write_vector(FILE *out, const char *key, const double *v) {
+    fprintf(out, "%s", key);
+    for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+        fprintf(out, " %.17g", v[i]);
+    }
+    fputc('\n', out);
+}
+
+// 先写临时文件再改名，中途被打断也不会留下半个检查点
+static int save_checkpoint(const char *path, const struct tune_state *s) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        perror(tmp);
+        return -1;
+    }
+    fprintf(f, "# tetris_tune checkpoint\n");
+    fprintf(f, "generation %d\n", s->generation);
+    fprintf(f, "rng %llu\n", (unsigned long long) s->rng);
+    write_vector(f, "mean", s->mean);
+    write_vector(f, "sigma", s->sigma);
+    fprintf(f, "best_fitness %.17g\n", s->best_fitness);
+    write_vector(f, "best", s->best);
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+static int read_vector(char *rest, double *v) {
+    char *end;
+    for (int i = 0; i < EVAL_WEIGHT_COUNT; i++, rest = end) {
+        v[i] = strtod(rest, &end);
+        if (end == rest) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int load_checkpoint(const char *path, struct tune_state *s) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    char line[1024];
+    int seen = 0, ret = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char key[32];
+        int n;
+        if (line[0] == '#' || sscanf(line, "%31s %n", key, &n) != 1) {
+            continue;
+        }
+        char *rest = line + n;
+        int ok = 0;
+        if (strcmp(key, "generation") == 0) {
+            ok = sscanf(rest, "%d", &s->generation) == 1;
+        } else if (strcmp(key, "rng") == 0) {
+            unsigned long long rng;
+            ok = sscanf(rest, "%llu", &rng) == 1;
+            s->rng = rng;
+        } else if (strcmp(key, "mean") == 0) {
+            ok = read_vector(rest, s->mean) == 0;
+        } else if (strcmp(key, "sigma") == 0) {
+            ok = read_vector(rest, s->sigma) == 0;
+        } else if (strcmp(key, "best_fitness") == 0) {
+            ok = sscanf(rest, "%lf", &s->best_fitness) == 1;
+        } else if (strcmp(key, "best") == 0) {
+            ok = read_vector(rest, s->best) == 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: 检查点格式错误: %s", path, line);
+            ret = -1;
+            break;
+        }
+        seen++;
+    }
+    fclose(f);
+    if (ret == 0 && seen != 6) {
+        fprintf(stderr, "%s: 检查点不完整\n", path);
+        ret = -1;
+    }
+    return ret;
+}
+
+static int save_weights(const char *path, const struct tune_state *s) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "# tetris_tune: generation %d, fitness %.1f lines/game\n", s->generation, s->best_fitness);
+    write_eval_weights(f, s->best);
+    return fclose(f);
+}
+
+static int cmp_fitness_desc(const void *a, const void *b, void *arg) {
+    const double *fitness = arg;
+    double x = fitness[*(const int *) a];
+    double y = fitness[*(const int *) b];
+    if (x != y) {
+        return x < y ? 1 : -1;
+    }
+    return *(const int *) a - *(const int *) b;   // 同分按编号，保证结果确定
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void print_usage(const char *prog) {
+    printf("用法: %s [选项]\n", prog);
+    printf("选项:\n");
+    printf("  -h, --help            显示帮助信息\n");
+    printf("  -G, --generations N   总代数（默认 30）\n");
+    printf("  -p, --population N    每代候选数（默认 24，最多 %d）\n", MAX_POPULATION);
+    printf("  -k, --elite N         每代保留的精英数（默认为候选数的 1/4）\n");
+    printf("  -g, --games N         每个候选下的局数（默认 8）\n");
+    printf("  -n, --steps N         每局最多落下的方块数（默认 20000）\n");
+    printf("  -j, --threads T       线程数（默认 CPU 核数）\n");
+    printf("  -S, --seed S          随机种子（默认 1）\n");
+    printf("  -s, --sigma X         初始标准差（默认 2.0）\n");
+    printf("      --noise X         第 0 代附加的方差噪声，逐代线性减到 0（默认 1.0）\n");
+    printf("  -W, --weights FILE    初始均值取自权重文件（默认内置权重）\n");
+    printf("  -c, --checkpoint FILE 检查点文件（默认 tune_checkpoint.txt）\n");
+    printf("  -o, --output FILE     最优权重输出文件（默认 tune_weights.txt）\n");
+    printf("      --resume          从检查点继续\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"help",        no_argument,       0, 'h'},
+        {"generations", required_argument, 0, 'G'},
+        {"population",  required_argument, 0, 'p'},
+        {"elite",       required_argument, 0, 'k'},
+        {"games",       required_argument, 0, 'g'},
+        {"steps",       required_argument, 0, 'n'},
+        {"threads",     required_argument, 0, 'j'},
+        {"seed",        required_argument, 0, 'S'},
+        {"sigma",       required_argument, 0, 's'},
+        {"noise",       required_argument, 0, 'N'},
+        {"weights",     required_argument, 0, 'W'},
+        {"checkpoint",  required_argument, 0, 'c'},
+        {"output",      required_argument, 0, 'o'},
+        {"resume",      no_argument,       0, 'R'},
+        {0, 0, 0, 0}
+    };
+    int generations = 30, population = 24, elite = 0, games = 8, max_steps = 20000, threads = 0;
+    uint64_t seed = 1;
+    double sigma0 = 2.0, noise0 = 1.0;
+    const char *weights_path = NULL;
+    const char *checkpoint_path = "tune_checkpoint.txt";
+    const char *output_path = "tune_weights.txt";
+    int resume = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hG:p:k:g:n:j:S:s:W:c:o:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'h': print_usage(argv[0]); return 0;
+            case 'G': generations = atoi(optarg); break;
+            case 'p': population = atoi(optarg); break;
+            case 'k': elite = atoi(optarg); break;
+            case 'g': games = atoi(optarg); break;
+            case 'n': max_steps = atoi(optarg); break;
+            case 'j': threads = atoi(optarg); break;
+            case 'S': seed = strtoull(optarg, NULL, 0); break;
+            case 's': sigma0 = atof(optarg); break;
+            case 'N': noise0 = atof(optarg); break;
+            case 'W': weights_path = optarg; break;
+            case 'c': checkpoint_path = optarg; break;
+            case 'o': output_path = optarg; break;
+            case 'R': resume = 1; break;
+            default: print_usage(argv[0]); return 1;
+        }
+    }
+    if (elite == 0) {
+        elite = population / 4 > 1 ? population / 4 : 2;
+    }
+    if (generations < 1 || population < 2 || population > MAX_POPULATION || elite < 2 || elite > population
+        || games < 1 || max_steps < 1 || sigma0 <= 0 || noise0 < 0) {
+        fprintf(stderr, "参数无效：需要 2 <= elite <= population <= %d，其余参数为正数\n", MAX_POPULATION);
+        return 1;
+    }
+    if (threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = n > 0 ? (int) n : 1;
+    }
+
+    struct tune_state state;
+    if (resume) {
+        if (load_checkpoint(checkpoint_path, &state) != 0) {
+            return 1;
+        }
+        printf("从 %s 第 %d 代继续\n", checkpoint_path, state.generation);
+    } else {
+        struct eval_weights initial = EVAL_WEIGHTS_DEFAULT;
+        if (weights_path && load_eval_weights(weights_path, &initial) != 0) {
+            return 1;
+        }
+        state.generation = 0;
+        state.rng = seed;
+        eval_weights_to_vector(&initial, state.mean);
+        for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+            state.sigma[i] = sigma0;
+        }
+        state.best_fitness = -1;
+        memcpy(state.best, state.mean, sizeof(state.best));
+    }
+
+    struct thread_pool *pool = threads > 1 ? thread_pool_create(threads - 1) : NULL;
+    static struct eval_weights candidates[MAX_POPULATION];
+    static double vectors[MAX_POPULATION][EVAL_WEIGHT_COUNT];
+    double fitness[MAX_POPULATION];
+    int order[MAX_POPULATION];
+    struct game_result *results = malloc(sizeof(struct game_result) * population * games);
+    if (results == NULL) {
+        thread_pool_destroy(pool);
+        return 1;
+    }
+    printf("population %d, elite %d, %d games x %d steps per candidate, %d threads\n",
+           population, elite, games, max_steps, threads);
+
+    while (state.generation < generations) {
+        double start = now_seconds();
+        for (int c = 0; c < population; c++) {
+            for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+                vectors[c][i] = c == 0 ? state.mean[i] : state.mean[i] + state.sigma[i] * rng_gaussian(&state.rng);
+            }
+            eval_weights_from_vector(&candidates[c], vectors[c]);
+        }
+
+        // 同一代的所有候选使用同一批种子，减小比较时的噪声
+        struct tune_job job = { candidates, games, max_steps, rng_next(&state.rng), results };
+        thread_pool_run(pool, population * games, tune_task, &job);
+
+        for (int c = 0; c < population; c++) {
+            double lines = 0;
+            for (int g = 0; g < games; g++) {
+                lines += results[c * games + g].lines;
+            }
+            fitness[c] = lines / games;
+            order[c] = c;
+        }
+        qsort_r(order, population, sizeof(int), cmp_fitness_desc, fitness);
+
+        double noise = noise0 * (1.0 - (double) state.generation / generations);
+        for (int i = 0; i < EVAL_WEIGHT_COUNT; i++) {
+            double sum = 0, sq = 0;
+            for (int e = 0; e < elite; e++) {
+                sum += vectors[order[e]][i];
+            }
+            double m = sum / elite;
+            for (int e = 0; e < elite; e++) {
+                double d = vectors[order[e]][i] - m;
+                sq += d * d;
+            }
+            state.mean[i] = m;
+            state.sigma[i] = sqrt(sq / elite + noise);
+        }
+        if (fitness[order[0]] > state.best_fitness) {
+            state.best_fitness = fitness[order[0]];
+            memcpy(state.best, vectors[order[0]], sizeof(state.best));
+        }
+        state.generation++;
+
+        double elite_sum = 0;
+        for (int e = 0; e < elite; e++) {
+            elite_sum += fitness[order[e]];
+        }
+        printf("gen %d: best %.1f  elite %.1f  mean-candidate %.1f  best-ever %.1f  %.1fs\n",
+               state.generation, fitness[order[0]], elite_sum / elite, fitness[0], state.best_fitness,
+               now_seconds() - start);
+        fflush(stdout);
+        if (save_checkpoint(checkpoint_path, &state) != 0 || save_weights(output_path, &state) != 0) {
+            break;
+        }
+    }
+
+    printf("best weights (%.1f lines/game) written to %s:\n", state.best_fitness, output_path);
+    write_eval_weights(stdout, state.best);
+    free(results);
+    thread_pool_destroy(pool);
+    return 0;
+}